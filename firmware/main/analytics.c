@@ -0,0 +1,110 @@
+#include <tgmath.h>
+#include "analytics.h"
+
+/* private helpers */
+static void judge(analytics_t *an, uint16_t fail, bool broken) {
+    if (broken) {
+        an->result.fails  |= fail;
+        an->result.verdict = ANALYTICS_FAIL;
+    }
+}
+
+/* public functions */
+void analytics_start(analytics_t *an, const profile_limits_t *limits) {
+    an->limits      = *limits;
+    an->result      = (analytics_result_t) {
+        .peak     = 0.0f,
+        .liquidus = limits->liquidus,
+        .verdict  = (limits->liquidus > 0.0f) ? ANALYTICS_PENDING : ANALYTICS_NONE,
+    };
+    an->reached     = false;
+    an->finished    = false;
+    an->time        = 0.0f;
+    an->prev_target = -INFINITY;
+    an->dev_sum     = 0.0f;
+    an->dev_count   = 0;
+    an->anchor_temp = NAN;
+    an->anchor_time = 0.0f;
+}
+
+void analytics_step(analytics_t *an, real_t temp, real_t target, real_t dt) {
+    const profile_limits_t *lim = &an->limits;
+    analytics_result_t *res = &an->result;
+    an->time += dt;
+    res->peak = fmax(res->peak, temp);
+
+    if (lim->liquidus > 0.0f && temp >= lim->liquidus) {
+        res->tal   += dt;
+        an->reached = true;
+    }
+    if (!an->reached && temp >= lim->soak_low && temp <= lim->soak_high) {
+        res->soak += dt;
+    }
+
+    // non-overlapping windows, a single noisy sample can't set the ramp
+    if (isnan(an->anchor_temp)) {
+        an->anchor_temp = temp;
+        an->anchor_time = an->time;
+    } else if (an->time - an->anchor_time >= ANALYTICS_RATE_WINDOW - dt * 0.5f) {
+        real_t rate = (temp - an->anchor_temp) / (an->time - an->anchor_time);
+        res->ramp_up    = fmax(res->ramp_up, rate);
+        res->ramp_down  = fmax(res->ramp_down, -rate);
+        an->anchor_temp = temp;
+        an->anchor_time = an->time;
+    }
+
+    // the oven can't cool as fast as most profiles ask, so only while heating or holding
+    if (target >= an->prev_target) {
+        real_t err = fabs(temp - target);
+        res->dev_max  = fmax(res->dev_max, err);
+        an->dev_sum  += err * err;
+        an->dev_count++;
+        res->dev_rms  = sqrt(an->dev_sum / (real_t) an->dev_count);
+    }
+    an->prev_target = target;
+
+    if (res->verdict == ANALYTICS_NONE) {
+        return;
+    }
+    judge(an, ANALYTICS_PEAK_HIGH, res->peak > lim->peak_max);
+    judge(an, ANALYTICS_TAL_LONG,  res->tal > lim->tal_max);
+    judge(an, ANALYTICS_RAMP_UP,   res->ramp_up > lim->ramp_up_max);
+    judge(an, ANALYTICS_RAMP_DOWN, res->ramp_down > lim->ramp_down_max);
+    judge(an, ANALYTICS_SOAK_LONG, res->soak > lim->soak_max);
+    judge(an, ANALYTICS_DEVIATION, lim->dev_max > 0.0f && res->dev_max > lim->dev_max);
+}
+
+// complete is false if the run was stopped or faulted before the profile ended
+void analytics_finish(analytics_t *an, bool complete) {
+    const profile_limits_t *lim = &an->limits;
+    analytics_result_t *res = &an->result;
+    if (an->finished || res->verdict == ANALYTICS_NONE) {
+        return;
+    }
+    an->finished = true;
+    judge(an, ANALYTICS_ABORTED,    !complete);
+    judge(an, ANALYTICS_PEAK_LOW,   res->peak < lim->peak_min);
+    judge(an, ANALYTICS_TAL_SHORT,  res->tal < lim->tal_min);
+    judge(an, ANALYTICS_SOAK_SHORT, res->soak < lim->soak_min);
+    if (res->verdict == ANALYTICS_PENDING) {
+        res->verdict = ANALYTICS_PASS;
+    }
+}
+
+const char *analytics_verdict_name(analytics_verdict_t verdict) {
+    static const char *names[] = {
+        [ANALYTICS_NONE]    = "none",
+        [ANALYTICS_PENDING] = "pending",
+        [ANALYTICS_PASS]    = "pass",
+        [ANALYTICS_FAIL]    = "fail",
+    };
+    return names[verdict];
+}
+
+const char *analytics_fail_name(int bit) {
+    static const char *names[ANALYTICS_FAILS] = {
+        "peak_low", "peak_high", "tal_short", "tal_long", "ramp_up",
+        "ramp_down", "soak_short", "soak_long", "deviation", "aborted",
+    };
+    return (bit >= 0 && bit < ANALYTICS_FAILS) ? names[bit] : NULL;
+}
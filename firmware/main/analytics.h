@@ -0,0 +1,72 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "profile.h"
+
+/*
+ * Reflow process window, updated every control tick from the same
+ * temperature the controller sees. Constant memory per run: peak, time above
+ * liquidus, steepest ramps (over fixed windows), soak time and tracking error
+ * while the profile isn't cooling. Limits that can only be broken upward fail
+ * the run as soon as they are, the rest are judged when it ends.
+ */
+
+#define ANALYTICS_RATE_WINDOW (5.0f) // s, ramp rates are measured over this
+
+// limits broken, bits of analytics_result_t.fails
+#define ANALYTICS_PEAK_LOW   (1 << 0)
+#define ANALYTICS_PEAK_HIGH  (1 << 1)
+#define ANALYTICS_TAL_SHORT  (1 << 2)
+#define ANALYTICS_TAL_LONG   (1 << 3)
+#define ANALYTICS_RAMP_UP    (1 << 4)
+#define ANALYTICS_RAMP_DOWN  (1 << 5)
+#define ANALYTICS_SOAK_SHORT (1 << 6)
+#define ANALYTICS_SOAK_LONG  (1 << 7)
+#define ANALYTICS_DEVIATION  (1 << 8)
+#define ANALYTICS_ABORTED    (1 << 9)
+#define ANALYTICS_FAILS      (10)
+
+typedef enum {
+    ANALYTICS_NONE,    // profile has no limits
+    ANALYTICS_PENDING, // nothing broken yet
+    ANALYTICS_PASS,
+    ANALYTICS_FAIL,
+} analytics_verdict_t;
+
+// what a run is judged on, floats so it can be stored with the run
+typedef struct {
+    float    peak;      // C
+    float    tal;       // s above liquidus
+    float    ramp_up;   // C/s, steepest
+    float    ramp_down; // C/s, steepest cooling, positive
+    float    soak;      // s in the soak window before liquidus
+    float    dev_max;   // C, tracking error while not cooling
+    float    dev_rms;   // C
+    float    liquidus;  // C, 0 if no limits
+    uint16_t fails;     // ANALYTICS_* bits
+    uint8_t  verdict;   // analytics_verdict_t
+    uint8_t  reserved;
+} analytics_result_t;
+
+typedef struct {
+    profile_limits_t   limits;
+    analytics_result_t result;
+    bool               reached;     // liquidus, soak only counts before it
+    bool               finished;
+    real_t             time;        // s
+    real_t             prev_target;
+    real_t             dev_sum;     // squared error
+    uint32_t           dev_count;
+    real_t             anchor_temp; // start of the current rate window
+    real_t             anchor_time;
+} analytics_t;
+
+void analytics_start(analytics_t *an, const profile_limits_t *limits);
+void analytics_step(analytics_t *an, real_t temp, real_t target, real_t dt);
+void analytics_finish(analytics_t *an, bool complete);
+const char *analytics_verdict_name(analytics_verdict_t verdict);
+const char *analytics_fail_name(int bit);
+
+#endif // ANALYTICS_H
@@ -0,0 +1,95 @@
+#include <tgmath.h>
+#include "autotune.h"
+
+/* private data */
+#define HYSTERESIS  (1.0f)    // C, a few sensor LSBs
+#define MAX_TIME    (1800.0f) // s
+#define SKIP_CYCLES (1)      // first one is still settling from the heat up
+#define CYCLES      (3)      // averaged
+
+#define RELAY_AMP   (0.5f)    // duty swings 0 to 1
+
+/* private helpers */
+static void finish(autotune_t *at) {
+    real_t amp = at->sum_amp / CYCLES;
+    if (amp <= at->hysteresis) {
+        at->state = AUTOTUNE_FAILED;
+        return;
+    }
+    at->pu = at->sum_period / CYCLES;
+    at->ku = 4.0f * RELAY_AMP / ((real_t) M_PI * sqrt(amp * amp - at->hysteresis * at->hysteresis));
+
+    // Ziegler-Nichols, Tyreus-Luyben overshoots less but lags a profile's ramps by more than it saves
+    real_t ti = at->pu / 2.0f;
+    real_t td = at->pu / 8.0f;
+    at->kp    = (real_t) 0.6 * at->ku;
+    at->ki    = at->kp / ti;
+    at->kd    = at->kp * td;
+    at->state = AUTOTUNE_DONE;
+}
+
+/* public functions */
+void autotune_start(autotune_t *at, real_t setpoint) {
+    at->state      = AUTOTUNE_RUNNING;
+    at->setpoint   = setpoint;
+    at->hysteresis = HYSTERESIS;
+    at->max_time   = MAX_TIME;
+    at->on         = true;
+    at->time       = 0.0f;
+    at->last_rise  = -1.0f;
+    at->temp_max   = -INFINITY;
+    at->temp_min   = INFINITY;
+    at->cycles     = 0;
+    at->sum_period = 0.0f;
+    at->sum_amp    = 0.0f;
+}
+
+void autotune_stop(autotune_t *at) {
+    if (at->state == AUTOTUNE_RUNNING) {
+        at->state = AUTOTUNE_IDLE;
+    }
+}
+
+// returns heater duty
+real_t autotune_step(autotune_t *at, real_t temp, real_t dt) {
+    if (at->state != AUTOTUNE_RUNNING) {
+        return 0.0f;
+    }
+    at->time += dt;
+    if (at->time > at->max_time) {
+        at->state = AUTOTUNE_FAILED;
+        return 0.0f;
+    }
+
+    at->temp_max = fmax(at->temp_max, temp);
+    at->temp_min = fmin(at->temp_min, temp);
+    if (at->on && temp > at->setpoint + at->hysteresis) {
+        at->on = false;
+    } else if (!at->on && temp < at->setpoint - at->hysteresis) {
+        at->on = true;
+        if (at->last_rise >= 0.0f) {
+            if (at->cycles >= SKIP_CYCLES) {
+                at->sum_period += at->time - at->last_rise;
+                at->sum_amp    += (at->temp_max - at->temp_min) * 0.5f;
+            }
+            if (++at->cycles == SKIP_CYCLES + CYCLES) {
+                finish(at);
+                return 0.0f;
+            }
+        }
+        at->last_rise = at->time;
+        at->temp_max  = temp;
+        at->temp_min  = temp;
+    }
+    return at->on ? 1.0f : 0.0f;
+}
+
+const char *autotune_state_name(autotune_state_t state) {
+    static const char *names[] = {
+        [AUTOTUNE_IDLE]    = "idle",
+        [AUTOTUNE_RUNNING] = "running",
+        [AUTOTUNE_DONE]    = "done",
+        [AUTOTUNE_FAILED]  = "failed",
+    };
+    return names[state];
+}
@@ -0,0 +1,42 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdbool.h>
+#include "real.h"
+
+/*
+ * Relay (Astrom-Hagglund) autotune. The heaters are switched fully on/off
+ * around a setpoint, and the resulting oscillation gives the ultimate gain and
+ * period, from which PID gains are computed.
+ */
+
+typedef enum {
+    AUTOTUNE_IDLE,
+    AUTOTUNE_RUNNING,
+    AUTOTUNE_DONE,
+    AUTOTUNE_FAILED,
+} autotune_state_t;
+
+typedef struct {
+    autotune_state_t state;
+    real_t setpoint;   // C
+    real_t hysteresis; // C
+    real_t max_time;   // s
+
+    bool   on;
+    real_t time;       // s
+    real_t last_rise;  // s, when the relay last switched on
+    real_t temp_max, temp_min;
+    int    cycles;     // full oscillations seen
+    real_t sum_period, sum_amp;
+
+    real_t ku, pu;     // ultimate gain (duty/C) and period (s)
+    real_t kp, ki, kd;
+} autotune_t;
+
+void   autotune_start(autotune_t *at, real_t setpoint);
+void   autotune_stop(autotune_t *at);
+real_t autotune_step(autotune_t *at, real_t temp, real_t dt);
+const char *autotune_state_name(autotune_state_t state);
+
+#endif // AUTOTUNE_H
@@ -0,0 +1,72 @@
+#include "command.h"
+
+/* public functions */
+void command_queue_init(command_queue_t *queue) {
+    spsc_init(&queue->spsc);
+}
+
+bool command_push(command_queue_t *queue, const command_t *cmd) {
+    unsigned slot;
+    if (!spsc_reserve(&queue->spsc, COMMAND_QUEUE_LEN, &slot)) {
+        return false;
+    }
+    queue->cmds[slot] = *cmd;
+    spsc_commit(&queue->spsc);
+    return true;
+}
+
+bool command_pop(command_queue_t *queue, command_t *cmd) {
+    unsigned slot;
+    if (!spsc_front(&queue->spsc, COMMAND_QUEUE_LEN, &slot)) {
+        return false;
+    }
+    *cmd = queue->cmds[slot];
+    spsc_release(&queue->spsc);
+    return true;
+}
+
+// returns whether the command was accepted
+bool command_apply(control_t *ctrl, queue_t *queue, const command_t *cmd) {
+    switch (cmd->type) {
+        case COMMAND_START:
+            if (cmd->start.profile >= profile_count()) {
+                return false;
+            }
+            control_start(ctrl, cmd->start.profile);
+            ctrl->cursor.manual_temp = cmd->start.temp; // this zone's only, other profiles ignore it
+            return true;
+        case COMMAND_STOP:
+            // stops the batch too, whatever's wrong may not be this run alone
+            control_stop(ctrl);
+            queue_clear(queue);
+            return true;
+        case COMMAND_AUTOTUNE:
+            if (ctrl->running) {
+                return false;
+            }
+            control_autotune(ctrl, cmd->setpoint);
+            return true;
+        case COMMAND_PID:
+            control_pid_set(ctrl, cmd->pid.kp, cmd->pid.ki, cmd->pid.kd);
+            return true;
+        case COMMAND_SCHED:
+            return control_sched_set(ctrl, &cmd->sched);
+        case COMMAND_MODEL:
+            control_model_set(ctrl, &cmd->model);
+            return true;
+        case COMMAND_MODE:
+            control_mode_set(ctrl, cmd->mode);
+            return true;
+        case COMMAND_PROFILE_REMOVE:
+            // types shift on removal, so not while anything is running or queued
+            return !ctrl->running && queue_pending(queue) == 0 && profile_remove(cmd->profile);
+        case COMMAND_QUEUE_ADD:
+            return queue_add(queue, cmd->job.profile, cmd->job.count, cmd->job.boards);
+        case COMMAND_QUEUE_CLEAR:
+            queue_clear(queue);
+            return true;
+        case COMMAND_QUEUE_TEMP:
+            return queue_temp_set(queue, cmd->start_temp);
+    }
+    return false;
+}
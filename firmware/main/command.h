@@ -0,0 +1,66 @@
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "control.h"
+#include "queue.h"
+#include "spsc.h"
+
+/*
+ * Requests to the controller. Other tasks push them onto a lock-free single
+ * consumer queue, and the control task applies them at the start of its next
+ * tick, so it never waits on whoever sent them. Producers must serialize
+ * among themselves.
+ */
+
+#define COMMAND_QUEUE_LEN (8) // power of two
+
+typedef enum {
+    COMMAND_START,
+    COMMAND_STOP,
+    COMMAND_AUTOTUNE,
+    COMMAND_PID,
+    COMMAND_SCHED,
+    COMMAND_MODEL,
+    COMMAND_MODE,
+    COMMAND_PROFILE_REMOVE,
+    COMMAND_QUEUE_ADD,
+    COMMAND_QUEUE_CLEAR,
+    COMMAND_QUEUE_TEMP,
+} command_type_t;
+
+typedef struct {
+    command_type_t type;
+    uint32_t       id;   // echoed in the reply
+    uint8_t        zone; // whose controller, see oven.h
+    union {
+        struct {
+            profile_type_t profile;
+            double         temp;
+        } start;
+        double setpoint; // autotune
+        struct {
+            double kp, ki, kd;
+        } pid;
+        control_sched_t sched; // whole table, so a run never sees half an edit
+        control_model_t model;
+        control_mode_t  mode;
+        profile_type_t  profile; // remove
+        queue_job_t     job;
+        double          start_temp; // queue
+    };
+} command_t;
+
+typedef struct {
+    command_t cmds[COMMAND_QUEUE_LEN];
+    spsc_t    spsc; // one producer at a time, see above
+} command_queue_t;
+
+void command_queue_init(command_queue_t *queue);
+bool command_push(command_queue_t *queue, const command_t *cmd);
+bool command_pop(command_queue_t *queue, command_t *cmd);
+
+bool command_apply(control_t *ctrl, queue_t *queue, const command_t *cmd);
+
+#endif // COMMAND_H
@@ -0,0 +1,340 @@
+#include <tgmath.h>
+#include "control.h"
+
+/* private data */
+#define LIMIT(x, low, high) ((x < low) ? (low) : ((x > high) ? (high) : (x)))
+
+#define SCHED_SLEW (CONTROL_PERIOD / CONTROL_SCHED_TAU) // per tick
+
+/* private helpers */
+static void pid_reset(control_pid_t *pid) {
+    pid->int_term = 0.0f;
+    pid->prev_err = 0.0f;
+    pid->p        = 0.0f;
+    pid->i        = 0.0f;
+    pid->d        = 0.0f;
+    pid->held     = false;
+}
+
+static void pid_gains(control_pid_t *pid, const control_gains_t *gains) {
+    pid->kp    = gains->kp;
+    pid->ki    = gains->ki;
+    pid->kd    = gains->kd;
+    pid->ki_dt = gains->ki * CONTROL_PERIOD;
+    pid->kd_dt = gains->kd / CONTROL_PERIOD;
+}
+
+static bool gains_valid(const control_gains_t *gains) {
+    return isfinite(gains->kp) && isfinite(gains->ki) && isfinite(gains->kd) &&
+        gains->kp >= 0.0f && gains->ki >= 0.0f && gains->kd >= 0.0f;
+}
+
+static bool sched_before(const control_sched_entry_t *a, const control_sched_entry_t *b) {
+    return (a->phase != b->phase) ? a->phase < b->phase : a->temp < b->temp;
+}
+
+static control_gains_t sched_lookup(const control_t *ctrl, real_t temp) {
+    // entries of the current phase, else of any phase, else the gains set outright
+    const control_sched_t *sched = &ctrl->sched;
+    size_t first = 0, last = 0;
+    for (int pass = 0; pass < 2 && first == last; pass++) {
+        uint8_t phase = pass ? CONTROL_PHASE_ANY : ctrl->phase;
+        for (first = 0; first < sched->num && sched->entries[first].phase < phase; first++) {
+        }
+        for (last = first; last < sched->num && sched->entries[last].phase == phase; last++) {
+        }
+    }
+    if (first == last) {
+        return ctrl->gains;
+    }
+    size_t i = first;
+    while (i + 1 < last && sched->entries[i + 1].temp <= temp) {
+        i++;
+    }
+    const control_sched_entry_t *lo = &sched->entries[i];
+    if (i + 1 == last || temp <= lo->temp) {
+        return lo->gains; // flat past the ends
+    }
+    const control_sched_entry_t *hi = lo + 1;
+    real_t f = (temp - lo->temp) * ctrl->sched_inv[i];
+    return (control_gains_t) {
+        .kp = lo->gains.kp + (hi->gains.kp - lo->gains.kp) * f,
+        .ki = lo->gains.ki + (hi->gains.ki - lo->gains.ki) * f,
+        .kd = lo->gains.kd + (hi->gains.kd - lo->gains.kd) * f,
+    };
+}
+
+static void sched_step(control_t *ctrl, const profile_status_t *target) {
+    // scheduled on the target rather than the measurement, so noise doesn't move the gains
+    bool started = ctrl->phase == CONTROL_PHASE_ANY;
+    ctrl->phase  = (target->slope > CONTROL_PHASE_SLOPE)  ? CONTROL_PHASE_RAMP :
+                   (target->slope < -CONTROL_PHASE_SLOPE) ? CONTROL_PHASE_COOL : CONTROL_PHASE_HOLD;
+    control_gains_t want = sched_lookup(ctrl, target->temp);
+    control_pid_t *pid   = &ctrl->pid;
+    if (want.kp == pid->kp && want.ki == pid->ki && want.kd == pid->kd) {
+        return; // always without a table
+    }
+    if (!started) { // the run's first tick has no output to bump
+        want.kp = pid->kp + (want.kp - pid->kp) * SCHED_SLEW;
+        want.ki = pid->ki + (want.ki - pid->ki) * SCHED_SLEW;
+        want.kd = pid->kd + (want.kd - pid->kd) * SCHED_SLEW;
+    }
+    pid_gains(pid, &want);
+}
+
+// bias is added to the output, the integral may cancel at most all of it
+static real_t pid_step(control_pid_t *pid, real_t err, real_t bias) {
+    real_t out     = bias + pid->kp * err + pid->int_term;
+    bool integrate = (out < 1.0f || err < 0.0f) && (out > 0.0f || err > 0.0f);
+    real_t term    = integrate ? pid->int_term + pid->ki_dt * err : pid->int_term; // don't wind up while saturated
+    real_t limited = LIMIT(term, -bias, 1.0f); // anti-windup, limit to 100%
+    pid->held      = !integrate || limited != term;
+    pid->int_term  = limited;
+
+    pid->p = LIMIT(pid->kp * err,                    -1.0f, 1.0f);
+    pid->i = LIMIT(pid->int_term,                    -1.0f, 1.0f);
+    pid->d = LIMIT(pid->kd_dt * (err - pid->prev_err), -1.0f, 1.0f);
+    pid->prev_err = err;
+    return bias + pid->p + pid->i + pid->d;
+}
+
+static real_t feedforward(control_t *ctrl, real_t temp, real_t elapsed) {
+    // invert the model along the profile one dead time (plus a tick of PWM latency) ahead
+    const control_model_t *model = &ctrl->model;
+    profile_cursor_t ahead = ctrl->cursor;
+    profile_status_t future = profile_status(&ahead, elapsed + model->delay + CONTROL_PERIOD, temp);
+    if (future.done || ctrl->model_inv <= 0.0f) {
+        return 0.0f;
+    }
+    return LIMIT((future.temp - ROOM_TEMP + model->tau * future.slope) * ctrl->model_inv, 0.0f, 1.0f);
+}
+
+static void tune_step(control_t *ctrl, real_t temp) {
+    ctrl->duty    = autotune_step(&ctrl->tune, temp, CONTROL_PERIOD);
+    ctrl->ff      = 0.0f;
+    ctrl->running = ctrl->tune.state == AUTOTUNE_RUNNING;
+    ctrl->target  = ctrl->running ? ctrl->tune.setpoint : ROOM_TEMP;
+    if (ctrl->tune.state == AUTOTUNE_DONE) {
+        control_pid_set(ctrl, ctrl->tune.kp, ctrl->tune.ki, ctrl->tune.kd);
+    }
+}
+
+static void predict(control_t *ctrl, real_t elapsed) {
+    // walks what's left of the profile with the learned model, at most PROFILE_MAX_STEPS segments
+    const ident_model_t *model = &ctrl->ident.model;
+    size_t num_segs = 0;
+    const profile_segment_t *segs = profile_segments(ctrl->cursor.type, &num_segs);
+    real_t temp = ctrl->current;
+    real_t left = 0.0f;
+    if (ctrl->running && (segs == NULL || ctrl->tune.state == AUTOTUNE_RUNNING)) {
+        left = NAN; // manual and autotune runs end when they end
+    } else if (ctrl->running) {
+        real_t t = elapsed - ctrl->cursor.offset;
+        for (size_t i = ctrl->cursor.seg; i < num_segs; i++) {
+            const profile_segment_t *seg = &segs[i];
+            if (seg->wait) {
+                // the heaters change over now, the oven answers a dead time later
+                real_t wait = model->valid ? ident_time_to(model, temp, seg->thresh, (seg->wait > 0) ? 1.0f : 0.0f) : NAN;
+                left += (wait > 0.0f) ? wait + model->delay : wait;
+                temp  = seg->thresh;
+                t     = seg->start; // the profile clock stands still until the wait ends
+                continue;
+            }
+            real_t dur = seg->end - fmax(seg->start, t);
+            real_t end = seg->temp + seg->slope * (seg->end - seg->start);
+            if (dur <= 0.0f) {
+                continue;
+            }
+            // heaters can follow a rise, a fall is at best passive cooling
+            left += dur;
+            temp  = (end < temp && model->valid) ? fmax(end, ident_predict(model, temp, 0.0f, dur)) : end;
+        }
+    }
+    ctrl->eta      = left;
+    ctrl->cooldown = model->valid ? left + ident_time_to(model, temp, CONTROL_SAFE_TEMP, 0.0f) : NAN;
+}
+
+/* public functions */
+void control_init(control_t *ctrl) {
+    pid_reset(&ctrl->pid);
+    profile_cursor_init(&ctrl->cursor, PROFILE_TYPE_MANUAL);
+    ctrl->tune.state = AUTOTUNE_IDLE;
+    ctrl->running    = false;
+    ctrl->current    = ROOM_TEMP;
+    ctrl->target     = ROOM_TEMP;
+    ctrl->duty       = 0.0f;
+    ctrl->ff         = 0.0f;
+    ctrl->mode       = CONTROL_MODE_PID;
+    ctrl->model      = (control_model_t) { .gain = 0.0f, .tau = 0.0f, .delay = 0.0f };
+    ctrl->model_inv  = 0.0f;
+    ctrl->sched.num  = 0;
+    ctrl->phase      = CONTROL_PHASE_ANY;
+    control_pid_set(ctrl, 0.0f, 0.0f, 0.0f);
+    const profile_limits_t none = { .liquidus = 0.0f };
+    analytics_start(&ctrl->analytics, &none);
+    ident_init(&ctrl->ident, CONTROL_PERIOD);
+    ctrl->eta        = 0.0f;
+    ctrl->cooldown   = NAN;
+}
+
+void control_pid_set(control_t *ctrl, real_t kp, real_t ki, real_t kd) {
+    // during a run the schedule slews to them if it has no entries for where the target is
+    ctrl->gains = (control_gains_t) { .kp = kp, .ki = ki, .kd = kd };
+    if (ctrl->phase == CONTROL_PHASE_ANY) {
+        pid_gains(&ctrl->pid, &ctrl->gains);
+    }
+}
+
+// by phase then temp in place, false if an entry is invalid or repeats a phase and temp
+bool control_sched_sort(control_sched_t *sched) {
+    if (sched->num > CONTROL_SCHED_MAX) {
+        return false;
+    }
+    for (size_t i = 0; i < sched->num; i++) {
+        control_sched_entry_t entry = sched->entries[i];
+        if (entry.phase > CONTROL_PHASE_COOL || !isfinite(entry.temp) || !gains_valid(&entry.gains)) {
+            return false;
+        }
+        size_t j = i;
+        for (; j > 0 && sched_before(&entry, &sched->entries[j - 1]); j--) {
+            sched->entries[j] = sched->entries[j - 1];
+        }
+        if (j > 0 && !sched_before(&sched->entries[j - 1], &entry)) {
+            return false;
+        }
+        sched->entries[j] = entry;
+    }
+    return true;
+}
+
+// false without changing anything if control_sched_sort refuses it
+bool control_sched_set(control_t *ctrl, const control_sched_t *sched) {
+    control_sched_t sorted = *sched;
+    if (!control_sched_sort(&sorted)) {
+        return false;
+    }
+    ctrl->sched = sorted;
+    for (size_t i = 0; i < sorted.num; i++) {
+        const control_sched_entry_t *next = &sorted.entries[i + 1];
+        bool span = i + 1 < sorted.num && next->phase == sorted.entries[i].phase;
+        ctrl->sched_inv[i] = span ? 1.0f / (next->temp - sorted.entries[i].temp) : 0.0f;
+    }
+    return true;
+}
+
+const char *control_phase_name(control_phase_t phase) {
+    static const char *names[] = {
+        [CONTROL_PHASE_ANY]  = "any",
+        [CONTROL_PHASE_RAMP] = "ramp",
+        [CONTROL_PHASE_HOLD] = "hold",
+        [CONTROL_PHASE_COOL] = "cool",
+    };
+    return names[phase];
+}
+
+void control_mode_set(control_t *ctrl, control_mode_t mode) {
+    ctrl->mode = mode;
+}
+
+void control_model_set(control_t *ctrl, const control_model_t *model) {
+    ctrl->model     = *model;
+    ctrl->model_inv = (model->gain > 0.0f) ? 1.0f / model->gain : 0.0f;
+}
+
+const char *control_mode_name(control_mode_t mode) {
+    static const char *names[] = {
+        [CONTROL_MODE_PID]         = "pid",
+        [CONTROL_MODE_FEEDFORWARD] = "ff",
+    };
+    return names[mode];
+}
+
+void control_start(control_t *ctrl, profile_type_t type) {
+    profile_limits_t limits;
+    profile_limits(type, &limits);
+    analytics_start(&ctrl->analytics, &limits);
+    profile_cursor_init(&ctrl->cursor, type);
+    ctrl->tune.state = AUTOTUNE_IDLE;
+    ctrl->phase      = CONTROL_PHASE_ANY; // gains jump to the table on the first tick
+    ctrl->running    = true;
+}
+
+void control_autotune(control_t *ctrl, real_t setpoint) {
+    const profile_limits_t none = { .liquidus = 0.0f };
+    analytics_start(&ctrl->analytics, &none);
+    autotune_start(&ctrl->tune, setpoint);
+    pid_reset(&ctrl->pid);
+    ctrl->running = true;
+}
+
+void control_stop(control_t *ctrl) {
+    if (ctrl->running) {
+        analytics_finish(&ctrl->analytics, false);
+    }
+    autotune_stop(&ctrl->tune);
+    ctrl->target  = ROOM_TEMP;
+    ctrl->running = false;
+}
+
+void control_step(control_t *ctrl, real_t temp, real_t elapsed) {
+    profile_status_t target = {
+        .temp = ROOM_TEMP,
+        .done = true,
+    };
+    ident_step(&ctrl->ident, temp, ctrl->duty); // last tick's duty, applied since
+    ctrl->current = temp;
+    if (ctrl->running && ctrl->tune.state == AUTOTUNE_RUNNING) {
+        tune_step(ctrl, temp);
+        predict(ctrl, elapsed);
+        return;
+    }
+    if (ctrl->running) {
+        target = profile_status(&ctrl->cursor, elapsed, temp);
+        ctrl->target  = target.temp;
+        ctrl->running = !target.done;
+        if (ctrl->running) {
+            analytics_step(&ctrl->analytics, temp, target.temp, CONTROL_PERIOD);
+        } else {
+            analytics_finish(&ctrl->analytics, true);
+        }
+    }
+
+    ctrl->ff = 0.0f;
+    if (target.done) {
+        pid_reset(&ctrl->pid);
+        if (ctrl->phase != CONTROL_PHASE_ANY) { // back to the gains set outright
+            ctrl->phase = CONTROL_PHASE_ANY;
+            pid_gains(&ctrl->pid, &ctrl->gains);
+        }
+        ctrl->duty = 0.0f;
+    } else {
+        sched_step(ctrl, &target);
+        if (ctrl->mode == CONTROL_MODE_FEEDFORWARD) {
+            ctrl->ff = feedforward(ctrl, temp, elapsed);
+        }
+        real_t duty = pid_step(&ctrl->pid, target.temp - temp, ctrl->ff); // LIMIT would step it up to three times
+        ctrl->duty  = LIMIT(duty, 0.0f, 1.0f);
+    }
+    predict(ctrl, elapsed);
+}
+
+const char *control_fire_name(control_fire_t fire) {
+    static const char *names[] = {
+        [CONTROL_FIRE_BURST] = "burst",
+        [CONTROL_FIRE_PHASE] = "phase",
+    };
+    return names[fire];
+}
+
+void control_pwm_init(control_pwm_t *pwm, int first, int total) {
+    pwm->duty = 0;
+    pwm->on   = 0;
+    for (int i = 0; i < PWM_CHANNELS; i++) {
+        pwm->err[i] = (uint32_t) (first + i) * PWM_ONE / total; // stagger every zone's channels
+    }
+}
+
+// rounds half up, duty is never negative here so no lround() call is needed
+uint32_t control_pwm_duty(real_t duty) {
+    return (uint32_t) (LIMIT(duty, 0.0f, 1.0f) * PWM_ONE + 0.5f);
+}
@@ -0,0 +1,166 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "analytics.h"
+#include "autotune.h"
+#include "ident.h"
+#include "profile.h"
+#include "real.h"
+
+/*
+ * Hardware-independent control core. Everything in here is plain C so it can
+ * be built for the host and run against a simulated oven (see sim/). Per-tick
+ * math is real_t (see real.h), divisions are hoisted out of the tick into
+ * coefficients computed when gains or the model change.
+ */
+
+#ifndef CONTROL_PERIOD_MS
+#define CONTROL_PERIOD_MS (250) // set from Kconfig in the firmware build
+#endif
+
+#ifndef CONTROL_SAFE_TEMP
+#define CONTROL_SAFE_TEMP (50) // C, set from Kconfig in the firmware build
+#endif
+
+#define CONTROL_PERIOD ((real_t) CONTROL_PERIOD_MS / 1000) // s
+#define PWM_PERIOD     (CONTROL_PERIOD_MS * 120 / 1000)   // half-cycles @ 60Hz AC per control period
+#define PWM_CHANNELS   (2)       // heater elements
+#define PWM_ONE        (1 << 16) // full duty in fixed point, the ISR has no FPU to spare
+
+#define CONTROL_SCHED_MAX   (8)  // gain table entries
+#define CONTROL_SCHED_TAU   (5)  // s, scheduled gains move toward the table with this time constant
+#define CONTROL_PHASE_SLOPE (0.05f) // C/s, target slope that counts as ramping or cooling
+
+typedef struct {
+    real_t kp, ki, kd;
+    real_t ki_dt, kd_dt; // ki * CONTROL_PERIOD, kd / CONTROL_PERIOD
+    real_t int_term;     // ki * integral of error, duty, so gain changes don't bump it
+    real_t prev_err;
+    real_t p, i, d; // last terms, duty
+    bool   held;    // integrator didn't move freely on the last step
+} control_pid_t;
+
+typedef struct {
+    real_t kp, ki, kd;
+} control_gains_t;
+
+// what the profile's target is doing, picks the gain table entries
+typedef enum {
+    CONTROL_PHASE_ANY,  // not following a profile, or table entries that apply to every phase
+    CONTROL_PHASE_RAMP, // target rising
+    CONTROL_PHASE_HOLD, // target flat, or waiting on temperature
+    CONTROL_PHASE_COOL, // target falling
+} control_phase_t;
+
+/*
+ * Gain schedule: entries for the current phase if there are any, else those
+ * for any phase, are interpolated linearly in target temperature and held
+ * flat past the first and last. Without entries the gains from
+ * control_pid_set apply. Scheduled gains slew with CONTROL_SCHED_TAU and the
+ * integral is kept as duty, so neither a phase change nor an edit bumps the
+ * output.
+ */
+typedef struct {
+    real_t          temp; // C of target
+    control_gains_t gains;
+    uint8_t         phase; // control_phase_t
+} control_sched_entry_t;
+
+typedef struct {
+    control_sched_entry_t entries[CONTROL_SCHED_MAX]; // by phase then temp, see control_sched_set
+    uint8_t               num;
+} control_sched_t;
+
+typedef enum {
+    CONTROL_MODE_PID,         // reacts to the current error only
+    CONTROL_MODE_FEEDFORWARD, // model-based duty from the upcoming profile, PID trims the rest
+} control_mode_t;
+
+// first-order-plus-dead-time oven model, duty 1 settles at ambient + gain
+typedef struct {
+    real_t gain;  // C
+    real_t tau;   // s
+    real_t delay; // s
+} control_model_t;
+
+/*
+ * First-order sigma-delta per heater: every zero cross a channel adds the duty
+ * to its error and fires a half-cycle when that reaches one, so duty takes
+ * effect on the next zero cross at any resolution. Every zone's channels
+ * start evenly spread over one cycle of error and at most one of them may
+ * turn on per half-cycle, oven wide, a blocked one keeps its error and fires
+ * on the next.
+ */
+typedef enum {
+    CONTROL_FIRE_BURST, // whole half-cycles per heater, see control_pwm_t
+    CONTROL_FIRE_PHASE, // part of every half-cycle, needs random-phase triac drivers
+} control_fire_t;
+
+typedef struct {
+    volatile uint32_t duty; // PWM_ONE = full, written whole by the control task
+    uint32_t          err[PWM_CHANNELS];
+    uint32_t          on;   // bit per channel, last half-cycle
+} control_pwm_t;
+
+typedef struct {
+    control_pid_t    pid;       // gains in use
+    control_gains_t  gains;     // from control_pid_set, where the schedule has no entries
+    control_sched_t  sched;
+    real_t           sched_inv[CONTROL_SCHED_MAX]; // 1 / temp span to the next entry of the same phase
+    control_phase_t  phase;
+    control_mode_t   mode;
+    control_model_t  model;
+    real_t           model_inv; // 1 / model.gain, 0 without a model
+    profile_cursor_t cursor;
+    autotune_t       tune;
+    bool             running;
+    real_t           current;
+    real_t           target;
+    real_t           duty;
+    real_t           ff;  // feedforward part of duty
+    analytics_t      analytics; // of the current or last run
+    ident_t          ident;     // learned from every tick, running or not
+    real_t           eta;       // s until the run ends, NAN if unknown
+    real_t           cooldown;  // s until CONTROL_SAFE_TEMP with the heaters off after the run, NAN if unknown
+} control_t;
+
+void control_init(control_t *ctrl);
+void control_pid_set(control_t *ctrl, real_t kp, real_t ki, real_t kd);
+bool control_sched_sort(control_sched_t *sched);
+bool control_sched_set(control_t *ctrl, const control_sched_t *sched);
+const char *control_phase_name(control_phase_t phase);
+void control_mode_set(control_t *ctrl, control_mode_t mode);
+void control_model_set(control_t *ctrl, const control_model_t *model);
+const char *control_mode_name(control_mode_t mode);
+void control_start(control_t *ctrl, profile_type_t type);
+void control_autotune(control_t *ctrl, real_t setpoint);
+void control_stop(control_t *ctrl);
+void control_step(control_t *ctrl, real_t temp, real_t elapsed);
+
+const char *control_fire_name(control_fire_t fire);
+void     control_pwm_init(control_pwm_t *pwm, int first, int total); // first of total channels, to stagger
+uint32_t control_pwm_duty(real_t duty);
+
+// called on every zero cross, returns a bit per channel that should be on, inlined into the ISR;
+// started is shared by every zone in one edge, false before the first
+__attribute__((always_inline)) static inline uint32_t control_pwm_edge(control_pwm_t *pwm, bool *started) {
+    uint32_t duty = pwm->duty;
+    uint32_t on   = 0;
+    for (int i = 0; i < PWM_CHANNELS; i++) {
+        pwm->err[i] += duty;
+        if (pwm->err[i] >= PWM_ONE) {
+            bool was_on = pwm->on & (1u << i);
+            if (was_on || !*started) {
+                pwm->err[i] -= PWM_ONE;
+                on          |= 1u << i;
+                *started    |= !was_on;
+            }
+        }
+    }
+    pwm->on = on;
+    return on;
+}
+
+#endif // CONTROL_H
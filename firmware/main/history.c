@@ -0,0 +1,35 @@
+#include "history.h"
+
+/* public functions */
+void history_init(history_t *hist) {
+    hist->seq = 0;
+}
+
+void history_push(history_t *hist, const history_sample_t *sample) {
+    hist->samples[hist->seq % HISTORY_LEN] = *sample;
+    hist->seq++;
+}
+
+/*
+ * Copies up to max samples newer than since into out, oldest first. On return
+ * seq is the sequence number of the last sample copied (or since if none). A
+ * since ahead of the buffer means the caller saw a previous boot, so it starts
+ * over from the oldest sample.
+ */
+size_t history_read(const history_t *hist, uint32_t since, history_sample_t *out, size_t max, uint32_t *seq) {
+    uint32_t oldest = (hist->seq > HISTORY_LEN) ? (hist->seq - HISTORY_LEN) : 0; // exclusive
+    if (since > hist->seq) {
+        since = 0;
+    }
+    if (since < oldest) {
+        since = oldest;
+    }
+
+    size_t n = 0;
+    while (n < max && since < hist->seq) {
+        out[n++] = hist->samples[since % HISTORY_LEN];
+        since++;
+    }
+    *seq = since;
+    return n;
+}
@@ -0,0 +1,31 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fixed-size ring of control loop samples. Every sample gets a sequence number
+ * (starting at 1) so readers can ask for only what they haven't seen yet.
+ * Not thread-safe, the owner provides locking.
+ */
+
+#define HISTORY_LEN (1200) // 300s @ 0.25s control period
+
+typedef struct {
+    uint32_t time;    // ms since boot
+    float    current; // C
+    float    target;  // C
+    float    duty;    // 0-1
+} history_sample_t;
+
+typedef struct {
+    history_sample_t samples[HISTORY_LEN];
+    uint32_t         seq; // of newest sample, 0 if empty
+} history_t;
+
+void   history_init(history_t *hist);
+void   history_push(history_t *hist, const history_sample_t *sample);
+size_t history_read(const history_t *hist, uint32_t since, history_sample_t *out, size_t max, uint32_t *seq);
+
+#endif // HISTORY_H
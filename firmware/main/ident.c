@@ -0,0 +1,124 @@
+#include <string.h>
+#include <tgmath.h>
+#include "ident.h"
+
+/* private data */
+#define SCALE      (0.01f)  // temperatures in 100C, keeps the regressors near one
+#define FORGET     ((real_t) 0.9995) // per tick, remembers the last few minutes
+#define ERR_FORGET ((real_t) 0.999)
+#define P_INIT     (1.0f)
+#define P_MAX      (100.0f) // trace, stop forgetting without excitation so P can't blow up
+#define MIN_TICKS  (240)    // before the model is reported
+
+#define TAU_MIN     (5.0f)    // s
+#define TAU_MAX     (5000.0f)
+#define GAIN_MIN    (10.0f)   // C
+#define GAIN_MAX    (2000.0f)
+#define AMBIENT_MIN (-20.0f)  // C
+#define AMBIENT_MAX (80.0f)
+
+static const uint8_t DELAY_TICKS[IDENT_DELAYS] = {0, 4, 8, 12, 16, 24, 32, 48};
+
+_Static_assert(IDENT_HISTORY > 48 && (IDENT_HISTORY & (IDENT_HISTORY - 1)) == 0, "duty history");
+
+/* private helpers */
+static void rls_init(ident_rls_t *rls) {
+    memset(rls, 0, sizeof(*rls));
+    for (int i = 0; i < 3; i++) {
+        rls->p[i][i] = P_INIT;
+    }
+}
+
+static void rls_update(ident_rls_t *rls, const real_t *phi, real_t y) {
+    real_t (*p)[3] = rls->p;
+    real_t pphi[3];
+    for (int i = 0; i < 3; i++) {
+        pphi[i] = p[i][0] * phi[0] + p[i][1] * phi[1] + p[i][2] * phi[2];
+    }
+    real_t trace = p[0][0] + p[1][1] + p[2][2];
+    real_t forget = (trace < P_MAX) ? FORGET : 1.0f;
+    real_t den_inv = 1.0f / (forget + phi[0] * pphi[0] + phi[1] * pphi[1] + phi[2] * pphi[2]);
+    real_t err = y - (rls->theta[0] * phi[0] + rls->theta[1] * phi[1] + rls->theta[2] * phi[2]);
+    rls->err = ERR_FORGET * rls->err + err * err;
+
+    // P = (P - P phi phi' P / den) / forget, upper half mirrored to stay symmetric
+    real_t forget_inv = 1.0f / forget;
+    for (int i = 0; i < 3; i++) {
+        rls->theta[i] += pphi[i] * den_inv * err;
+        for (int j = i; j < 3; j++) {
+            p[i][j] = (p[i][j] - pphi[i] * pphi[j] * den_inv) * forget_inv;
+            p[j][i] = p[i][j];
+        }
+    }
+}
+
+static void model_update(ident_t *id) {
+    // the candidate with the least recent error, if its fit makes physical sense
+    int best = 0;
+    for (int i = 1; i < IDENT_DELAYS; i++) {
+        if (id->rls[i].err < id->rls[best].err) {
+            best = i;
+        }
+    }
+    const real_t *theta = id->rls[best].theta;
+    ident_model_t *model = &id->model;
+    model->valid = false;
+    if (theta[0] <= 0.0f || theta[1] <= 0.0f || id->ticks < MIN_TICKS) {
+        return;
+    }
+    model->tau     = id->dt / theta[0];
+    model->gain    = theta[1] / (theta[0] * SCALE);
+    model->ambient = theta[2] / (theta[0] * SCALE);
+    model->delay   = DELAY_TICKS[best] * id->dt;
+    model->valid   = model->tau >= TAU_MIN && model->tau <= TAU_MAX &&
+        model->gain >= GAIN_MIN && model->gain <= GAIN_MAX &&
+        model->ambient >= AMBIENT_MIN && model->ambient <= AMBIENT_MAX;
+}
+
+/* public functions */
+void ident_init(ident_t *id, real_t dt) {
+    for (int i = 0; i < IDENT_DELAYS; i++) {
+        rls_init(&id->rls[i]);
+    }
+    memset(id->duty, 0, sizeof(id->duty));
+    id->head      = 0;
+    id->ticks     = 0;
+    id->prev_temp = NAN;
+    id->dt        = dt;
+    id->model     = (ident_model_t) { .valid = false };
+}
+
+void ident_step(ident_t *id, real_t temp, real_t duty) {
+    id->duty[id->head++ % IDENT_HISTORY] = duty;
+    if (!isnan(id->prev_temp) && !isnan(temp)) {
+        // regress the change over the last tick on where it started and the duty d ticks before
+        real_t x = id->prev_temp * SCALE;
+        real_t y = temp * SCALE - x;
+        for (int i = 0; i < IDENT_DELAYS; i++) {
+            const real_t phi[3] = {-x, id->duty[(id->head - 1 - DELAY_TICKS[i]) % IDENT_HISTORY], 1.0f};
+            rls_update(&id->rls[i], phi, y);
+        }
+        id->ticks++;
+        model_update(id);
+    }
+    id->prev_temp = temp;
+}
+
+// temperature after time at a constant duty, from the model's step response
+real_t ident_predict(const ident_model_t *model, real_t from, real_t duty, real_t time) {
+    real_t settle = model->ambient + model->gain * duty;
+    return settle + (from - settle) * exp(-time / model->tau);
+}
+
+// s to get from one temperature to another at a constant duty, 0 if already there, infinite if never
+real_t ident_time_to(const ident_model_t *model, real_t from, real_t to, real_t duty) {
+    real_t settle = model->ambient + model->gain * duty;
+    real_t toward = (to - from) * (settle - from);
+    if (to == from || toward < 0.0f) {
+        return 0.0f; // there, or already past it
+    }
+    if (toward == 0.0f || (settle - to) * (settle - from) <= 0.0f) {
+        return INFINITY; // no drive, or it settles short
+    }
+    return model->tau * log((settle - from) / (settle - to));
+}
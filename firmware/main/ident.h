@@ -0,0 +1,51 @@
+#ifndef IDENT_H
+#define IDENT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "real.h"
+
+/*
+ * Online identification of the oven as first-order-plus-dead-time, from the
+ * commanded duty and measured temperature once per control tick:
+ *     T[k+1] - T[k] = a * (ambient - T[k]) + b * u[k - d]
+ * with a = dt / tau and b = a * gain. One recursive least squares estimator
+ * with exponential forgetting runs per candidate dead time d, and whichever
+ * has predicted the last few minutes best gives the model. Memory and time
+ * per tick are constant.
+ */
+
+#define IDENT_DELAYS  (8)  // candidate dead times
+#define IDENT_HISTORY (64) // duty ticks kept, more than the longest candidate, power of two
+
+typedef struct {
+    real_t gain;    // C above ambient at full duty
+    real_t tau;     // s
+    real_t delay;   // s
+    real_t ambient; // C
+    bool   valid;   // seen enough to trust, and physically sensible
+} ident_model_t;
+
+typedef struct {
+    real_t theta[3]; // a, b, a * ambient on scaled temperatures
+    real_t p[3][3];  // covariance
+    real_t err;      // recent squared prediction error
+} ident_rls_t;
+
+typedef struct {
+    ident_rls_t   rls[IDENT_DELAYS];
+    real_t        duty[IDENT_HISTORY]; // applied, newest at head - 1
+    uint32_t      head;
+    uint32_t      ticks;
+    real_t        prev_temp;
+    real_t        dt;
+    ident_model_t model; // from the best estimator, refreshed every step
+} ident_t;
+
+void ident_init(ident_t *id, real_t dt);
+void ident_step(ident_t *id, real_t temp, real_t duty); // duty is what was applied since the last step
+
+real_t ident_predict(const ident_model_t *model, real_t from, real_t duty, real_t time);
+real_t ident_time_to(const ident_model_t *model, real_t from, real_t to, real_t duty);
+
+#endif // IDENT_H
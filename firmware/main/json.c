@@ -0,0 +1,129 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "json.h"
+
+/* private helpers */
+static void put(json_t *json, const char *str, size_t len) {
+    if (json->overflow || json->len + len >= json->size) {
+        json->overflow = true;
+        return;
+    }
+    memcpy(&json->buf[json->len], str, len);
+    json->len += len;
+    json->buf[json->len] = '\0';
+}
+
+static void putf(json_t *json, const char *fmt, ...) {
+    if (json->overflow) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(&json->buf[json->len], json->size - json->len, fmt, args);
+    va_end(args);
+    if (n < 0 || json->len + n >= json->size) {
+        json->overflow = true;
+        json->buf[json->len] = '\0';
+        return;
+    }
+    json->len += n;
+}
+
+static void put_str(json_t *json, const char *str) {
+    put(json, "\"", 1);
+    for (const char *c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            char esc[2] = { '\\', *c };
+            put(json, esc, 2);
+        } else if ((unsigned char) *c < 0x20) {
+            putf(json, "\\u%04x", *c);
+        } else {
+            put(json, c, 1);
+        }
+    }
+    put(json, "\"", 1);
+}
+
+static void put_key(json_t *json, const char *key) {
+    if (json->comma) {
+        put(json, ",", 1);
+    }
+    if (key) {
+        put_str(json, key);
+        put(json, ":", 1);
+    }
+    json->comma = true;
+}
+
+/* public functions */
+void json_init(json_t *json, char *buf, size_t size) {
+    json->buf      = buf;
+    json->size     = size;
+    json->comma    = false;
+    json_clear(json);
+}
+
+void json_clear(json_t *json) {
+    json->len      = 0;
+    json->overflow = false;
+    if (json->size > 0) {
+        json->buf[0] = '\0';
+    }
+}
+
+bool json_ok(const json_t *json) {
+    return !json->overflow;
+}
+
+void json_obj_begin(json_t *json, const char *key) {
+    put_key(json, key);
+    put(json, "{", 1);
+    json->comma = false;
+}
+
+void json_obj_end(json_t *json) {
+    put(json, "}", 1);
+    json->comma = true;
+}
+
+void json_arr_begin(json_t *json, const char *key) {
+    put_key(json, key);
+    put(json, "[", 1);
+    json->comma = false;
+}
+
+void json_arr_end(json_t *json) {
+    put(json, "]", 1);
+    json->comma = true;
+}
+
+void json_number(json_t *json, const char *key, double val, int decimals) {
+    put_key(json, key);
+    if (isfinite(val)) {
+        putf(json, "%.*f", decimals, val);
+    } else {
+        put(json, "null", 4);
+    }
+}
+
+void json_uint(json_t *json, const char *key, uint32_t val) {
+    put_key(json, key);
+    putf(json, "%" PRIu32, val);
+}
+
+void json_bool(json_t *json, const char *key, bool val) {
+    put_key(json, key);
+    if (val) {
+        put(json, "true", 4);
+    } else {
+        put(json, "false", 5);
+    }
+}
+
+void json_string(json_t *json, const char *key, const char *val) {
+    put_key(json, key);
+    put_str(json, val);
+}
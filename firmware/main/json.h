@@ -0,0 +1,36 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Compact JSON writer into a caller supplied buffer, never allocates. Keys are
+ * NULL for array elements and the root value. On overflow the output stops
+ * growing and json_ok() returns false.
+ */
+
+typedef struct {
+    char  *buf;
+    size_t size;
+    size_t len;
+    bool   comma;    // next value needs a separator
+    bool   overflow;
+} json_t;
+
+void json_init(json_t *json, char *buf, size_t size);
+void json_clear(json_t *json); // drop output but keep position in the document
+bool json_ok(const json_t *json);
+
+void json_obj_begin(json_t *json, const char *key);
+void json_obj_end(json_t *json);
+void json_arr_begin(json_t *json, const char *key);
+void json_arr_end(json_t *json);
+
+void json_number(json_t *json, const char *key, double val, int decimals);
+void json_uint(json_t *json, const char *key, uint32_t val);
+void json_bool(json_t *json, const char *key, bool val);
+void json_string(json_t *json, const char *key, const char *val);
+
+#endif // JSON_H
@@ -6,6 +6,7 @@
 #include "wifi.h"
 #include "server.h"
 #include "oven.h"
+#include "runs.h"
 
 static const char *TAG = "main";
 
@@ -23,6 +24,7 @@ void app_main(void) {
     
     // app init
     oven_init();
+    runs_init();
     wifi_init();
     server_init();
     ESP_LOGI(TAG, "booted!");
@@ -0,0 +1,103 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+
+/* private helpers */
+static void flush(metrics_t *m) {
+    if (m->len > 0) {
+        m->flush(m->ctx, m->buf, m->len);
+        m->len = 0;
+    }
+}
+
+static void putf(metrics_t *m, const char *fmt, ...) {
+    // whole lines only, a line that doesn't fit even in an empty buffer is dropped
+    for (int attempt = 0; attempt < 2; attempt++) {
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(&m->buf[m->len], m->size - m->len, fmt, args);
+        va_end(args);
+        if (n >= 0 && m->len + n < m->size) {
+            m->len += n;
+            return;
+        }
+        flush(m);
+    }
+}
+
+static void put_series(metrics_t *m, const char *name, const char *suffix, const char *labels,
+        const char *le, double value) {
+    bool braces = labels || le;
+    putf(m, "%s%s%s%s%s%s%s%s%s %.10g\n", name, suffix,
+        braces ? "{" : "",
+        labels ? labels : "",
+        (labels && le) ? "," : "",
+        le ? "le=\"" : "", le ? le : "", le ? "\"" : "",
+        braces ? "}" : "",
+        value);
+}
+
+/* public functions */
+void metrics_hist_init(metrics_hist_t *hist, const uint32_t *bounds) {
+    memset(hist, 0, sizeof(*hist));
+    hist->bounds = bounds;
+    seqlock_init(&hist->lock);
+}
+
+void metrics_observe(metrics_hist_t *hist, uint32_t us) {
+    int i = 0;
+    while (i < METRICS_BUCKETS - 1 && us > hist->bounds[i]) {
+        i++;
+    }
+    seqlock_write_begin(&hist->lock);
+    hist->buckets[i]++;
+    hist->count++;
+    hist->sum += us;
+    seqlock_write_end(&hist->lock);
+}
+
+void metrics_init(metrics_t *m, char *buf, size_t size, metrics_flush_t flush, void *ctx) {
+    m->buf   = buf;
+    m->size  = size;
+    m->len   = 0;
+    m->flush = flush;
+    m->ctx   = ctx;
+}
+
+void metrics_end(metrics_t *m) {
+    flush(m);
+}
+
+void metrics_family(metrics_t *m, const char *name, const char *type, const char *help) {
+    putf(m, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void metrics_value(metrics_t *m, const char *name, const char *labels, double value) {
+    put_series(m, name, "", labels, NULL, value);
+}
+
+void metrics_hist(metrics_t *m, const char *name, const char *labels, metrics_hist_t *hist) {
+    metrics_hist_t copy;
+    unsigned seq;
+    do {
+        seq  = seqlock_read_begin(&hist->lock);
+        copy = *hist;
+    } while (seqlock_read_retry(&hist->lock, seq));
+
+    // exposition buckets are cumulative and in seconds
+    uint32_t total = 0;
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        char le[16];
+        if (i < METRICS_BUCKETS - 1) {
+            snprintf(le, sizeof(le), "%g", copy.bounds[i] / 1e6);
+        } else {
+            strcpy(le, "+Inf");
+        }
+        total += copy.buckets[i];
+        put_series(m, name, "_bucket", labels, le, total);
+    }
+    put_series(m, name, "_sum", labels, NULL, copy.sum / 1e6);
+    put_series(m, name, "_count", labels, NULL, copy.count);
+}
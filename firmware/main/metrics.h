@@ -0,0 +1,46 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "seqlock.h"
+
+/*
+ * Prometheus text exposition. A histogram has a single writer that never
+ * waits (seqlock), the scrape takes a consistent copy. Output goes through a
+ * small buffer handed to a flush callback, so it can be sent in chunks of any
+ * number of series.
+ */
+
+#define METRICS_BUCKETS (8) // the last one is +Inf
+
+typedef struct {
+    const uint32_t *bounds;                   // us, METRICS_BUCKETS - 1 ascending
+    uint32_t        buckets[METRICS_BUCKETS]; // not cumulative
+    uint32_t        count;
+    uint64_t        sum;                      // us
+    seqlock_t       lock;
+} metrics_hist_t;
+
+typedef void (*metrics_flush_t)(void *ctx, const char *buf, size_t len);
+
+typedef struct {
+    char           *buf;
+    size_t          size;
+    size_t          len;
+    metrics_flush_t flush;
+    void           *ctx;
+} metrics_t;
+
+void metrics_hist_init(metrics_hist_t *hist, const uint32_t *bounds);
+void metrics_observe(metrics_hist_t *hist, uint32_t us);
+
+void metrics_init(metrics_t *m, char *buf, size_t size, metrics_flush_t flush, void *ctx);
+void metrics_end(metrics_t *m);
+
+// labels are preformatted, e.g. "uri=\"/temps\"", or NULL
+void metrics_family(metrics_t *m, const char *name, const char *type, const char *help);
+void metrics_value(metrics_t *m, const char *name, const char *labels, double value);
+void metrics_hist(metrics_t *m, const char *name, const char *labels, metrics_hist_t *hist);
+
+#endif // METRICS_H
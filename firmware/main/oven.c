@@ -1,55 +1,289 @@
-#include <math.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <argtable3/argtable3.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 #include <driver/gpio.h>
+#include <driver/gptimer.h>
 #include <driver/spi_master.h>
+#include <driver/usb_serial_jtag.h>
 #include <esp_console.h>
+#include <esp_cpu.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+#include "command.h"
+#include "control.h"
+#include "metrics.h"
 #include "oven.h"
+#include "phase.h"
+#include "queue.h"
+#include "ring.h"
+#include "sensor.h"
+#include "seqlock.h"
+#include "settings.h"
+#include "trace.h"
+#include "zcd.h"
 
 /* private data */
 #define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
-#define LIMIT(x, low, high) ((x < low) ? (low) : ((x > high) ? (high) : (x)))
 
-static const int MISO_PIN  = 0;
-static const int SCK_PIN   = 10;
-static const int CS_PINS[] = {3}; // {1, 3};
+static const int MISO_PIN = 0;
+static const int SCK_PIN  = 10;
+static const int ZCD_PIN  = 4;
 
-static const int ZCD_PIN     = 4;
-static const int HEAT_PINS[] = {6, 7};
+// thermocouples and heaters of each zone, GPIO_NUM_NC for a heater channel that isn't fitted
+typedef struct {
+    const char *name;
+    int         cs_pins[SENSOR_MAX];
+    size_t      num_cs;
+    int         heat_pins[PWM_CHANNELS];
+} zone_config_t;
 
-#define PWM_PERIOD (30) // ~0.25s @ 60Hz AC
+static const zone_config_t ZONES[] = {
+    { .name = "oven",  .cs_pins = {3}, .num_cs = 1, .heat_pins = {6, 7} }, // {1, 3}
+    // { .name = "plate", .cs_pins = {1}, .num_cs = 1, .heat_pins = {5, GPIO_NUM_NC} },
+};
+#define NUM_ZONES COUNT_OF(ZONES)
+_Static_assert(NUM_ZONES <= OVEN_MAX_ZONES, "too many zones");
 
-#define CONTROL_PERIOD (0.25) // s
+#define PROFILES_KEY     "profiles"
+#define PROFILES_MAX_LEN (8192)
+#define PID_KEY          "pid"
+#define SCHED_KEY        "sched"
+#define MODEL_KEY        "model"
+#define MODE_KEY         "mode"
+#define FIRE_KEY         "fire"
+#define QUEUE_KEY        "qtemp"
+#define TUNE_TEMP        "180" // C, between soak and reflow
+#define TUNE_POLL_MS     (1000)
+#define EVENTS_POLL_MS   (1000) // queue starts are QUEUE_GAP apart at least
+#define TRACE_SECONDS    "10"
+#define TRACE_BATCH      (8) // frames per console write
+#define KEY_LEN          (16) // NVS limit with the terminator
+#define SPI_MAX_CS       (6)  // hardware CS lines on SPI2
+
+#define SAMPLE_PERIOD     (CONFIG_SAMPLE_PERIOD_MS / 1000.0f) // s
+#define SAMPLE_TIMEOUT_US (4 * CONFIG_SAMPLE_PERIOD_MS * 1000) // no fresh samples counts as a fault
+#define SPI_TIMEOUT_MS    (10)
+#define REPLY_TIMEOUT_MS  (4 * CONTROL_PERIOD_MS)
+
+// bytes, see osro_task_stack_free_bytes: the oven task's tick is fusion, control, model and analytics
+#define OVEN_STACK (4096)
+#define TEMP_STACK (2048 + NUM_ZONES * SENSOR_MAX * sizeof(spi_transaction_t)) // a transaction per sensor
+
+static const uint32_t TICK_BOUNDS[METRICS_BUCKETS - 1]   = {100, 200, 500, 1000, 2000, 5000, 10000}; // us
+static const uint32_t JITTER_BOUNDS[METRICS_BUCKETS - 1] = {50, 100, 200, 500, 1000, 2000, 5000};    // us
+static const uint32_t SPI_BOUNDS[METRICS_BUCKETS - 1]    = {20, 50, 100, 200, 500, 1000, 5000};      // us
+
+typedef struct {
+    double kp, ki, kd;
+} pid_gains_t;
+
+// NVS layouts, doubles whatever real_t is, a different version reads as unset
+#define STORED_VERSION (1) // bump when a layout below changes
+
+typedef struct {
+    uint32_t version;
+    uint32_t reserved;
+    double   gain, tau, delay;
+} model_stored_t;
+
+typedef struct {
+    double  temp;
+    double  kp, ki, kd;
+    uint8_t phase;
+    uint8_t reserved[7];
+} sched_entry_stored_t;
+
+typedef struct {
+    uint32_t             version;
+    uint8_t              num;
+    uint8_t              reserved[3];
+    sched_entry_stored_t entries[CONTROL_SCHED_MAX];
+} sched_stored_t;
+
+_Static_assert(sizeof(model_stored_t) == 32 && sizeof(sched_stored_t) == CONTROL_SCHED_MAX * 40 + 8,
+    "stored settings layout changed");
+
+// everything other tasks can see, published by the oven task once per tick
+typedef struct {
+    oven_status_t status;
+    autotune_t    tune;
+    queue_t       queue;
+} oven_snapshot_t;
 
 static const char *TAG = "oven";
 
-static struct {
-    SemaphoreHandle_t lock;
+// one oven, or a preheater plate, with its own sensors, heaters, controller and run
+typedef struct {
+    const zone_config_t *config;
+    int                  idx;
+
     TickType_t        start;
-    profile_type_t    type;
-    oven_status_t     status;
+    control_t         ctrl;
+    queue_t           queue;       // runs to start back to back
+    sensor_filter_t   filter;
+    sensor_reading_t  readings[SENSOR_MAX];
+    uint16_t          raw[SENSOR_MAX]; // frames of the newest sample
+    int64_t           sample_time; // us, newest fused sample
+    bool              faulted;
+    ring_t            samples;     // acquisition task -> oven task
+
+    history_t       history;
+    seqlock_t       history_lock;
+    oven_snapshot_t snapshot;
+    seqlock_t       snapshot_lock;
+    control_sched_t sched; // as the oven task has it, sorted, under sched_lock
+
+    // written by the oven task, read by /metrics and the zones command
+    uint32_t step_cycles;     // control_step alone, last tick
+    uint32_t step_cycles_max;
+    uint32_t zone_cycles;     // everything the oven task does for the zone, last tick
+    uint32_t zone_cycles_max;
+    uint32_t trips;           // runs stopped because every thermocouple faulted
+
+    spi_device_handle_t temps[SENSOR_MAX];
+
+    control_pwm_t pwm;
+    gptimer_handle_t gate_timer; // fires the triacs in phase mode
+    bool             gate_on;
+    volatile control_fire_t fire;
+    uint32_t         heat_masks[1 << PWM_CHANNELS]; // channel bits to GPIO bits
+} oven_zone_t;
+
+/*
+ * The oven task never blocks on another task. Other tasks read snapshots
+ * under seqlocks and send it commands, serialized among themselves by
+ * client_lock. Only the oven task touches a zone's ctrl once it's running.
+ * It services every zone each tick, one after the other.
+ */
+static struct {
+    oven_zone_t zones[NUM_ZONES];
+    uint32_t    tick;
+
+    trace_ring_t      trace;       // oven task -> console, while tracing
+    volatile bool     tracing;
+    int               trace_zone;
+
+    command_queue_t   commands;   // other tasks -> oven task
+    SemaphoreHandle_t client_lock; // mutex, so priority inheritance between clients
+    SemaphoreHandle_t reply;
+    uint32_t          next_id;
+    uint32_t          reply_id;
+    bool              reply_ok;
+    SemaphoreHandle_t sched_lock; // mutex, keeps each zone's sched in step with the oven task's
+
+    // each written by one task, read by the server's /metrics
+    TaskHandle_t   oven_task;
+    TaskHandle_t   temp_task;
+    metrics_hist_t tick_time;
+    metrics_hist_t tick_jitter;
+    uint32_t       overruns;
+    metrics_hist_t spi_time;
+    uint32_t       spi_errors;
 
     struct {
         struct arg_str *kp;
         struct arg_str *ki;
         struct arg_str *kd;
+        struct arg_int *zone;
         struct arg_end *end;
     } pid_set_args;
-    double kp, ki, kd;
-    double int_err, prev_err;
 
-    spi_device_handle_t temps[COUNT_OF(CS_PINS)];
+    struct {
+        struct arg_lit *clear;
+        struct arg_str *phase;
+        struct arg_str *temp;
+        struct arg_str *kp;
+        struct arg_str *ki;
+        struct arg_str *kd;
+        struct arg_int *zone;
+        struct arg_end *end;
+    } sched_args;
+
+    struct {
+        struct arg_str *seconds;
+        struct arg_int *zone;
+        struct arg_end *end;
+    } trace_args;
+
+    struct {
+        struct arg_str *temp;
+        struct arg_int *zone;
+        struct arg_end *end;
+    } autotune_args;
+
+    struct {
+        struct arg_str *gain;
+        struct arg_str *tau;
+        struct arg_str *delay;
+        struct arg_int *zone;
+        struct arg_end *end;
+    } model_args;
+
+    struct {
+        struct arg_str *mode;
+        struct arg_int *zone;
+        struct arg_end *end;
+    } mode_args;
+    struct {
+        struct arg_str *fire;
+        struct arg_int *zone;
+        struct arg_end *end;
+    } fire_args;
+
+    struct {
+        struct arg_int *profile;
+        struct arg_int *count;
+        struct arg_int *boards;
+        struct arg_lit *clear;
+        struct arg_str *temp;
+        struct arg_int *zone;
+        struct arg_end *end;
+    } queue_args;
+
+    zcd_t            zcd;      // written by the zero cross ISR only
+    seqlock_t        zcd_lock;
+    int              pwm_first; // zone first in line for the half-cycle's heater start, ISR only
 
-    int pwm_counter;
-    int pwm_compare;
-    int pwm_compare_next;
+    oven_listener_t listener;
+    void           *listener_arg;
 } oven_data;
 
 /* private helpers */
+static void zone_key(char *key, const char *base, int zone) {
+    // the first zone keeps the keys from before there were zones
+    if (zone == 0) {
+        snprintf(key, KEY_LEN, "%s", base);
+    } else {
+        snprintf(key, KEY_LEN, "%s%d", base, zone);
+    }
+}
+
+static bool zone_arg(struct arg_int *arg, int *zone) {
+    *zone = arg->count ? arg->ival[0] : 0;
+    if (*zone < 0 || *zone >= NUM_ZONES) {
+        ESP_LOGE(TAG, "no zone %d", *zone);
+        return false;
+    }
+    return true;
+}
+
+static bool zones_busy(void) {
+    // running, or with runs queued
+    for (int z = 0; z < NUM_ZONES; z++) {
+        if (oven_data.zones[z].ctrl.running || queue_pending(&oven_data.zones[z].queue) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static void temp_init(void) {
     const spi_bus_config_t bus_cfg = {
         .mosi_io_num     = -1,
@@ -60,148 +294,936 @@ static void temp_init(void) {
     };
     spi_bus_initialize(SPI2_HOST, &bus_cfg, SPI_DMA_DISABLED);
 
-    for (int i = 0; i < COUNT_OF(CS_PINS); i++) {
-        const spi_device_interface_config_t dev_cfg = {
-            .mode           = 1,
-            .clock_speed_hz = 4000000, // 4.3 MHz max
-            .spics_io_num   = CS_PINS[i],
-            .flags          = 0,
-            .queue_size     = 1,
-        };
-        spi_bus_add_device(SPI2_HOST, &dev_cfg, &oven_data.temps[i]);
+    // every zone's thermocouples share the bus, SPI_MAX_CS of them at most
+    for (int z = 0; z < NUM_ZONES; z++) {
+        oven_zone_t *zone = &oven_data.zones[z];
+        for (int i = 0; i < zone->config->num_cs; i++) {
+            const spi_device_interface_config_t dev_cfg = {
+                .mode           = 1,
+                .clock_speed_hz = 4000000, // 4.3 MHz max
+                .spics_io_num   = zone->config->cs_pins[i],
+                .flags          = 0,
+                .queue_size     = 1,
+            };
+            esp_err_t err = spi_bus_add_device(SPI2_HOST, &dev_cfg, &zone->temps[i]);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "%s thermocouple %d unavailable (%s)", zone->config->name, i, esp_err_to_name(err));
+                zone->temps[i] = NULL; // reads as a bus fault
+            }
+        }
     }
 }
 
-static double temp_get(void) {
-    // MAX6675 device
-    uint8_t buf[2];
-    spi_transaction_t tran = {
-        .flags     = 0,
-        .length    = sizeof(buf) * 8,
-        .tx_buffer = NULL,
-        .rx_buffer = buf,
-    };
+static void temp_thread(void *arg) {
+    // MAX6675 devices, read on their own schedule so sensors never hold up the control loop
+    temp_init();
+    spi_transaction_t trans[NUM_ZONES][SENSOR_MAX];
+    bool queued[NUM_ZONES][SENSOR_MAX];
+
+    TickType_t wait = xTaskGetTickCount();
+    while (true) {
+        // queue every sensor at once, the driver runs them back to back from its ISR
+        int64_t start = esp_timer_get_time();
+        for (int z = 0; z < NUM_ZONES; z++) {
+            oven_zone_t *zone = &oven_data.zones[z];
+            for (int i = 0; i < zone->config->num_cs; i++) {
+                trans[z][i] = (spi_transaction_t) {
+                    .flags  = SPI_TRANS_USE_RXDATA,
+                    .length = 16,
+                };
+                queued[z][i] = zone->temps[i] && spi_device_queue_trans(zone->temps[i], &trans[z][i], 0) == ESP_OK;
+            }
+        }
+
+        for (int z = 0; z < NUM_ZONES; z++) {
+            oven_zone_t *zone = &oven_data.zones[z];
+            ring_sample_t sample = {
+                .num = zone->config->num_cs,
+            };
+            for (int i = 0; i < zone->config->num_cs; i++) {
+                spi_transaction_t *done;
+                if (queued[z][i] && spi_device_get_trans_result(zone->temps[i], &done,
+                        pdMS_TO_TICKS(SPI_TIMEOUT_MS)) == ESP_OK) {
+                    sample.raw[i] = (done->rx_data[0] << 8) | done->rx_data[1];
+                } else {
+                    sample.raw[i] = 0xFFFF; // decodes as a bus fault
+                    oven_data.spi_errors++;
+                }
+            }
+            sample.time = esp_timer_get_time();
+            ring_push(&zone->samples, &sample);
+        }
+        metrics_observe(&oven_data.spi_time, esp_timer_get_time() - start);
+
+        vTaskDelayUntil(&wait, pdMS_TO_TICKS(CONFIG_SAMPLE_PERIOD_MS));
+    }
+    vTaskDelete(NULL);
+}
+
+static bool temp_update(oven_zone_t *zone) {
+    // fuse everything published since the last tick, each with its own time step
+    ring_sample_t sample;
+    size_t num = zone->config->num_cs;
+    bool ok = !zone->faulted;
+    while (ring_pop(&zone->samples, &sample)) {
+        real_t dt = zone->sample_time ? (real_t) (sample.time - zone->sample_time) * 1e-6f : SAMPLE_PERIOD;
+        for (int i = 0; i < num; i++) {
+            sensor_decode(sample.raw[i], &zone->readings[i]);
+            zone->raw[i] = sample.raw[i];
+        }
+        ok = sensor_fuse(&zone->filter, zone->readings, num, dt);
+        zone->sample_time = sample.time;
+    }
+    return ok && esp_timer_get_time() - zone->sample_time < SAMPLE_TIMEOUT_US;
+}
+
+static void IRAM_ATTR heaters_set(oven_zone_t *zone, uint32_t on) {
+    // every heater of the zone at once straight through the set/clear registers, no read-modify-write
+    const uint32_t all = zone->heat_masks[(1 << PWM_CHANNELS) - 1];
+    const uint32_t set = zone->heat_masks[on];
+    REG_WRITE(GPIO_OUT_W1TS_REG, set);
+    REG_WRITE(GPIO_OUT_W1TC_REG, all & ~set);
+}
 
-    double sum = 0.0;
-    for (int i = 0; i < COUNT_OF(CS_PINS); i++) {
-        spi_device_transmit(oven_data.temps[i], &tran);
-        uint16_t raw = (buf[0] << 8) | buf[1];
-        sum += (raw >> 3) * 0.25;
+static bool IRAM_ATTR gate_handler(gptimer_handle_t timer, const gptimer_alarm_event_data_t *event, void *arg) {
+    // raise the gates at the firing angle, drop them a pulse later, the triacs stay latched
+    oven_zone_t *zone = arg;
+    if (zone->fire != CONTROL_FIRE_PHASE) {
+        gptimer_set_alarm_action(timer, NULL); // switched to burst, leave its levels alone
+        return false;
     }
-    return sum / COUNT_OF(CS_PINS); // average all sensors for now
+    zone->gate_on = !zone->gate_on;
+    heaters_set(zone, zone->gate_on ? (1u << PWM_CHANNELS) - 1 : 0);
+    const gptimer_alarm_config_t alarm = {
+        .alarm_count = event->alarm_value + PHASE_PULSE_US,
+    };
+    gptimer_set_alarm_action(timer, zone->gate_on ? &alarm : NULL);
+    return false; // no task woken
+}
+
+static void IRAM_ATTR phase_handler(oven_zone_t *zone) {
+    // the caller drops the gates with everything else
+    uint32_t delay = phase_delay(zone->pwm.duty, oven_data.zcd.period);
+    zone->gate_on = false;
+    gptimer_set_raw_count(zone->gate_timer, 0);
+    const gptimer_alarm_config_t alarm = {
+        .alarm_count = delay,
+    };
+    gptimer_set_alarm_action(zone->gate_timer, (delay != PHASE_OFF) ? &alarm : NULL);
 }
 
 static void IRAM_ATTR pwm_handler(void* arg) {
-    oven_data.pwm_counter++;
-    if (oven_data.pwm_counter >= PWM_PERIOD) {
-        oven_data.pwm_counter = 0;
-        oven_data.pwm_compare = oven_data.pwm_compare_next;
+    uint32_t start = esp_cpu_get_cycle_count();
+    seqlock_write_begin(&oven_data.zcd_lock);
+    // a bounce would otherwise count as a half-cycle, whatever's set or armed stands
+    if (zcd_edge(&oven_data.zcd, esp_timer_get_time()) != ZCD_EDGE_SPURIOUS) {
+        // one heater start per half-cycle over the whole oven, the zones take turns at it,
+        // and every heater switched in one write each to the set/clear registers
+        uint32_t set = 0, all = 0;
+        bool started = false;
+        int first = oven_data.pwm_first;
+        for (int n = 0; n < NUM_ZONES; n++) {
+            oven_zone_t *zone = &oven_data.zones[(first + n) % NUM_ZONES];
+            all |= zone->heat_masks[(1 << PWM_CHANNELS) - 1];
+            if (zone->fire == CONTROL_FIRE_PHASE) {
+                phase_handler(zone);
+            } else {
+                set |= zone->heat_masks[control_pwm_edge(&zone->pwm, &started)];
+            }
+        }
+        oven_data.pwm_first = (first + 1) % NUM_ZONES;
+        REG_WRITE(GPIO_OUT_W1TS_REG, set);
+        REG_WRITE(GPIO_OUT_W1TC_REG, all & ~set);
     }
+    zcd_isr_time(&oven_data.zcd, esp_cpu_get_cycle_count() - start);
+    seqlock_write_end(&oven_data.zcd_lock);
+}
 
-    bool on = oven_data.pwm_counter < oven_data.pwm_compare;
-    for (int i = 0; i < COUNT_OF(HEAT_PINS); i++) {
-        gpio_set_level(HEAT_PINS[i], on);
+static void gate_init(oven_zone_t *zone) {
+    const gptimer_config_t config = {
+        .clk_src       = GPTIMER_CLK_SRC_DEFAULT,
+        .direction     = GPTIMER_COUNT_UP,
+        .resolution_hz = 1000000, // us, same as the phase timing
+    };
+    const gptimer_event_callbacks_t callbacks = {
+        .on_alarm = gate_handler,
+    };
+    gptimer_handle_t timer;
+    esp_err_t err = gptimer_new_timer(&config, &timer);
+    if (err == ESP_OK) {
+        gptimer_register_event_callbacks(timer, &callbacks, zone);
+        gptimer_enable(timer);
+        gptimer_start(timer);
+        zone->gate_timer = timer;
+    } else {
+        ESP_LOGE(TAG, "no gate timer for %s, phase firing unavailable (%s)", zone->config->name, esp_err_to_name(err));
+        zone->fire = CONTROL_FIRE_BURST;
     }
 }
 
 static void pwm_init(void) {
-    oven_data.pwm_counter      = 0;
-    oven_data.pwm_compare      = 0;
-    oven_data.pwm_compare_next = 0;
+    zcd_init(&oven_data.zcd);
+    seqlock_init(&oven_data.zcd_lock);
 
+    for (int z = 0; z < NUM_ZONES; z++) {
+        oven_zone_t *zone = &oven_data.zones[z];
+        const int *pins = zone->config->heat_pins;
+        control_pwm_init(&zone->pwm, z * PWM_CHANNELS, NUM_ZONES * PWM_CHANNELS);
+        gate_init(zone);
+        for (int i = 0; i < PWM_CHANNELS; i++) {
+            if (pins[i] != GPIO_NUM_NC) {
+                gpio_reset_pin(pins[i]);
+                gpio_set_direction(pins[i], GPIO_MODE_INPUT_OUTPUT);
+                gpio_set_drive_capability(pins[i], GPIO_DRIVE_CAP_3);
+                gpio_set_level(pins[i], 0);
+            }
+        }
+        for (uint32_t on = 0; on < COUNT_OF(zone->heat_masks); on++) {
+            zone->heat_masks[on] = 0;
+            for (int i = 0; i < PWM_CHANNELS; i++) {
+                if (pins[i] != GPIO_NUM_NC) {
+                    zone->heat_masks[on] |= ((on >> i) & 1) << pins[i];
+                }
+            }
+        }
+    }
+
+    // in IRAM so flash writes (NVS) don't hold off zero crosses
     gpio_reset_pin(ZCD_PIN);
     gpio_set_direction(ZCD_PIN, GPIO_MODE_INPUT);
     gpio_set_pull_mode(ZCD_PIN, GPIO_PULLUP_ONLY);
     gpio_set_intr_type(ZCD_PIN, GPIO_INTR_NEGEDGE);
-    gpio_install_isr_service(0);
+    gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
     gpio_isr_handler_add(ZCD_PIN, pwm_handler, NULL);
+}
+
+static void pwm_set(oven_zone_t *zone, real_t duty) {
+    // one aligned word, the ISR picks it up on the next zero cross
+    zone->pwm.duty = control_pwm_duty(duty);
+}
+
+static void commands_apply(void) {
+    command_t cmd;
+    while (command_pop(&oven_data.commands, &cmd)) {
+        oven_zone_t *zone = &oven_data.zones[cmd.zone];
+        bool ok;
+        if (cmd.type == COMMAND_PROFILE_REMOVE && zones_busy()) {
+            ok = false; // types shift, and another zone's run or queue may use one
+        } else {
+            ok = command_apply(&zone->ctrl, &zone->queue, &cmd);
+        }
+        if (ok && cmd.type == COMMAND_START) {
+            zone->start = xTaskGetTickCount();
+        }
+        oven_data.reply_id = cmd.id;
+        oven_data.reply_ok = ok;
+        xSemaphoreGive(oven_data.reply); // never blocks
+    }
+}
+
+static bool command_send(command_t *cmd) {
+    // waits for the oven task to apply it, returns whether it was accepted
+    xSemaphoreTake(oven_data.client_lock, portMAX_DELAY);
+    cmd->id = ++oven_data.next_id;
+    bool ok = command_push(&oven_data.commands, cmd);
+    while (ok) {
+        if (xSemaphoreTake(oven_data.reply, pdMS_TO_TICKS(REPLY_TIMEOUT_MS)) != pdTRUE) {
+            ok = false;
+        } else if (oven_data.reply_id == cmd->id) { // else a reply someone gave up on
+            ok = oven_data.reply_ok;
+            break;
+        }
+    }
+    xSemaphoreGive(oven_data.client_lock);
+    return ok;
+}
+
+static void snapshot_publish(oven_zone_t *zone) {
+    const control_t *ctrl = &zone->ctrl;
+    oven_snapshot_t *snap = &zone->snapshot;
+    seqlock_write_begin(&zone->snapshot_lock);
+    snap->status.current = ctrl->current;
+    snap->status.target  = ctrl->target;
+    snap->status.running = ctrl->running;
+    snap->status.tuning  = ctrl->tune.state == AUTOTUNE_RUNNING;
+    snap->status.rate    = zone->filter.rate;
+    snap->status.faulted = zone->faulted;
+    snap->status.seq     = zone->history.seq;
+    snap->status.profile = ctrl->cursor.type;
+    snap->status.mode    = ctrl->mode;
+    snap->status.kp      = ctrl->pid.kp;
+    snap->status.ki      = ctrl->pid.ki;
+    snap->status.kd      = ctrl->pid.kd;
+    snap->status.gains   = ctrl->gains;
+    snap->status.phase   = ctrl->phase;
+    snap->status.quality = ctrl->analytics.result;
+    snap->status.plant    = ctrl->ident.model;
+    snap->status.eta      = ctrl->eta;
+    snap->status.cooldown = ctrl->cooldown;
+    snap->status.cycles_max = zone->zone_cycles_max;
+    snap->status.trips      = zone->trips;
 
-    for (int i = 0; i < COUNT_OF(HEAT_PINS); i++) {
-        gpio_reset_pin(HEAT_PINS[i]);
-        gpio_set_direction(HEAT_PINS[i], GPIO_MODE_INPUT_OUTPUT);
-        gpio_set_drive_capability(HEAT_PINS[i], GPIO_DRIVE_CAP_3);
-        gpio_set_level(HEAT_PINS[i], 0);
+    snap->status.num_sensors = zone->config->num_cs;
+    for (int i = 0; i < zone->config->num_cs; i++) {
+        snap->status.sensors[i] = zone->readings[i];
     }
+    snap->tune  = ctrl->tune;
+    snap->queue = zone->queue;
+    seqlock_write_end(&zone->snapshot_lock);
 }
 
-static void pwm_set(double duty) {
-    int c = round(LIMIT(duty, 0.0, 1.0) * PWM_PERIOD);
-    taskENTER_CRITICAL(NULL);
-    oven_data.pwm_compare_next = c;
-    taskEXIT_CRITICAL(NULL);
+static void trace_record(const oven_zone_t *zone) {
+    // a struct copy into the ring, formatting happens on the console side
+    const control_t *ctrl = &zone->ctrl;
+    trace_record_t rec = {
+        .seq    = oven_data.tick,
+        .time   = xTaskGetTickCount() * portTICK_PERIOD_MS,
+        .temp   = ctrl->current,
+        .target = ctrl->target,
+        .p      = ctrl->pid.p,
+        .i      = ctrl->pid.i,
+        .d      = ctrl->pid.d,
+        .ff     = ctrl->ff,
+        .duty   = ctrl->duty,
+        .pwm    = zone->pwm.duty,
+        .flags  = (ctrl->running ? TRACE_RUNNING : 0)
+                | (ctrl->tune.state == AUTOTUNE_RUNNING ? TRACE_TUNING : 0)
+                | (zone->faulted ? TRACE_FAULTED : 0)
+                | (ctrl->pid.held ? TRACE_INT_HELD : 0),
+    };
+    memcpy(rec.raw, zone->raw, sizeof(rec.raw));
+    trace_push(&oven_data.trace, &rec);
+}
+
+static void zone_step(oven_zone_t *zone) {
+    // one control tick of one zone, same for all of them
+    uint32_t zone_start = esp_cpu_get_cycle_count();
+    bool faulted = !temp_update(zone);
+    bool tripped = faulted && !zone->faulted && zone->ctrl.running;
+    if (faulted) {
+        control_stop(&zone->ctrl); // no trustworthy sensor left, heaters off
+        queue_clear(&zone->queue); // and nothing more starts on its own
+    }
+    zone->faulted = faulted;
+    zone->trips  += tripped; // logged by events_thread, the console could block this task
+    real_t elapsed = (real_t) (xTaskGetTickCount() - zone->start) * (portTICK_PERIOD_MS / 1000.0f);
+    real_t age     = faulted ? 0.0f : (real_t) (esp_timer_get_time() - zone->sample_time) * 1e-6f; // between samples
+    real_t temp    = sensor_estimate(&zone->filter, age);
+    uint32_t start = esp_cpu_get_cycle_count();
+    control_step(&zone->ctrl, temp, elapsed);
+    zone->step_cycles = esp_cpu_get_cycle_count() - start;
+    if (zone->step_cycles > zone->step_cycles_max) {
+        zone->step_cycles_max = zone->step_cycles;
+    }
+    profile_type_t next;
+    if (queue_step(&zone->queue, &zone->ctrl, xTaskGetTickCount() * (portTICK_PERIOD_MS / 1000.0f), &next)) {
+        control_start(&zone->ctrl, next); // heaters come on with the next tick's step, counted in queue.runs
+        zone->start = xTaskGetTickCount();
+    }
+    real_t duty = zone->ctrl.duty;
+    const history_sample_t sample = {
+        .time    = xTaskGetTickCount() * portTICK_PERIOD_MS,
+        .current = zone->ctrl.current,
+        .target  = zone->ctrl.target,
+        .duty    = duty,
+    };
+    seqlock_write_begin(&zone->history_lock);
+    history_push(&zone->history, &sample);
+    seqlock_write_end(&zone->history_lock);
+    snapshot_publish(zone);
+
+    pwm_set(zone, duty);
+    if (oven_data.tracing && zone->idx == oven_data.trace_zone) {
+        trace_record(zone);
+    }
+    zone->zone_cycles = esp_cpu_get_cycle_count() - zone_start;
+    if (zone->zone_cycles > zone->zone_cycles_max) {
+        zone->zone_cycles_max = zone->zone_cycles;
+    }
 }
 
 static void oven_thread(void *arg) {
-    temp_init();
     pwm_init();
-    ESP_LOGI(TAG, "oven initialized!");
+    ESP_LOGI(TAG, "oven initialized, %d zones!", (int) NUM_ZONES);
 
     TickType_t wait = xTaskGetTickCount();
+    int64_t last = -1;
     while (true) {
-        double temp = temp_get();
+        int64_t woke = esp_timer_get_time();
+        if (last >= 0) {
+            metrics_observe(&oven_data.tick_jitter, llabs(woke - last - CONTROL_PERIOD_MS * 1000));
+        }
+        last = woke;
 
-        profile_status_t target = {
-            .temp = ROOM_TEMP,
-            .done = true,
-        };
-        xSemaphoreTake(oven_data.lock, portMAX_DELAY);
-        oven_data.status.current = temp;
-        if (oven_data.status.running) {
-            double elapsed = (xTaskGetTickCount() - oven_data.start) / (portTICK_PERIOD_MS * 1000.0);
-            target = profile_status(oven_data.type, elapsed);
-            oven_data.status.target  = target.temp;
-            oven_data.status.running = !target.done;
-        }
-        xSemaphoreGive(oven_data.lock);
-
-        if (target.done) {
-            oven_data.int_err  = 0.0;
-            oven_data.prev_err = 0.0;
-            pwm_set(0.0);
-        } else {
-            double err         = target.temp - temp;
-            double delta_err   = (err -  oven_data.prev_err) / CONTROL_PERIOD;
-            oven_data.int_err  = oven_data.int_err + err * CONTROL_PERIOD;
-            oven_data.int_err  = LIMIT(oven_data.int_err, 0.0, 1.0 / oven_data.ki); // anti-windup, limit to 100%
-            oven_data.prev_err = err;
+        commands_apply();
+        for (int z = 0; z < NUM_ZONES; z++) {
+            zone_step(&oven_data.zones[z]);
+        }
+        oven_data.tick++;
 
-            pwm_set(
-                LIMIT(oven_data.kp * err,               -1.0, 1.0) +
-                LIMIT(oven_data.ki * oven_data.int_err, -1.0, 1.0) +
-                LIMIT(oven_data.kd * delta_err,         -1.0, 1.0)
-            );
+        if (oven_data.listener) {
+            oven_data.listener(oven_data.listener_arg);
         }
 
-        vTaskDelayUntil(&wait, (CONTROL_PERIOD * 1000) / portTICK_PERIOD_MS);
+        metrics_observe(&oven_data.tick_time, esp_timer_get_time() - woke);
+        if (xTaskDelayUntil(&wait, pdMS_TO_TICKS(CONTROL_PERIOD_MS)) == pdFALSE) {
+            oven_data.overruns++; // already past the next wake time
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+static void events_thread(void *arg) {
+    // logs what the oven task only counts, from the published snapshots
+    uint32_t trips[NUM_ZONES], runs[NUM_ZONES];
+    for (int z = 0; z < NUM_ZONES; z++) {
+        trips[z] = 0;
+        runs[z]  = 0;
+    }
+    while (true) {
+        vTaskDelay(EVENTS_POLL_MS / portTICK_PERIOD_MS);
+        for (int z = 0; z < NUM_ZONES; z++) {
+            oven_status_t status;
+            queue_t queue;
+            oven_status(z, &status);
+            oven_queue_status(z, &queue);
+            if (status.trips != trips[z]) {
+                ESP_LOGE(TAG, "%s: all thermocouples faulted, stopped", ZONES[z].name);
+                trips[z] = status.trips;
+            }
+            if (queue.runs != runs[z]) {
+                ESP_LOGI(TAG, "%s: queue started %s, %u more", ZONES[z].name, profile_name(status.profile),
+                    (unsigned) queue_pending(&queue));
+                runs[z] = queue.runs;
+            }
+        }
     }
     vTaskDelete(NULL);
 }
 
-static void pid_set(const char *kp, const char *ki, const char *kd) {
-    oven_data.kp = atof(kp);
-    oven_data.ki = atof(ki);
-    oven_data.kd = atof(kd);
-    ESP_LOGI(TAG, "PID kp: %.5f ki: %.5f kd: %.5f", oven_data.kp, oven_data.ki, oven_data.kd);
+static void pid_load(oven_zone_t *zone) {
+    // before the oven task starts, so straight into ctrl
+    pid_gains_t gains = {
+        .kp = atof(CONFIG_PID_KP),
+        .ki = atof(CONFIG_PID_KI),
+        .kd = atof(CONFIG_PID_KD),
+    };
+    char key[KEY_LEN];
+    zone_key(key, PID_KEY, zone->idx);
+    pid_gains_t stored;
+    size_t len = sizeof(stored);
+    bool ok = settings_get(key, &stored, &len) == ESP_OK && len == sizeof(stored);
+    if (ok) {
+        gains = stored;
+    }
+    control_pid_set(&zone->ctrl, gains.kp, gains.ki, gains.kd);
+    ESP_LOGI(TAG, "%s PID kp: %.5f ki: %.5f kd: %.5f%s", zone->config->name, gains.kp, gains.ki, gains.kd,
+        ok ? " (stored)" : "");
+}
+
+static void pid_save(int zone, const pid_gains_t *gains) {
+    char key[KEY_LEN];
+    zone_key(key, PID_KEY, zone);
+    esp_err_t err = settings_set(key, gains, sizeof(*gains));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "failed to save PID (%s)", esp_err_to_name(err));
+    }
 }
 
 static int pid_set_command(int argc, char **argv) {
+    int zone;
     if (arg_parse(argc, argv, (void**) &oven_data.pid_set_args) != 0) {
         arg_print_errors(stderr, oven_data.pid_set_args.end, argv[0]);
         return 1;
     }
-    pid_set(
-        oven_data.pid_set_args.kp->sval[0],
-        oven_data.pid_set_args.ki->sval[0],
-        oven_data.pid_set_args.kd->sval[0]
-    );
+    if (!zone_arg(oven_data.pid_set_args.zone, &zone)) {
+        return 1;
+    }
+    bool ok = oven_pid_set(zone, atof(oven_data.pid_set_args.kp->sval[0]),
+        atof(oven_data.pid_set_args.ki->sval[0]), atof(oven_data.pid_set_args.kd->sval[0]));
+    return ok ? 0 : 1;
+}
+
+static void sched_load(oven_zone_t *zone) {
+    // before the oven task starts, so straight into ctrl
+    char key[KEY_LEN];
+    zone_key(key, SCHED_KEY, zone->idx);
+    sched_stored_t stored;
+    size_t len = sizeof(stored);
+    if (settings_get(key, &stored, &len) != ESP_OK || len != sizeof(stored) || stored.version != STORED_VERSION) {
+        return;
+    }
+    control_sched_t sched = { .num = stored.num };
+    for (size_t i = 0; i < CONTROL_SCHED_MAX; i++) {
+        const sched_entry_stored_t *entry = &stored.entries[i];
+        sched.entries[i] = (control_sched_entry_t) {
+            .temp  = entry->temp,
+            .gains = { entry->kp, entry->ki, entry->kd },
+            .phase = entry->phase,
+        };
+    }
+    if (control_sched_set(&zone->ctrl, &sched)) {
+        zone->sched = zone->ctrl.sched;
+        ESP_LOGI(TAG, "%s gain schedule: %d entries", zone->config->name, sched.num);
+    } else {
+        ESP_LOGE(TAG, "%s stored gain schedule invalid, ignoring", zone->config->name);
+    }
+}
+
+static int sched_command(int argc, char **argv) {
+    int zone;
+    if (arg_parse(argc, argv, (void**) &oven_data.sched_args) != 0) {
+        arg_print_errors(stderr, oven_data.sched_args.end, argv[0]);
+        return 1;
+    }
+    if (!zone_arg(oven_data.sched_args.zone, &zone)) {
+        return 1;
+    }
+    // edits one entry of the current table, or lists it
+    control_sched_t sched;
+    oven_sched_get(zone, &sched);
+    bool changed = oven_data.sched_args.clear->count > 0;
+    if (changed) {
+        sched.num = 0;
+    }
+    if (oven_data.sched_args.phase->count) {
+        uint8_t phase = CONTROL_PHASE_ANY;
+        while (strcmp(oven_data.sched_args.phase->sval[0], control_phase_name(phase)) != 0) {
+            if (++phase > CONTROL_PHASE_COOL) {
+                ESP_LOGE(TAG, "unknown phase");
+                return 1;
+            }
+        }
+        int gains = oven_data.sched_args.kp->count + oven_data.sched_args.ki->count + oven_data.sched_args.kd->count;
+        if (!oven_data.sched_args.temp->count || (gains != 0 && gains != 3)) {
+            ESP_LOGE(TAG, "need a temp, and all three gains to set an entry");
+            return 1;
+        }
+        real_t temp = atof(oven_data.sched_args.temp->sval[0]);
+        size_t i = 0;
+        while (i < sched.num && (sched.entries[i].phase != phase || sched.entries[i].temp != temp)) {
+            i++;
+        }
+        if (gains) {
+            if (i == CONTROL_SCHED_MAX) {
+                ESP_LOGE(TAG, "gain schedule full");
+                return 1;
+            }
+            sched.entries[i] = (control_sched_entry_t) {
+                .phase    = phase,
+                .temp     = temp,
+                .gains.kp = atof(oven_data.sched_args.kp->sval[0]),
+                .gains.ki = atof(oven_data.sched_args.ki->sval[0]),
+                .gains.kd = atof(oven_data.sched_args.kd->sval[0]),
+            };
+            sched.num += (i == sched.num);
+        } else if (i < sched.num) {
+            sched.entries[i] = sched.entries[--sched.num]; // sorted again when set
+        } else {
+            ESP_LOGE(TAG, "no such entry");
+            return 1;
+        }
+        changed = true;
+    }
+    if (changed && !oven_sched_set(zone, &sched)) {
+        return 1;
+    }
+    oven_sched_get(zone, &sched);
+
+    oven_status_t status;
+    oven_status(zone, &status);
+    ESP_LOGI(TAG, "set outright kp: %.5f ki: %.5f kd: %.5f, in use (%s) kp: %.5f ki: %.5f kd: %.5f",
+        status.gains.kp, status.gains.ki, status.gains.kd, control_phase_name(status.phase),
+        status.kp, status.ki, status.kd);
+    for (size_t i = 0; i < sched.num; i++) {
+        const control_sched_entry_t *entry = &sched.entries[i];
+        ESP_LOGI(TAG, "%-4s %6.1fC kp: %.5f ki: %.5f kd: %.5f", control_phase_name(entry->phase), entry->temp,
+            entry->gains.kp, entry->gains.ki, entry->gains.kd);
+    }
+    return 0;
+}
+
+static void model_load(oven_zone_t *zone) {
+    control_model_t model = {
+        .gain  = atof(CONFIG_MODEL_GAIN),
+        .tau   = atof(CONFIG_MODEL_TAU),
+        .delay = atof(CONFIG_MODEL_DELAY),
+    };
+    char key[KEY_LEN];
+    zone_key(key, MODEL_KEY, zone->idx);
+    model_stored_t stored;
+    size_t len = sizeof(stored);
+    if (settings_get(key, &stored, &len) == ESP_OK && len == sizeof(stored) && stored.version == STORED_VERSION) {
+        model = (control_model_t) {
+            .gain  = stored.gain,
+            .tau   = stored.tau,
+            .delay = stored.delay,
+        };
+    }
+    control_model_set(&zone->ctrl, &model);
+    ESP_LOGI(TAG, "%s model gain: %.1fC tau: %.1fs delay: %.1fs", zone->config->name,
+        model.gain, model.tau, model.delay);
+
+    uint8_t mode;
+    len = sizeof(mode);
+    zone_key(key, MODE_KEY, zone->idx);
+    if (settings_get(key, &mode, &len) == ESP_OK && len == sizeof(mode) && mode <= CONTROL_MODE_FEEDFORWARD) {
+        control_mode_set(&zone->ctrl, mode);
+    }
+    ESP_LOGI(TAG, "%s mode: %s", zone->config->name, control_mode_name(zone->ctrl.mode));
+}
+
+static int model_command(int argc, char **argv) {
+    int zone;
+    if (arg_parse(argc, argv, (void**) &oven_data.model_args) != 0) {
+        arg_print_errors(stderr, oven_data.model_args.end, argv[0]);
+        return 1;
+    }
+    if (!zone_arg(oven_data.model_args.zone, &zone)) {
+        return 1;
+    }
+    command_t cmd = {
+        .type        = COMMAND_MODEL,
+        .zone        = zone,
+        .model.gain  = atof(oven_data.model_args.gain->sval[0]),
+        .model.tau   = atof(oven_data.model_args.tau->sval[0]),
+        .model.delay = atof(oven_data.model_args.delay->sval[0]),
+    };
+    const control_model_t model = cmd.model;
+    if (model.gain <= 0.0 || model.tau < 0.0 || model.delay < 0.0) {
+        ESP_LOGE(TAG, "bad model");
+        return 1;
+    }
+    if (!command_send(&cmd)) {
+        return 1;
+    }
+    ESP_LOGI(TAG, "model gain: %.1fC tau: %.1fs delay: %.1fs", model.gain, model.tau, model.delay);
+
+    const model_stored_t stored = {
+        .version = STORED_VERSION,
+        .gain    = model.gain,
+        .tau     = model.tau,
+        .delay   = model.delay,
+    };
+    char key[KEY_LEN];
+    zone_key(key, MODEL_KEY, zone);
+    esp_err_t err = settings_set(key, &stored, sizeof(stored));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "failed to save model (%s)", esp_err_to_name(err));
+    }
+    return 0;
+}
+
+static int mode_command(int argc, char **argv) {
+    int zone;
+    if (arg_parse(argc, argv, (void**) &oven_data.mode_args) != 0) {
+        arg_print_errors(stderr, oven_data.mode_args.end, argv[0]);
+        return 1;
+    }
+    if (!zone_arg(oven_data.mode_args.zone, &zone)) {
+        return 1;
+    }
+    uint8_t mode = CONTROL_MODE_PID;
+    while (strcmp(oven_data.mode_args.mode->sval[0], control_mode_name(mode)) != 0) {
+        if (++mode > CONTROL_MODE_FEEDFORWARD) {
+            ESP_LOGE(TAG, "unknown mode");
+            return 1;
+        }
+    }
+    command_t cmd = {
+        .type = COMMAND_MODE,
+        .zone = zone,
+        .mode = mode,
+    };
+    if (!command_send(&cmd)) {
+        return 1;
+    }
+    ESP_LOGI(TAG, "mode: %s", control_mode_name(mode));
+
+    char key[KEY_LEN];
+    zone_key(key, MODE_KEY, zone);
+    esp_err_t err = settings_set(key, &mode, sizeof(mode));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "failed to save mode (%s)", esp_err_to_name(err));
+    }
+    return 0;
+}
+
+static void fire_load(oven_zone_t *zone) {
+    char key[KEY_LEN];
+    zone_key(key, FIRE_KEY, zone->idx);
+    uint8_t fire;
+    size_t len = sizeof(fire);
+    if (settings_get(key, &fire, &len) == ESP_OK && len == sizeof(fire) && fire <= CONTROL_FIRE_PHASE) {
+        zone->fire = fire;
+    }
+    ESP_LOGI(TAG, "%s firing: %s", zone->config->name, control_fire_name(zone->fire));
+}
+
+static int fire_command(int argc, char **argv) {
+    int idx;
+    if (arg_parse(argc, argv, (void**) &oven_data.fire_args) != 0) {
+        arg_print_errors(stderr, oven_data.fire_args.end, argv[0]);
+        return 1;
+    }
+    if (!zone_arg(oven_data.fire_args.zone, &idx)) {
+        return 1;
+    }
+    oven_zone_t *zone = &oven_data.zones[idx];
+    uint8_t fire = CONTROL_FIRE_BURST;
+    while (strcmp(oven_data.fire_args.fire->sval[0], control_fire_name(fire)) != 0) {
+        if (++fire > CONTROL_FIRE_PHASE) {
+            ESP_LOGE(TAG, "unknown firing mode");
+            return 1;
+        }
+    }
+    if (fire == CONTROL_FIRE_PHASE && !zone->gate_timer) {
+        ESP_LOGE(TAG, "phase firing unavailable");
+        return 1;
+    }
+    // one word read by the zero cross ISR, takes over on the next edge
+    zone->fire = fire;
+    ESP_LOGI(TAG, "firing: %s", control_fire_name(fire));
+
+    char key[KEY_LEN];
+    zone_key(key, FIRE_KEY, idx);
+    esp_err_t err = settings_set(key, &fire, sizeof(fire));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "failed to save firing mode (%s)", esp_err_to_name(err));
+    }
+    return 0;
+}
+
+static void queue_load(oven_zone_t *zone) {
+    // only the start temperature, jobs don't outlive a reboot so nothing starts unattended
+    queue_init(&zone->queue, CONTROL_SAFE_TEMP);
+    char key[KEY_LEN];
+    zone_key(key, QUEUE_KEY, zone->idx);
+    float temp;
+    size_t len = sizeof(temp);
+    if (settings_get(key, &temp, &len) == ESP_OK && len == sizeof(temp)) {
+        queue_temp_set(&zone->queue, temp);
+    }
+    ESP_LOGI(TAG, "%s queue starts below %.1fC", zone->config->name, zone->queue.start_temp);
+}
+
+static int queue_command(int argc, char **argv) {
+    int zone;
+    if (arg_parse(argc, argv, (void**) &oven_data.queue_args) != 0) {
+        arg_print_errors(stderr, oven_data.queue_args.end, argv[0]);
+        return 1;
+    }
+    if (!zone_arg(oven_data.queue_args.zone, &zone)) {
+        return 1;
+    }
+    if (oven_data.queue_args.clear->count) {
+        oven_queue_clear(zone);
+    }
+    if (oven_data.queue_args.temp->count && !oven_queue_temp(zone, atof(oven_data.queue_args.temp->sval[0]))) {
+        return 1;
+    }
+    if (oven_data.queue_args.profile->count) {
+        int count  = oven_data.queue_args.count->count ? oven_data.queue_args.count->ival[0] : 1;
+        int boards = oven_data.queue_args.boards->count ? oven_data.queue_args.boards->ival[0] : 1;
+        if (count <= 0 || count > UINT16_MAX || boards <= 0 || boards > UINT16_MAX ||
+            !oven_queue_add(zone, oven_data.queue_args.profile->ival[0], count, boards)) {
+            return 1;
+        }
+    }
+
+    queue_t queue;
+    oven_queue_status(zone, &queue);
+    ESP_LOGI(TAG, "%s queue %s, starts below %.1fC, %u runs started", ZONES[zone].name,
+        queue_state_name(queue.state), queue.start_temp, (unsigned) queue.runs);
+    for (int i = 0; i < queue.num; i++) {
+        const queue_job_t *job = &queue.jobs[i];
+        ESP_LOGI(TAG, "%d %-10s %u/%u runs, %u boards each", i, profile_name(job->profile),
+            job->done, job->count, job->boards);
+    }
+    ESP_LOGI(TAG, "next in %.0fs, cycle %.0fs (predicted %.0fs), %.1f boards/h", queue.wait, queue.cycle,
+        queue.predicted, queue_throughput(&queue));
+    return 0;
+}
+
+static int zones_command(int argc, char **argv) {
+    // what each zone costs the oven task, and how many of the worst would fit in a tick
+    const uint32_t budget = CONTROL_PERIOD_MS * 1000 * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    uint32_t worst = 1;
+    for (int z = 0; z < NUM_ZONES; z++) {
+        oven_status_t status;
+        oven_status(z, &status);
+        const oven_zone_t *zone = &oven_data.zones[z];
+        ESP_LOGI(TAG, "%d %-6s %s %6.1fC -> %6.1fC, %u sensors, step %u cycles, zone %u max %u",
+            z, zone->config->name, status.faulted ? "faulted" : status.running ? "running" : "idle",
+            status.current, status.target, (unsigned) status.num_sensors, (unsigned) zone->step_cycles_max,
+            (unsigned) zone->zone_cycles, (unsigned) status.cycles_max);
+        if (status.cycles_max > worst) {
+            worst = status.cycles_max;
+        }
+    }
+    ESP_LOGI(TAG, "%u cycles a tick, room for %u zones like the worst (%u configured, %d at most)",
+        (unsigned) budget, (unsigned) (budget / worst), (unsigned) NUM_ZONES, OVEN_MAX_ZONES);
+    return 0;
+}
+
+static int zcd_command(int argc, char **argv) {
+    zcd_t zcd;
+    oven_zcd_status(&zcd);
+    ESP_LOGI(TAG, "mains %.2fHz (%uus half-cycle), %u edges, %u spurious, %u missed",
+        500000.0 / zcd.period, (unsigned) zcd.period, (unsigned) zcd.edges,
+        (unsigned) zcd.spurious, (unsigned) zcd.missed);
+    for (int i = 0; i < ZCD_JITTER_LEN; i++) {
+        if (i < ZCD_JITTER_LEN - 1) {
+            ESP_LOGI(TAG, "jitter < %4uus: %u", (unsigned) zcd_jitter_bound(i), (unsigned) zcd.jitter[i]);
+        } else {
+            ESP_LOGI(TAG, "jitter >=%4uus: %u", (unsigned) zcd_jitter_bound(i - 1), (unsigned) zcd.jitter[i]);
+        }
+    }
+    double mean = zcd.isr_count ? (double) zcd.isr_sum / zcd.isr_count : 0.0;
+    ESP_LOGI(TAG, "isr mean %.2fus max %.2fus",
+        mean / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, (double) zcd.isr_max / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    return 0;
+}
+
+static void trace_drain(uint32_t *sent) {
+    // frames out in batches, a host that stops reading only costs this task time
+    uint8_t buf[TRACE_BATCH * TRACE_FRAME_LEN];
+    size_t len = 0;
+    trace_record_t rec;
+    while (trace_pop(&oven_data.trace, &rec)) {
+        len += trace_frame(&rec, &buf[len]);
+        if (len + TRACE_FRAME_LEN > sizeof(buf)) {
+            usb_serial_jtag_write_bytes(buf, len, pdMS_TO_TICKS(CONTROL_PERIOD_MS));
+            len = 0;
+        }
+        (*sent)++;
+    }
+    if (len > 0) {
+        usb_serial_jtag_write_bytes(buf, len, pdMS_TO_TICKS(CONTROL_PERIOD_MS));
+    }
+}
+
+static int trace_command(int argc, char **argv) {
+    int zone;
+    if (arg_parse(argc, argv, (void**) &oven_data.trace_args) != 0) {
+        arg_print_errors(stderr, oven_data.trace_args.end, argv[0]);
+        return 1;
+    }
+    if (!zone_arg(oven_data.trace_args.zone, &zone)) {
+        return 1;
+    }
+    const char *seconds = oven_data.trace_args.seconds->count ? oven_data.trace_args.seconds->sval[0] : TRACE_SECONDS;
+    int ticks = atof(seconds) * 1000 / CONTROL_PERIOD_MS;
+    if (ticks <= 0) {
+        ESP_LOGE(TAG, "invalid trace length");
+        return 1;
+    }
+
+    // leftovers from an earlier trace are stale, only the console task pops
+    trace_record_t rec;
+    while (trace_pop(&oven_data.trace, &rec)) {
+    }
+    uint32_t dropped = trace_dropped(&oven_data.trace);
+    uint32_t sent    = 0;
+    fflush(stdout);
+    oven_data.trace_zone = zone;
+    oven_data.tracing    = true;
+    for (int i = 0; i < ticks; i++) {
+        vTaskDelay(pdMS_TO_TICKS(CONTROL_PERIOD_MS));
+        trace_drain(&sent);
+    }
+    oven_data.tracing = false;
+    vTaskDelay(pdMS_TO_TICKS(CONTROL_PERIOD_MS)); // a tick may have been mid push
+    trace_drain(&sent);
+
+    ESP_LOGI(TAG, "trace sent %u records, dropped %u",
+        (unsigned) sent, (unsigned) (trace_dropped(&oven_data.trace) - dropped));
     return 0;
 }
 
+static void tune_thread(void *arg) {
+    // the oven task never touches flash, so the result is saved from here
+    int zone = (intptr_t) arg;
+    autotune_t tune;
+    do {
+        vTaskDelay(TUNE_POLL_MS / portTICK_PERIOD_MS);
+        oven_autotune_status(zone, &tune);
+    } while (tune.state == AUTOTUNE_RUNNING);
+
+    if (tune.state == AUTOTUNE_DONE) {
+        ESP_LOGI(TAG, "autotune ku: %.5f pu: %.1fs, PID kp: %.5f ki: %.5f kd: %.5f",
+            tune.ku, tune.pu, tune.kp, tune.ki, tune.kd);
+        const pid_gains_t gains = {
+            .kp = tune.kp,
+            .ki = tune.ki,
+            .kd = tune.kd,
+        };
+        pid_save(zone, &gains);
+    } else {
+        ESP_LOGW(TAG, "autotune %s", autotune_state_name(tune.state));
+    }
+    vTaskDelete(NULL);
+}
+
+static int autotune_command(int argc, char **argv) {
+    int zone;
+    if (arg_parse(argc, argv, (void**) &oven_data.autotune_args) != 0) {
+        arg_print_errors(stderr, oven_data.autotune_args.end, argv[0]);
+        return 1;
+    }
+    if (!zone_arg(oven_data.autotune_args.zone, &zone)) {
+        return 1;
+    }
+    const char *temp = oven_data.autotune_args.temp->count ? oven_data.autotune_args.temp->sval[0] : TUNE_TEMP;
+    return oven_autotune(zone, atof(temp)) ? 0 : 1;
+}
+
+static void profiles_load(void) {
+    // compiled table, so a single read and no parsing
+    size_t len = 0;
+    if (settings_get(PROFILES_KEY, NULL, &len) != ESP_OK || len == 0) {
+        return;
+    }
+    void *buf = malloc(len);
+    if (buf && settings_get(PROFILES_KEY, buf, &len) == ESP_OK) {
+        if (profile_import(buf, len)) {
+            ESP_LOGI(TAG, "loaded %d user profiles", (int) (profile_count() - PROFILE_BUILTIN_COUNT));
+        } else {
+            ESP_LOGE(TAG, "stored profiles corrupt, ignoring");
+        }
+    }
+    free(buf);
+}
+
+static bool profiles_write(const void *buf, size_t len) {
+    esp_err_t err = (len > 0) ? settings_set(PROFILES_KEY, buf, len) : ESP_ERR_NO_MEM;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "failed to save profiles (%s)", esp_err_to_name(err));
+    }
+    return err == ESP_OK;
+}
+
+static bool profiles_save(void) {
+    void *buf = malloc(PROFILES_MAX_LEN);
+    if (buf == NULL) {
+        return false;
+    }
+    xSemaphoreTake(oven_data.client_lock, portMAX_DELAY);
+    size_t len = profile_export(buf, PROFILES_MAX_LEN);
+    xSemaphoreGive(oven_data.client_lock);
+
+    // flash write outside the lock so other clients don't wait on it
+    bool ok = profiles_write(buf, len);
+    free(buf);
+    return ok;
+}
+
 /* public functions */
 void oven_init(void) {
     oven_data.pid_set_args.kp  = arg_str1(NULL, NULL, "<kp>", "kp");
     oven_data.pid_set_args.ki  = arg_str1(NULL, NULL, "<ki>", "ki");
     oven_data.pid_set_args.kd  = arg_str1(NULL, NULL, "<kd>", "kd");
+    oven_data.pid_set_args.zone = arg_int0("z", "zone", "<n>", "zone, default 0");
     oven_data.pid_set_args.end = arg_end(10);
     const esp_console_cmd_t pid_set_cmd = {
         .command  = "pid",
@@ -212,41 +1234,484 @@ void oven_init(void) {
     };
     esp_console_cmd_register(&pid_set_cmd);
 
-    pid_set(CONFIG_PID_KP, CONFIG_PID_KI, CONFIG_PID_KD); // TODO autotune
+    oven_data.sched_args.clear = arg_lit0("c", "clear", "remove every entry first");
+    oven_data.sched_args.phase = arg_str0(NULL, NULL, "<any|ramp|hold|cool>", "profile phase of the entry");
+    oven_data.sched_args.temp  = arg_str0(NULL, NULL, "<temp>", "target temp of the entry in C");
+    oven_data.sched_args.kp    = arg_str0(NULL, NULL, "<kp>", "kp, leave the gains out to remove the entry");
+    oven_data.sched_args.ki    = arg_str0(NULL, NULL, "<ki>", "ki");
+    oven_data.sched_args.kd    = arg_str0(NULL, NULL, "<kd>", "kd");
+    oven_data.sched_args.zone  = arg_int0("z", "zone", "<n>", "zone, default 0");
+    oven_data.sched_args.end   = arg_end(10);
+    const esp_console_cmd_t sched_cmd = {
+        .command  = "sched",
+        .help     = "show or edit the PID gain schedule",
+        .hint     = NULL,
+        .func     = sched_command,
+        .argtable = &oven_data.sched_args,
+    };
+    esp_console_cmd_register(&sched_cmd);
+
+    oven_data.trace_args.seconds = arg_str0(NULL, NULL, "<seconds>", "capture length, default " TRACE_SECONDS);
+    oven_data.trace_args.zone    = arg_int0("z", "zone", "<n>", "zone, default 0");
+    oven_data.trace_args.end     = arg_end(10);
+    const esp_console_cmd_t trace_cmd = {
+        .command  = "trace",
+        .help     = "stream binary control loop records, decode with sim/trace_decode",
+        .hint     = NULL,
+        .func     = trace_command,
+        .argtable = &oven_data.trace_args,
+    };
+    esp_console_cmd_register(&trace_cmd);
+
+    oven_data.autotune_args.temp = arg_str0(NULL, NULL, "<temp>", "setpoint in C, default " TUNE_TEMP);
+    oven_data.autotune_args.zone = arg_int0("z", "zone", "<n>", "zone, default 0");
+    oven_data.autotune_args.end  = arg_end(10);
+    const esp_console_cmd_t autotune_cmd = {
+        .command  = "autotune",
+        .help     = "relay autotune PID constants and save them",
+        .hint     = NULL,
+        .func     = autotune_command,
+        .argtable = &oven_data.autotune_args,
+    };
+    esp_console_cmd_register(&autotune_cmd);
+
+    oven_data.model_args.gain  = arg_str1(NULL, NULL, "<gain>", "rise above ambient at full power in C");
+    oven_data.model_args.tau   = arg_str1(NULL, NULL, "<tau>", "time constant in s");
+    oven_data.model_args.delay = arg_str1(NULL, NULL, "<delay>", "dead time in s");
+    oven_data.model_args.zone  = arg_int0("z", "zone", "<n>", "zone, default 0");
+    oven_data.model_args.end   = arg_end(10);
+    const esp_console_cmd_t model_cmd = {
+        .command  = "model",
+        .help     = "set oven model used for feedforward",
+        .hint     = NULL,
+        .func     = model_command,
+        .argtable = &oven_data.model_args,
+    };
+    esp_console_cmd_register(&model_cmd);
+
+    oven_data.mode_args.mode = arg_str1(NULL, NULL, "<pid|ff>", "controller");
+    oven_data.mode_args.zone = arg_int0("z", "zone", "<n>", "zone, default 0");
+    oven_data.mode_args.end  = arg_end(10);
+    const esp_console_cmd_t mode_cmd = {
+        .command  = "mode",
+        .help     = "select PID only or feedforward plus PID",
+        .hint     = NULL,
+        .func     = mode_command,
+        .argtable = &oven_data.mode_args,
+    };
+    esp_console_cmd_register(&mode_cmd);
+
+    const esp_console_cmd_t zones_cmd = {
+        .command  = "zones",
+        .help     = "list zones, their cost per tick and how many fit in one",
+        .hint     = NULL,
+        .func     = zones_command,
+        .argtable = NULL,
+    };
+    esp_console_cmd_register(&zones_cmd);
+
+    const esp_console_cmd_t zcd_cmd = {
+        .command  = "zcd",
+        .help     = "show mains zero cross health and ISR time",
+        .hint     = NULL,
+        .func     = zcd_command,
+        .argtable = NULL,
+    };
+    esp_console_cmd_register(&zcd_cmd);
+
+    oven_data.fire_args.fire = arg_str1(NULL, NULL, "<burst|phase>", "heater firing");
+    oven_data.fire_args.zone = arg_int0("z", "zone", "<n>", "zone, default 0");
+    oven_data.fire_args.end  = arg_end(10);
+    const esp_console_cmd_t fire_cmd = {
+        .command  = "fire",
+        .help     = "fire heaters in whole half-cycles or by phase angle",
+        .hint     = NULL,
+        .func     = fire_command,
+        .argtable = &oven_data.fire_args,
+    };
+    esp_console_cmd_register(&fire_cmd);
+
+    oven_data.queue_args.profile = arg_int0(NULL, NULL, "<profile>", "profile to queue");
+    oven_data.queue_args.count   = arg_int0(NULL, NULL, "<count>", "runs of it, default 1");
+    oven_data.queue_args.boards  = arg_int0("b", "boards", "<n>", "boards per run, default 1");
+    oven_data.queue_args.clear   = arg_lit0("c", "clear", "drop runs not started yet");
+    oven_data.queue_args.temp    = arg_str0("t", "temp", "<C>", "start the next run below this");
+    oven_data.queue_args.zone    = arg_int0("z", "zone", "<n>", "zone, default 0");
+    oven_data.queue_args.end     = arg_end(10);
+    const esp_console_cmd_t queue_cmd = {
+        .command  = "queue",
+        .help     = "queue runs back to back, each once the oven has cooled below the start temperature",
+        .hint     = NULL,
+        .func     = queue_command,
+        .argtable = &oven_data.queue_args,
+    };
+    esp_console_cmd_register(&queue_cmd);
+
+    oven_data.client_lock = xSemaphoreCreateMutex();
+    oven_data.reply       = xSemaphoreCreateBinary();
+    oven_data.sched_lock  = xSemaphoreCreateMutex();
+    command_queue_init(&oven_data.commands);
+    trace_init(&oven_data.trace);
+
+    profile_init();
+    profiles_load();
+    for (int z = 0; z < NUM_ZONES; z++) {
+        oven_zone_t *zone = &oven_data.zones[z];
+        zone->config = &ZONES[z];
+        zone->idx    = z;
+        seqlock_init(&zone->history_lock);
+        seqlock_init(&zone->snapshot_lock);
+        control_init(&zone->ctrl);
+        history_init(&zone->history);
+        sensor_filter_init(&zone->filter);
+        ring_init(&zone->samples);
+        pid_load(zone);
+        sched_load(zone);
+        model_load(zone);
+        fire_load(zone);
+        queue_load(zone);
+        snapshot_publish(zone);
+    }
+    metrics_hist_init(&oven_data.tick_time, TICK_BOUNDS);
+    metrics_hist_init(&oven_data.tick_jitter, JITTER_BOUNDS);
+    metrics_hist_init(&oven_data.spi_time, SPI_BOUNDS);
+    xTaskCreate(oven_thread, "oven", OVEN_STACK, NULL, configMAX_PRIORITIES - 1, &oven_data.oven_task);
+    xTaskCreate(temp_thread, "temp", TEMP_STACK, NULL, configMAX_PRIORITIES - 2, &oven_data.temp_task);
+    xTaskCreate(events_thread, "events", 3072, NULL, tskIDLE_PRIORITY + 1, NULL);
+}
+
+bool oven_start(int zone, profile_type_t profile, double temp) {
+    command_t cmd = {
+        .type          = COMMAND_START,
+        .zone          = zone,
+        .start.profile = profile,
+        .start.temp    = temp,
+    };
+    if (zone < 0 || zone >= NUM_ZONES) {
+        return false;
+    }
+    bool ok = command_send(&cmd);
+    if (!ok) {
+        ESP_LOGW(TAG, "%s: profile %d not started", ZONES[zone].name, profile);
+    } else {
+        ESP_LOGI(TAG, "%s: starting profile %d at temp %.1fC", ZONES[zone].name, profile, temp);
+    }
+    return ok;
+}
+
+bool oven_autotune(int zone, double temp) {
+    command_t cmd = {
+        .type     = COMMAND_AUTOTUNE,
+        .zone     = zone,
+        .setpoint = temp,
+    };
+    if (zone < 0 || zone >= NUM_ZONES) {
+        return false;
+    }
+    bool ok = command_send(&cmd);
+    if (!ok) {
+        ESP_LOGW(TAG, "can't autotune while running");
+    } else if (xTaskCreate(tune_thread, "tune", 3072, (void*) (intptr_t) zone, tskIDLE_PRIORITY + 1, NULL) != pdPASS) {
+        oven_stop(zone);
+        ok = false;
+    } else {
+        ESP_LOGI(TAG, "%s: autotune at temp %.1fC", ZONES[zone].name, temp);
+    }
+    return ok;
+}
 
-    oven_data.lock           = xSemaphoreCreateBinary();
-    oven_data.type           = PROFILE_TYPE_MANUAL;
-    oven_data.status.current = ROOM_TEMP;
-    oven_data.status.target  = ROOM_TEMP;
-    oven_data.status.running = false;
-    xSemaphoreGive(oven_data.lock);
-    xTaskCreate(oven_thread, "oven", 2048, NULL, configMAX_PRIORITIES - 1, NULL);
+bool oven_pid_set(int zone, double kp, double ki, double kd) {
+    // where the gain schedule has no entries, or everywhere without one
+    command_t cmd = {
+        .type   = COMMAND_PID,
+        .zone   = zone,
+        .pid.kp = kp,
+        .pid.ki = ki,
+        .pid.kd = kd,
+    };
+    if (zone < 0 || zone >= NUM_ZONES || !command_send(&cmd)) {
+        return false;
+    }
+    ESP_LOGI(TAG, "%s PID kp: %.5f ki: %.5f kd: %.5f", ZONES[zone].name, kp, ki, kd);
+    const pid_gains_t gains = {
+        .kp = kp,
+        .ki = ki,
+        .kd = kd,
+    };
+    pid_save(zone, &gains);
+    return true;
 }
 
-void oven_start(profile_type_t profile, double temp) {
-    if (profile < PROFILE_TYPE_COUNT) {
-        profile_set_temp(profile, temp);
-        xSemaphoreTake(oven_data.lock, portMAX_DELAY);
-        oven_data.type = profile;
-        oven_data.start = xTaskGetTickCount();
-        oven_data.status.running = true;
-        xSemaphoreGive(oven_data.lock);
-        ESP_LOGI(TAG, "starting profile %d at temp %.1fC", profile, temp);
+bool oven_sched_set(int zone, const control_sched_t *sched) {
+    // sorted here, so what readers get matches the oven task's copy
+    command_t cmd = {
+        .type  = COMMAND_SCHED,
+        .zone  = zone,
+        .sched = *sched,
+    };
+    if (zone < 0 || zone >= NUM_ZONES) {
+        return false;
+    }
+    if (!control_sched_sort(&cmd.sched)) {
+        ESP_LOGE(TAG, "invalid gain schedule");
+        return false;
+    }
+    xSemaphoreTake(oven_data.sched_lock, portMAX_DELAY);
+    bool ok = command_send(&cmd);
+    if (ok) {
+        oven_data.zones[zone].sched = cmd.sched;
+        ESP_LOGI(TAG, "%s gain schedule: %d entries", ZONES[zone].name, cmd.sched.num);
+        sched_stored_t stored = { .version = STORED_VERSION, .num = cmd.sched.num };
+        for (size_t i = 0; i < cmd.sched.num; i++) {
+            const control_sched_entry_t *entry = &cmd.sched.entries[i];
+            stored.entries[i] = (sched_entry_stored_t) {
+                .temp  = entry->temp,
+                .kp    = entry->gains.kp,
+                .ki    = entry->gains.ki,
+                .kd    = entry->gains.kd,
+                .phase = entry->phase,
+            };
+        }
+        char key[KEY_LEN];
+        zone_key(key, SCHED_KEY, zone);
+        esp_err_t err = settings_set(key, &stored, sizeof(stored));
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "failed to save gain schedule (%s)", esp_err_to_name(err));
+        }
     }
+    xSemaphoreGive(oven_data.sched_lock);
+    return ok;
+}
+
+void oven_sched_get(int zone, control_sched_t *sched) {
+    xSemaphoreTake(oven_data.sched_lock, portMAX_DELAY);
+    *sched = oven_data.zones[zone].sched;
+    xSemaphoreGive(oven_data.sched_lock);
+}
+
+void oven_autotune_status(int zone, autotune_t *tune) {
+    oven_zone_t *z = &oven_data.zones[zone];
+    unsigned seq;
+    do {
+        seq   = seqlock_read_begin(&z->snapshot_lock);
+        *tune = z->snapshot.tune;
+    } while (seqlock_read_retry(&z->snapshot_lock, seq));
 }
 
-void oven_stop(void) {
-    xSemaphoreTake(oven_data.lock, portMAX_DELAY);
-    oven_data.status.target  = ROOM_TEMP;
-    oven_data.status.running = false;
-    xSemaphoreGive(oven_data.lock);
-    ESP_LOGI(TAG, "stop");
+bool oven_stop(int zone) {
+    command_t cmd = {
+        .type = COMMAND_STOP,
+        .zone = zone,
+    };
+    if (zone < 0 || zone >= NUM_ZONES) {
+        return false;
+    }
+    bool ok = command_send(&cmd);
+    if (!ok) {
+        ESP_LOGE(TAG, "%s: stop not delivered", ZONES[zone].name);
+    } else {
+        ESP_LOGI(TAG, "%s: stop", ZONES[zone].name);
+    }
+    return ok;
 }
 
-void oven_status(oven_status_t *status) {
+void oven_status(int zone, oven_status_t *status) {
     if (status) {
-        xSemaphoreTake(oven_data.lock, portMAX_DELAY);
-        *status = oven_data.status;
-        xSemaphoreGive(oven_data.lock);
+        oven_zone_t *z = &oven_data.zones[zone];
+        unsigned seq;
+        do {
+            seq     = seqlock_read_begin(&z->snapshot_lock);
+            *status = z->snapshot.status;
+        } while (seqlock_read_retry(&z->snapshot_lock, seq));
+    }
+}
+
+bool oven_queue_add(int zone, profile_type_t profile, uint16_t count, uint16_t boards) {
+    command_t cmd = {
+        .type = COMMAND_QUEUE_ADD,
+        .zone = zone,
+        .job  = {
+            .profile = profile,
+            .count   = count,
+            .boards  = boards,
+        },
+    };
+    if (zone < 0 || zone >= NUM_ZONES) {
+        return false;
+    }
+    bool ok = command_send(&cmd);
+    if (!ok) {
+        ESP_LOGW(TAG, "can't queue profile %d", profile);
+    } else {
+        ESP_LOGI(TAG, "%s: queued %u runs of profile %d, %u boards each", ZONES[zone].name,
+            count, profile, boards);
+    }
+    return ok;
+}
+
+void oven_queue_clear(int zone) {
+    command_t cmd = {
+        .type = COMMAND_QUEUE_CLEAR,
+        .zone = zone,
+    };
+    if (zone >= 0 && zone < NUM_ZONES) {
+        command_send(&cmd);
+        ESP_LOGI(TAG, "%s: queue cleared", ZONES[zone].name);
+    }
+}
+
+bool oven_queue_temp(int zone, double temp) {
+    command_t cmd = {
+        .type       = COMMAND_QUEUE_TEMP,
+        .zone       = zone,
+        .start_temp = temp,
+    };
+    if (zone < 0 || zone >= NUM_ZONES) {
+        return false;
+    }
+    if (!command_send(&cmd)) {
+        ESP_LOGE(TAG, "start temperature must be above %.0fC and at most %.0fC", ROOM_TEMP, QUEUE_TEMP_MAX);
+        return false;
+    }
+    ESP_LOGI(TAG, "%s queue starts below %.1fC", ZONES[zone].name, temp);
+
+    char key[KEY_LEN];
+    zone_key(key, QUEUE_KEY, zone);
+    const float stored = temp;
+    esp_err_t err = settings_set(key, &stored, sizeof(stored));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "failed to save start temperature (%s)", esp_err_to_name(err));
+    }
+    return true;
+}
+
+void oven_queue_status(int zone, queue_t *queue) {
+    oven_zone_t *z = &oven_data.zones[zone];
+    unsigned seq;
+    do {
+        seq    = seqlock_read_begin(&z->snapshot_lock);
+        *queue = z->snapshot.queue;
+    } while (seqlock_read_retry(&z->snapshot_lock, seq));
+}
+
+int oven_zone_count(void) {
+    return NUM_ZONES;
+}
+
+const char *oven_zone_name(int zone) {
+    return (zone >= 0 && zone < NUM_ZONES) ? ZONES[zone].name : NULL;
+}
+
+int oven_profile_add(const char *name, const profile_step_t *steps, size_t num_steps, const profile_limits_t *limits,
+        bool *saved) {
+    // only appends, so the oven task can keep reading the table meanwhile
+    *saved = false;
+    void *buf = malloc(PROFILES_MAX_LEN);
+    if (buf == NULL) {
+        return -1;
+    }
+    // saved under the lock, so no client can start or queue the new profile before it's on flash or gone again
+    xSemaphoreTake(oven_data.client_lock, portMAX_DELAY);
+    int type = profile_add(name, steps, num_steps, limits);
+    *saved = type >= 0 && profiles_write(buf, profile_export(buf, PROFILES_MAX_LEN));
+    if (type >= 0 && !*saved) {
+        if (profile_remove(type)) { // the last one, so nothing shifts
+            type = -1;
+        } else {
+            ESP_LOGW(TAG, "profile %d (%s) kept, but not saved", type, name);
+        }
+    }
+    xSemaphoreGive(oven_data.client_lock);
+    free(buf);
+    if (type >= 0) {
+        ESP_LOGI(TAG, "added profile %d (%s)", type, name);
+    }
+    return type;
+}
+
+bool oven_profile_remove(profile_type_t type) {
+    // shifts the table, so done by the oven task which refuses while any zone runs or has runs queued
+    command_t cmd = {
+        .type    = COMMAND_PROFILE_REMOVE,
+        .profile = type,
+    };
+    bool ok = command_send(&cmd);
+    if (ok) {
+        ESP_LOGI(TAG, "removed profile %d", type);
+        profiles_save();
+    }
+    return ok;
+}
+
+// called from the oven task after every tick, must not block, set once at startup
+void oven_listen(oven_listener_t listener, void *arg) {
+    oven_data.listener_arg = arg;
+    oven_data.listener     = listener;
+}
+
+size_t oven_history(int zone, uint32_t since, history_sample_t *samples, size_t max, uint32_t *seq) {
+    oven_zone_t *z = &oven_data.zones[zone];
+    size_t n;
+    unsigned lock_seq;
+    do {
+        lock_seq = seqlock_read_begin(&z->history_lock);
+        n = history_read(&z->history, since, samples, max, seq);
+    } while (seqlock_read_retry(&z->history_lock, lock_seq));
+    return n;
+}
+
+void oven_zcd_status(zcd_t *zcd) {
+    unsigned seq;
+    do {
+        seq  = seqlock_read_begin(&oven_data.zcd_lock);
+        *zcd = oven_data.zcd;
+    } while (seqlock_read_retry(&oven_data.zcd_lock, seq));
+}
+
+void oven_metrics(metrics_t *m) {
+    metrics_family(m, "osro_control_tick_seconds", "histogram", "Control tick execution time.");
+    metrics_hist(m, "osro_control_tick_seconds", NULL, &oven_data.tick_time);
+    metrics_family(m, "osro_control_jitter_seconds", "histogram", "Deviation of the tick interval from the control period.");
+    metrics_hist(m, "osro_control_jitter_seconds", NULL, &oven_data.tick_jitter);
+    metrics_family(m, "osro_control_overruns_total", "counter", "Ticks that ran past the next wake time.");
+    metrics_value(m, "osro_control_overruns_total", NULL, oven_data.overruns);
+
+    // per zone, labelled with its index
+    char labels[NUM_ZONES][16];
+    for (int z = 0; z < NUM_ZONES; z++) {
+        snprintf(labels[z], sizeof(labels[z]), "zone=\"%d\"", z);
+    }
+    metrics_family(m, "osro_control_step_cycles", "gauge", "CPU cycles spent in the control core on the last tick.");
+    for (int z = 0; z < NUM_ZONES; z++) {
+        metrics_value(m, "osro_control_step_cycles", labels[z], oven_data.zones[z].step_cycles);
+    }
+    metrics_family(m, "osro_control_step_cycles_max", "gauge", "Most CPU cycles spent in the control core on one tick.");
+    for (int z = 0; z < NUM_ZONES; z++) {
+        metrics_value(m, "osro_control_step_cycles_max", labels[z], oven_data.zones[z].step_cycles_max);
     }
+    metrics_family(m, "osro_zone_cycles_max", "gauge", "Most CPU cycles the control task spent on a zone in one tick.");
+    for (int z = 0; z < NUM_ZONES; z++) {
+        metrics_value(m, "osro_zone_cycles_max", labels[z], oven_data.zones[z].zone_cycles_max);
+    }
+
+    metrics_family(m, "osro_spi_read_seconds", "histogram", "Time to read every thermocouple.");
+    metrics_hist(m, "osro_spi_read_seconds", NULL, &oven_data.spi_time);
+    metrics_family(m, "osro_spi_errors_total", "counter", "Thermocouple reads that failed on the bus.");
+    metrics_value(m, "osro_spi_errors_total", NULL, oven_data.spi_errors);
+    metrics_family(m, "osro_sample_drops_total", "counter", "Sensor samples dropped with the ring full.");
+    for (int z = 0; z < NUM_ZONES; z++) {
+        metrics_value(m, "osro_sample_drops_total", labels[z], ring_dropped(&oven_data.zones[z].samples));
+    }
+
+    zcd_t zcd;
+    oven_zcd_status(&zcd);
+    metrics_family(m, "osro_zcd_edges_total", "counter", "Zero cross edges by outcome.");
+    metrics_value(m, "osro_zcd_edges_total", "edge=\"ok\"", zcd.edges);
+    metrics_value(m, "osro_zcd_edges_total", "edge=\"spurious\"", zcd.spurious);
+    metrics_value(m, "osro_zcd_edges_total", "edge=\"missed\"", zcd.missed);
+}
+
+void oven_stack_free(uint32_t *oven, uint32_t *temp) {
+    *oven = uxTaskGetStackHighWaterMark(oven_data.oven_task);
+    *temp = uxTaskGetStackHighWaterMark(oven_data.temp_task);
 }
@@ -2,17 +2,80 @@
 #define OVEN_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "analytics.h"
+#include "autotune.h"
+#include "control.h"
+#include "history.h"
+#include "ident.h"
+#include "metrics.h"
 #include "profile.h"
+#include "queue.h"
+#include "sensor.h"
+#include "zcd.h"
+
+/*
+ * Zones are ovens, or preheater plates, each with its own thermocouples,
+ * heaters, controller and run. One control task steps all of them every
+ * tick. Functions taking a zone act on that one, which must be below
+ * oven_zone_count(). The profile table, mains and metrics are shared.
+ */
+
+#define OVEN_MAX_ZONES (4) // heater pins and SPI chip selects run out about here
 
 typedef struct {
-    double current;
-    double target;
-    bool   running;
+    double   current; // fused
+    double   rate;    // C/s
+    double   target;
+    bool     running;
+    bool     tuning;
+    bool     faulted; // no usable thermocouple
+    uint32_t seq;     // newest history sample
+
+    // what the current run was started with, and how it's going
+    profile_type_t     profile;
+    control_mode_t     mode;
+    double             kp, ki, kd; // in use, from the schedule while it has entries for phase
+    control_gains_t    gains;      // set outright, see oven_pid_set
+    control_phase_t    phase;
+    analytics_result_t quality; // live while running, final once it ends
+
+    // predictions from the model learned of this oven, NAN if unknown
+    ident_model_t plant;
+    double        eta;      // s until the run ends
+    double        cooldown; // s until safe to open with the heaters off, after the run if one is going
+
+    uint32_t cycles_max; // CPU cycles, most the control task has spent on the zone in a tick
+    uint32_t trips;      // runs stopped because every thermocouple faulted
+
+    size_t           num_sensors;
+    sensor_reading_t sensors[SENSOR_MAX];
 } oven_status_t;
 
+typedef void (*oven_listener_t)(void *arg);
+
 void oven_init(void);
-void oven_start(profile_type_t profile, double temp);
-void oven_stop(void);
-void oven_status(oven_status_t *status);
+int  oven_zone_count(void);
+const char *oven_zone_name(int zone); // NULL if there's no such zone
+bool oven_start(int zone, profile_type_t profile, double temp);
+bool oven_stop(int zone);
+bool oven_autotune(int zone, double temp);
+bool oven_pid_set(int zone, double kp, double ki, double kd);
+bool oven_sched_set(int zone, const control_sched_t *sched);
+void oven_sched_get(int zone, control_sched_t *sched);
+void oven_autotune_status(int zone, autotune_t *tune);
+bool oven_queue_add(int zone, profile_type_t profile, uint16_t count, uint16_t boards);
+void oven_queue_clear(int zone); // a run going carries on, a stop also clears
+bool oven_queue_temp(int zone, double temp); // C, the next run starts below it
+void oven_queue_status(int zone, queue_t *queue);
+int  oven_profile_add(const char *name, const profile_step_t *steps, size_t num_steps, const profile_limits_t *limits,
+                      bool *saved); // -1 if not added, unsaved ones are kept only if they couldn't be dropped
+bool oven_profile_remove(profile_type_t type);
+void oven_status(int zone, oven_status_t *status);
+void oven_listen(oven_listener_t listener, void *arg); // after every tick, every zone stepped
+size_t oven_history(int zone, uint32_t since, history_sample_t *samples, size_t max, uint32_t *seq);
+void oven_zcd_status(zcd_t *zcd); // ISR times in CPU cycles
+void oven_metrics(metrics_t *m);
+void oven_stack_free(uint32_t *oven, uint32_t *temp); // bytes, least seen
 
 #endif // OVEN_H
@@ -0,0 +1,39 @@
+#include <math.h>
+#include "control.h"
+#include "phase.h"
+#include "phase_lut.h" // PHASE_LUT, generated at build time by tools/phase_lut.py
+
+/* private data */
+#define LUT_LEN        ((1 << PHASE_LUT_BITS) + 1)
+#define LUT_SHIFT      (16 - PHASE_LUT_BITS)
+
+_Static_assert(PWM_ONE == 1 << 16, "power is PWM fixed point");
+
+_Static_assert(sizeof(PHASE_LUT) / sizeof(PHASE_LUT[0]) == LUT_LEN, "phase_lut.h is stale");
+
+/* public functions */
+// power of a resistive load fired at angle (fraction of the half-cycle), 0-1
+double phase_power(double angle) {
+    double a = angle * M_PI;
+    return 1.0 - a / M_PI + sin(2.0 * a) / (2.0 * M_PI);
+}
+
+// us after the zero cross to fire for power (PWM_ONE = full), or PHASE_OFF
+uint32_t phase_delay(uint32_t power, uint32_t period) {
+    if (power == 0) {
+        return PHASE_OFF;
+    }
+    if (power >= PWM_ONE) {
+        return PHASE_MIN_US;
+    }
+    uint32_t idx   = power >> LUT_SHIFT;
+    uint32_t frac  = power & ((1 << LUT_SHIFT) - 1);
+    uint32_t a     = PHASE_LUT[idx];
+    uint32_t b     = PHASE_LUT[idx + 1];
+    uint32_t angle = a - (((a - b) * frac) >> LUT_SHIFT); // falls with power
+    uint32_t delay = (uint32_t) (((uint64_t) angle * period) >> 16);
+    if (delay + PHASE_PULSE_US + PHASE_MARGIN_US > period) {
+        return PHASE_OFF; // too late to latch, and it would overlap the next half-cycle
+    }
+    return (delay < PHASE_MIN_US) ? PHASE_MIN_US : delay;
+}
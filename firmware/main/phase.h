@@ -0,0 +1,22 @@
+#ifndef PHASE_H
+#define PHASE_H
+
+#include <stdint.h>
+
+/*
+ * Phase-angle firing timing. On every zero cross phase_delay says how long to
+ * wait before gating the triacs for the given power and half-cycle (see
+ * zcd.h), so power can change every half-cycle. Integer math only over a
+ * table generated at build time, safe to call from an ISR.
+ */
+
+#define PHASE_OFF       (UINT32_MAX) // don't fire this half-cycle
+#define PHASE_PULSE_US  (200)        // gate pulse
+#define PHASE_MIN_US    (100)        // too little voltage to latch before this
+#define PHASE_MARGIN_US (300)        // pulse must end this long before the next zero cross
+#define PHASE_LUT_BITS  (8)          // 257 entries, power to angle
+
+uint32_t phase_delay(uint32_t power, uint32_t period);
+double   phase_power(double angle);
+
+#endif // PHASE_H
@@ -1,87 +1,412 @@
+#include <tgmath.h>
+#include <stdio.h>
 #include <string.h>
 #include "profile.h"
 
 /* private data */
-#define MAX_POINTS (10)
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+#define MAX_PROFILES (PROFILE_BUILTIN_COUNT + PROFILE_MAX_USER)
+#define MAX_SEGMENTS (256) // all profiles combined
+#define EXPORT_MAGIC (0x3250534F) // "OSP2", bump the digit when the layout changes
 
 typedef struct {
-    double time; // sec
-    double temp; // C
-} profile_point_t;
-
-typedef struct {
-    char           *name;
-    size_t          num_pts;
-    profile_point_t pts[MAX_POINTS];
+    char                 *name;
+    size_t                num_steps;
+    const profile_step_t *steps;
+    profile_limits_t      limits;
 } profile_config_t;
 
-static const profile_config_t configs[PROFILE_TYPE_COUNT] = {
+// https://aimsolder.com/sites/default/files/ws483_sac305_solder_paste_tds.pdf
+static const profile_step_t sac305_steps[] = {
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 150.0,     .value = 90.0 },
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 175.0,     .value = 75.0 },
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 245.0,     .value = 60.0 },
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = ROOM_TEMP, .value = 45.0 },
+};
+
+// https://www.kester.com/Portals/0/Documents/Knowledge%20Base/Standard_Profile.pdf
+static const profile_step_t sn63pb37_steps[] = {
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 150.0,     .value = 90.0 },
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 180.0,     .value = 90.0 },
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 230.0,     .value = 45.0 },
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = ROOM_TEMP, .value = 45.0 },
+};
+
+static const profile_config_t configs[PROFILE_BUILTIN_COUNT] = {
     [PROFILE_TYPE_MANUAL] = {
         .name = "Manual",
     },
-    [PROFILE_TYPE_SAC305] = { // https://aimsolder.com/sites/default/files/ws483_sac305_solder_paste_tds.pdf
-        .name    = "SAC305",
-        .num_pts = 5,
-        .pts = {
-            { .time = 0.0,   .temp = ROOM_TEMP },
-            { .time = 90.0,  .temp = 150.0     },
-            { .time = 165.0, .temp = 175.0     },
-            { .time = 225.0, .temp = 245.0     },
-            { .time = 270.0, .temp = ROOM_TEMP },
-        }
+    [PROFILE_TYPE_SAC305] = {
+        .name      = "SAC305",
+        .num_steps = COUNT_OF(sac305_steps),
+        .steps     = sac305_steps,
+        .limits    = {
+            .liquidus = 217.0,
+            .peak_min = 235.0, .peak_max = 250.0,
+            .tal_min  = 30.0,  .tal_max  = 90.0,
+            .ramp_up_max = 3.0, .ramp_down_max = 6.0,
+            .soak_low = 150.0, .soak_high = 200.0,
+            .soak_min = 60.0,  .soak_max  = 120.0,
+        },
     },
-    [PROFILE_TYPE_SN63PB37] = { // https://www.kester.com/Portals/0/Documents/Knowledge%20Base/Standard_Profile.pdf
-        .name    = "Sn63/Pb37",
-        .num_pts = 5,
-        .pts = {
-            { .time = 0.0,   .temp = ROOM_TEMP },
-            { .time = 90.0,  .temp = 150.0     },
-            { .time = 180.0, .temp = 180.0     },
-            { .time = 225.0, .temp = 230.0     },
-            { .time = 270.0, .temp = ROOM_TEMP },
-        }
+    [PROFILE_TYPE_SN63PB37] = {
+        .name      = "Sn63/Pb37",
+        .num_steps = COUNT_OF(sn63pb37_steps),
+        .steps     = sn63pb37_steps,
+        .limits    = {
+            .liquidus = 183.0,
+            .peak_min = 205.0, .peak_max = 235.0, // J-STD-020 SnPb package limit
+            .tal_min  = 30.0,  .tal_max  = 90.0,
+            .ramp_up_max = 3.0, .ramp_down_max = 6.0,
+            .soak_low = 150.0, .soak_high = 180.0,
+            .soak_min = 60.0,  .soak_max  = 120.0,
+        },
     },
 };
 
+typedef struct {
+    char   name[PROFILE_NAME_LEN];
+    size_t first; // into segments
+    size_t num_segs;
+    real_t end_temp;
+    profile_limits_t limits;
+} profile_entry_t;
+
+// export format, user profiles only
+typedef struct {
+    uint32_t magic;
+    uint16_t num_profiles;
+    uint16_t num_segments;
+} export_header_t;
+
+typedef struct {
+    float liquidus, peak_min, peak_max, tal_min, tal_max, ramp_up_max, ramp_down_max;
+    float soak_low, soak_high, soak_min, soak_max, dev_max;
+} export_limits_t;
+
+typedef struct {
+    char            name[PROFILE_NAME_LEN];
+    uint16_t        num_segs;
+    uint16_t        reserved;
+    export_limits_t limits;
+} export_profile_t;
+
+typedef struct {
+    float   start, end, temp, slope, thresh;
+    int32_t wait;
+} export_segment_t;
+
 static struct {
-    double manual_temp;
+    profile_segment_t segments[MAX_SEGMENTS];
+    size_t            num_segments;
+    size_t            num_builtin_segments;
+    profile_entry_t   profiles[MAX_PROFILES];
+    size_t            num_profiles;
 } profile_data;
 
 /* private helpers */
+static int register_segments(const char *name, size_t num_segs, const profile_limits_t *limits) {
+    // segments are already compiled into the free end of the pool
+    profile_entry_t *prof = &profile_data.profiles[profile_data.num_profiles];
+    snprintf(prof->name, sizeof(prof->name), "%s", name);
+    prof->first    = profile_data.num_segments;
+    prof->num_segs = num_segs;
+    prof->end_temp = ROOM_TEMP;
+    prof->limits   = limits ? *limits : (profile_limits_t) { .liquidus = 0.0f };
+    if (num_segs > 0) {
+        const profile_segment_t *last = &profile_data.segments[prof->first + num_segs - 1];
+        prof->end_temp = last->temp + last->slope * (last->end - last->start);
+    }
+    profile_data.num_segments += num_segs;
+    return profile_data.num_profiles++;
+}
+
+static bool wait_done(const profile_segment_t *seg, real_t temp) {
+    return (seg->wait > 0) ? (temp >= seg->thresh) : (temp <= seg->thresh);
+}
 
 /* public functions */
-void profile_set_temp(profile_type_t type, double temp) {
-    if (type == PROFILE_TYPE_MANUAL) {
-        profile_data.manual_temp = temp;
+void profile_init(void) {
+    profile_data.num_segments = 0;
+    profile_data.num_profiles = 0;
+    for (size_t i = 0; i < PROFILE_BUILTIN_COUNT; i++) {
+        int n = profile_compile(configs[i].steps, configs[i].num_steps, ROOM_TEMP,
+            &profile_data.segments[profile_data.num_segments], MAX_SEGMENTS - profile_data.num_segments);
+        register_segments(configs[i].name, (n < 0) ? 0 : n, &configs[i].limits);
     }
+    profile_data.num_builtin_segments = profile_data.num_segments;
+}
+
+// returns number of segments, or -1 if steps are invalid or don't fit
+int profile_compile(const profile_step_t *steps, size_t num_steps, double start_temp,
+                    profile_segment_t *segs, size_t max_segs) {
+    if (num_steps > max_segs) {
+        return -1;
+    }
+
+    double time = 0.0, temp = start_temp;
+    for (size_t i = 0; i < num_steps; i++) {
+        const profile_step_t *step = &steps[i];
+        profile_segment_t *seg = &segs[i];
+        if (!isfinite(step->temp) || !isfinite(step->value) || step->value < 0.0) {
+            return -1;
+        }
+
+        double dur = 0.0, end_temp = step->temp;
+        seg->wait  = 0;
+        switch (step->type) {
+            case PROFILE_STEP_RAMP_TIME:
+                dur = step->value;
+                break;
+
+            case PROFILE_STEP_RAMP_RATE:
+                if (step->value <= 0.0) {
+                    return -1;
+                }
+                dur = fabs(step->temp - temp) / step->value;
+                break;
+
+            case PROFILE_STEP_HOLD:
+                dur      = step->value;
+                end_temp = temp;
+                break;
+
+            case PROFILE_STEP_REACH:
+                seg->wait   = (step->temp >= temp) ? 1 : -1;
+                seg->thresh = step->temp - seg->wait * step->value;
+                temp        = step->temp; // target jumps, then waits
+                break;
+
+            default:
+                return -1;
+        }
+
+        seg->start = time;
+        seg->end   = time + dur;
+        seg->temp  = temp;
+        seg->slope = (dur > 0.0) ? (end_temp - temp) / dur : 0.0;
+        time += dur;
+        temp  = end_temp;
+    }
+    return num_steps;
 }
 
 const char *profile_name(profile_type_t type) {
     const char *ret = NULL;
-    if (type < PROFILE_TYPE_COUNT) {
-        ret = configs[type].name;
+    if (type < profile_data.num_profiles) {
+        ret = profile_data.profiles[type].name;
     }
     return ret;
 }
 
-profile_status_t profile_status(profile_type_t type, double time) {
+size_t profile_count(void) {
+    return profile_data.num_profiles;
+}
+
+void profile_limits(profile_type_t type, profile_limits_t *limits) {
+    *limits = (profile_limits_t) { .liquidus = 0.0f };
+    if (type < profile_data.num_profiles) {
+        *limits = profile_data.profiles[type].limits;
+    }
+}
+
+// compiled segments, NULL for manual and unknown profiles
+const profile_segment_t *profile_segments(profile_type_t type, size_t *num_segs) {
+    if (type == PROFILE_TYPE_MANUAL || type >= profile_data.num_profiles) {
+        *num_segs = 0;
+        return NULL;
+    }
+    const profile_entry_t *prof = &profile_data.profiles[type];
+    *num_segs = prof->num_segs;
+    return &profile_data.segments[prof->first];
+}
+
+// returns the new profile's type, or -1 if steps are invalid or there's no room
+int profile_add(const char *name, const profile_step_t *steps, size_t num_steps, const profile_limits_t *limits) {
+    if (profile_data.num_profiles >= MAX_PROFILES || num_steps == 0 || num_steps > PROFILE_MAX_STEPS) {
+        return -1;
+    }
+    int n = profile_compile(steps, num_steps, ROOM_TEMP,
+        &profile_data.segments[profile_data.num_segments], MAX_SEGMENTS - profile_data.num_segments);
+    if (n < 0) {
+        return -1;
+    }
+    return register_segments(name, n, limits);
+}
+
+// only user profiles can be removed, later profiles shift down by one
+bool profile_remove(profile_type_t type) {
+    if (type < PROFILE_BUILTIN_COUNT || type >= profile_data.num_profiles) {
+        return false;
+    }
+    profile_entry_t *prof = &profile_data.profiles[type];
+    size_t first = prof->first, num_segs = prof->num_segs;
+    memmove(&profile_data.segments[first], &profile_data.segments[first + num_segs],
+        (profile_data.num_segments - first - num_segs) * sizeof(profile_segment_t));
+    profile_data.num_segments -= num_segs;
+
+    memmove(prof, prof + 1, (profile_data.num_profiles - type - 1) * sizeof(profile_entry_t));
+    profile_data.num_profiles--;
+    for (size_t i = type; i < profile_data.num_profiles; i++) {
+        profile_data.profiles[i].first -= num_segs;
+    }
+    return true;
+}
+
+// packs user profiles into buf, returns bytes used or 0 if it doesn't fit
+size_t profile_export(void *buf, size_t size) {
+    size_t num_profiles = profile_data.num_profiles - PROFILE_BUILTIN_COUNT;
+    size_t num_segments = profile_data.num_segments - profile_data.num_builtin_segments;
+    size_t len = sizeof(export_header_t) + num_profiles * sizeof(export_profile_t) +
+        num_segments * sizeof(export_segment_t);
+    if (len > size) {
+        return 0;
+    }
+
+    export_header_t *header = buf;
+    header->magic        = EXPORT_MAGIC;
+    header->num_profiles = num_profiles;
+    header->num_segments = num_segments;
+
+    export_profile_t *profs = (export_profile_t*) (header + 1);
+    for (size_t i = 0; i < num_profiles; i++) {
+        const profile_entry_t *prof = &profile_data.profiles[PROFILE_BUILTIN_COUNT + i];
+        memcpy(profs[i].name, prof->name, sizeof(profs[i].name));
+        profs[i].num_segs = prof->num_segs;
+        profs[i].reserved = 0;
+        const profile_limits_t *lim = &prof->limits;
+        profs[i].limits = (export_limits_t) {
+            .liquidus      = lim->liquidus,
+            .peak_min      = lim->peak_min,
+            .peak_max      = lim->peak_max,
+            .tal_min       = lim->tal_min,
+            .tal_max       = lim->tal_max,
+            .ramp_up_max   = lim->ramp_up_max,
+            .ramp_down_max = lim->ramp_down_max,
+            .soak_low      = lim->soak_low,
+            .soak_high     = lim->soak_high,
+            .soak_min      = lim->soak_min,
+            .soak_max      = lim->soak_max,
+            .dev_max       = lim->dev_max,
+        };
+    }
+
+    export_segment_t *segs = (export_segment_t*) &profs[num_profiles];
+    for (size_t i = 0; i < num_segments; i++) {
+        const profile_segment_t *seg = &profile_data.segments[profile_data.num_builtin_segments + i];
+        segs[i] = (export_segment_t) {
+            .start  = seg->start,
+            .end    = seg->end,
+            .temp   = seg->temp,
+            .slope  = seg->slope,
+            .thresh = seg->thresh,
+            .wait   = seg->wait,
+        };
+    }
+    return len;
+}
+
+// replaces user profiles with those packed in buf by profile_export
+bool profile_import(const void *buf, size_t len) {
+    profile_data.num_profiles = PROFILE_BUILTIN_COUNT;
+    profile_data.num_segments = profile_data.num_builtin_segments;
+
+    const export_header_t *header = buf;
+    if (len < sizeof(export_header_t) || header->magic != EXPORT_MAGIC ||
+        header->num_profiles > PROFILE_MAX_USER ||
+        header->num_segments > MAX_SEGMENTS - profile_data.num_builtin_segments ||
+        len != sizeof(export_header_t) + header->num_profiles * sizeof(export_profile_t) +
+            header->num_segments * sizeof(export_segment_t)) {
+        return false;
+    }
+
+    const export_profile_t *profs = (const export_profile_t*) (header + 1);
+    const export_segment_t *segs = (const export_segment_t*) &profs[header->num_profiles];
+    size_t seg = 0;
+    for (size_t i = 0; i < header->num_profiles; i++) {
+        const export_profile_t *prof = &profs[i];
+        if (prof->num_segs > header->num_segments - seg) {
+            profile_data.num_profiles = PROFILE_BUILTIN_COUNT;
+            profile_data.num_segments = profile_data.num_builtin_segments;
+            return false;
+        }
+        for (size_t j = 0; j < prof->num_segs; j++, seg++) {
+            profile_data.segments[profile_data.num_segments + j] = (profile_segment_t) {
+                .start  = segs[seg].start,
+                .end    = segs[seg].end,
+                .temp   = segs[seg].temp,
+                .slope  = segs[seg].slope,
+                .thresh = segs[seg].thresh,
+                .wait   = segs[seg].wait,
+            };
+        }
+        const export_limits_t *lim = &prof->limits;
+        const profile_limits_t limits = {
+            .liquidus      = lim->liquidus,
+            .peak_min      = lim->peak_min,
+            .peak_max      = lim->peak_max,
+            .tal_min       = lim->tal_min,
+            .tal_max       = lim->tal_max,
+            .ramp_up_max   = lim->ramp_up_max,
+            .ramp_down_max = lim->ramp_down_max,
+            .soak_low      = lim->soak_low,
+            .soak_high     = lim->soak_high,
+            .soak_min      = lim->soak_min,
+            .soak_max      = lim->soak_max,
+            .dev_max       = lim->dev_max,
+        };
+        char name[PROFILE_NAME_LEN];
+        memcpy(name, prof->name, sizeof(name));
+        name[sizeof(name) - 1] = '\0';
+        register_segments(name, prof->num_segs, &limits);
+    }
+    return true;
+}
+
+void profile_cursor_init(profile_cursor_t *cursor, profile_type_t type) {
+    cursor->type        = type;
+    cursor->seg         = 0;
+    cursor->offset      = 0.0f;
+    cursor->manual_temp = ROOM_TEMP;
+}
+
+/*
+ * Time must not go backwards for a given cursor. Amortized O(1), each call
+ * only looks at the current segment unless it finished.
+ */
+profile_status_t profile_status(profile_cursor_t *cursor, real_t time, real_t temp) {
     profile_status_t ret = {
-        .temp = ROOM_TEMP,
-        .done = true,
+        .temp  = ROOM_TEMP,
+        .slope = 0.0f,
+        .done  = true,
     };
-    if (type == PROFILE_TYPE_MANUAL) {
-        ret.temp = profile_data.manual_temp;
+    if (cursor->type == PROFILE_TYPE_MANUAL) {
+        ret.temp = cursor->manual_temp;
         ret.done = false;
-    } else if (type < PROFILE_TYPE_COUNT) {
-        ret.temp = configs[type].pts[configs[type].num_pts - 1].temp;
-        for (size_t i = 1; i < configs[type].num_pts; i++) {
-            if (time < configs[type].pts[i].time) {
-                double m = (configs[type].pts[i].temp - configs[type].pts[i - 1].temp) / 
-                    (configs[type].pts[i].time - configs[type].pts[i - 1].time);
-                ret.temp = configs[type].pts[i - 1].temp + m * (time - configs[type].pts[i - 1].time);
-                ret.done = false;
+    } else if (cursor->type < profile_data.num_profiles) {
+        const profile_entry_t *prof = &profile_data.profiles[cursor->type];
+        const profile_segment_t *segs = &profile_data.segments[prof->first];
+        size_t num_segs = prof->num_segs;
+
+        ret.temp = prof->end_temp;
+        real_t t = time - cursor->offset;
+        while (cursor->seg < num_segs) {
+            const profile_segment_t *seg = &segs[cursor->seg];
+            if (seg->wait) {
+                if (!wait_done(seg, temp)) {
+                    ret.temp = seg->temp;
+                    ret.done = false;
+                    break;
+                }
+                cursor->offset += t - seg->start; // profile time resumes where the wait began
+                t = seg->start;
+            } else if (t < seg->end) {
+                ret.temp  = seg->temp + seg->slope * (t - seg->start);
+                ret.slope = seg->slope;
+                ret.done  = false;
                 break;
             }
+            cursor->seg++;
         }
     }
     return ret;
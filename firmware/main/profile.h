@@ -2,23 +2,91 @@
 #define PROFILE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "real.h"
 
-#define ROOM_TEMP (25.0) // C
+#define ROOM_TEMP (25.0f) // C
+
+// index into the built-in profiles followed by user profiles
+typedef uint16_t profile_type_t;
+
+#define PROFILE_TYPE_MANUAL   (0)
+#define PROFILE_TYPE_SAC305   (1)
+#define PROFILE_TYPE_SN63PB37 (2)
+#define PROFILE_BUILTIN_COUNT (3)
+
+#define PROFILE_MAX_USER  (32)
+#define PROFILE_MAX_STEPS (32) // per profile
+#define PROFILE_NAME_LEN  (24)
 
 typedef enum {
-    PROFILE_TYPE_MANUAL,
-    PROFILE_TYPE_SAC305,
-    PROFILE_TYPE_SN63PB37,
-    PROFILE_TYPE_COUNT
-} profile_type_t;
+    PROFILE_STEP_RAMP_TIME, // ramp to temp over value seconds
+    PROFILE_STEP_RAMP_RATE, // ramp to temp at value C/s
+    PROFILE_STEP_HOLD,      // hold previous temp for value seconds
+    PROFILE_STEP_REACH,     // hold temp until measured temp is within value C of it
+} profile_step_type_t;
+
+typedef struct {
+    profile_step_type_t type;
+    double              temp;  // C
+    double              value; // s, C/s or C depending on type
+} profile_step_t;
+
+/*
+ * Steps are compiled into segments once (in double), so evaluating a profile
+ * is a real_t multiply and add on the current segment. Times are profile
+ * time, which excludes time spent waiting on temperature.
+ */
+typedef struct {
+    real_t start;  // s
+    real_t end;    // s, same as start for waits
+    real_t temp;   // C at start
+    real_t slope;  // C/s
+    real_t thresh; // C, measured temp that ends a wait
+    int8_t wait;   // 0 if timed, 1 if waiting for rising temp, -1 for falling
+} profile_segment_t;
 
+// process window a run is judged against, liquidus 0 for none
 typedef struct {
-    double temp;
+    real_t liquidus;            // C
+    real_t peak_min, peak_max;  // C
+    real_t tal_min, tal_max;    // s above liquidus
+    real_t ramp_up_max;         // C/s
+    real_t ramp_down_max;       // C/s, positive
+    real_t soak_low, soak_high; // C
+    real_t soak_min, soak_max;  // s in the soak window before liquidus
+    real_t dev_max;             // C, tracking error while not cooling, 0 to ignore
+} profile_limits_t;
+
+typedef struct {
+    profile_type_t type;
+    size_t         seg;         // only ever moves forward
+    real_t         offset;      // s spent waiting on temperature
+    real_t         manual_temp; // C, the target of a manual run
+} profile_cursor_t;
+
+typedef struct {
+    real_t temp;
+    real_t slope; // C/s, 0 while waiting
     bool   done;
 } profile_status_t;
 
-void profile_set_temp(profile_type_t type, double temp);
+void profile_init(void);
+int  profile_compile(const profile_step_t *steps, size_t num_steps, double start_temp,
+                     profile_segment_t *segs, size_t max_segs);
 const char *profile_name(profile_type_t type);
-profile_status_t profile_status(profile_type_t type, double time);
+size_t profile_count(void);
+
+void profile_limits(profile_type_t type, profile_limits_t *limits);
+const profile_segment_t *profile_segments(profile_type_t type, size_t *num_segs);
+
+int  profile_add(const char *name, const profile_step_t *steps, size_t num_steps, const profile_limits_t *limits);
+bool profile_remove(profile_type_t type);
+size_t profile_export(void *buf, size_t size);
+bool profile_import(const void *buf, size_t len);
+
+void profile_cursor_init(profile_cursor_t *cursor, profile_type_t type);
+profile_status_t profile_status(profile_cursor_t *cursor, real_t time, real_t temp);
 
 #endif // PROFILE_H
@@ -0,0 +1,150 @@
+#include <string.h>
+#include <tgmath.h>
+#include "queue.h"
+
+/* private data */
+static const char *STATE_NAMES[] = {
+    [QUEUE_IDLE]    = "idle",
+    [QUEUE_RUNNING] = "running",
+    [QUEUE_WAITING] = "waiting",
+};
+
+/* private helpers */
+static real_t cool_time(const queue_t *queue, const control_t *ctrl) {
+    // s from the end of the run to below start_temp, the controller's cool-down to CONTROL_SAFE_TEMP moved over
+    const ident_model_t *model = &ctrl->ident.model;
+    const real_t safe = CONTROL_SAFE_TEMP;
+    real_t to_safe = ctrl->cooldown - ctrl->eta; // eta is 0 once the run is over
+    real_t t = (queue->start_temp >= safe) ?
+        to_safe - ident_time_to(model, queue->start_temp, safe, 0.0f) :
+        to_safe + ident_time_to(model, safe, queue->start_temp, 0.0f);
+    return (t < 0.0f) ? 0.0f : t; // ended below it already, NAN stays unknown
+}
+
+static void jobs_trim(queue_t *queue) {
+    // drops jobs with every run started, once none of them is going
+    while (queue->num > 0 && queue->jobs[0].done >= queue->jobs[0].count) {
+        memmove(&queue->jobs[0], &queue->jobs[1], (queue->num - 1) * sizeof(queue->jobs[0]));
+        queue->num--;
+    }
+}
+
+static queue_job_t *job_next(queue_t *queue) {
+    for (size_t i = 0; i < queue->num; i++) {
+        if (queue->jobs[i].done < queue->jobs[i].count) {
+            return &queue->jobs[i];
+        }
+    }
+    return NULL;
+}
+
+/* public functions */
+void queue_init(queue_t *queue, real_t start_temp) {
+    memset(queue, 0, sizeof(*queue));
+    queue->state      = QUEUE_IDLE;
+    queue->start_temp = start_temp;
+    queue->cycle      = NAN;
+    queue->predicted  = NAN;
+    queue->wait       = NAN;
+}
+
+bool queue_add(queue_t *queue, profile_type_t profile, uint16_t count, uint16_t boards) {
+    // manual runs only end when stopped, and a stop clears the queue
+    if (queue->num >= QUEUE_MAX_JOBS || profile == PROFILE_TYPE_MANUAL || profile >= profile_count() ||
+        count == 0 || boards == 0) {
+        return false;
+    }
+    queue->jobs[queue->num++] = (queue_job_t) {
+        .profile = profile,
+        .count   = count,
+        .boards  = boards,
+    };
+    return true;
+}
+
+// runs not started yet are dropped, one going carries on
+void queue_clear(queue_t *queue) {
+    queue->num = 0;
+    if (queue->state == QUEUE_RUNNING) {
+        queue->jobs[0].count = queue->jobs[0].done;
+        queue->num = 1;
+    }
+    queue->wait = NAN;
+}
+
+bool queue_temp_set(queue_t *queue, real_t start_temp) {
+    if (!(start_temp > ROOM_TEMP && start_temp <= QUEUE_TEMP_MAX)) {
+        return false;
+    }
+    queue->start_temp = start_temp;
+    return true;
+}
+
+size_t queue_pending(const queue_t *queue) {
+    size_t pending = 0;
+    for (size_t i = 0; i < queue->num; i++) {
+        pending += queue->jobs[i].count - queue->jobs[i].done;
+    }
+    return pending;
+}
+
+// after control_step, true with the profile to start if it's time for the next run
+bool queue_step(queue_t *queue, const control_t *ctrl, real_t now, profile_type_t *start) {
+    if (queue->state == QUEUE_RUNNING && !ctrl->running) {
+        queue->state   = QUEUE_WAITING;
+        queue->chained = true;
+        queue->ended   = now;
+    }
+    if (queue->state != QUEUE_RUNNING) {
+        jobs_trim(queue);
+        queue->state = (queue_pending(queue) > 0) ? QUEUE_WAITING : QUEUE_IDLE;
+    }
+
+    real_t cool = cool_time(queue, ctrl);
+    switch (queue->state) {
+        case QUEUE_RUNNING:
+            queue->predicted = now - queue->started + ctrl->eta + cool;
+            queue->wait      = (queue_pending(queue) > 0) ? ctrl->eta + cool : NAN;
+            return false;
+        case QUEUE_IDLE:
+            queue->chained = false; // whatever's added next starts a new batch
+            queue->wait    = NAN;
+            return false;
+        default:
+            // cool is NAN during some other manual run or autotune
+            queue->wait = ctrl->running ? ctrl->eta + cool : cool;
+            if (queue->chained && !ctrl->running) {
+                queue->predicted = now - queue->started + cool;
+            }
+            break;
+    }
+    if (ctrl->running || !(ctrl->current < queue->start_temp) || (queue->chained && now - queue->ended < QUEUE_GAP)) {
+        return false;
+    }
+
+    queue_job_t *job = job_next(queue);
+    if (queue->chained) {
+        real_t cycle = now - queue->started;
+        queue->cycle = isnan(queue->cycle) ? cycle : queue->cycle + QUEUE_CYCLE_WEIGHT * (cycle - queue->cycle);
+    }
+    job->done++;
+    queue->runs++;
+    queue->started = now;
+    queue->boards  = job->boards;
+    queue->state   = QUEUE_RUNNING;
+    queue->wait    = 0.0f;
+    *start = job->profile;
+    return true;
+}
+
+// measured once two runs have followed each other, predicted from the first before that
+real_t queue_throughput(const queue_t *queue) {
+    real_t cycle = isnan(queue->cycle) ? queue->predicted : queue->cycle;
+    const queue_job_t *job = (queue->runs > 0 || queue->num == 0) ? NULL : &queue->jobs[0];
+    real_t boards = job ? job->boards : queue->boards;
+    return (cycle > 0.0f) ? boards * 3600.0f / cycle : NAN;
+}
+
+const char *queue_state_name(queue_state_t state) {
+    return (state <= QUEUE_WAITING) ? STATE_NAMES[state] : "unknown";
+}
@@ -0,0 +1,60 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "control.h"
+
+/*
+ * Batches of runs back to back. Jobs are a profile, how many runs of it and
+ * how many boards each run carries. Stepped by the control task after every
+ * control step, the queue starts the next run as soon as the oven has
+ * finished the last one and cooled below the start temperature. Cycle time
+ * (start to start) is measured over runs that followed each other, and until
+ * there's one it's predicted from the run's end and the learned model's
+ * cool-down. Only profiles that end by themselves can be queued.
+ */
+
+#define QUEUE_MAX_JOBS     (8)
+#define QUEUE_CYCLE_WEIGHT (0.25f) // of the newest cycle in the smoothed cycle time
+#define QUEUE_GAP          (5.0f)  // s at least between runs, so status pollers see each one end
+#define QUEUE_TEMP_MAX     (150.0f) // C, a start temperature above this isn't a cool-down
+
+typedef enum {
+    QUEUE_IDLE,    // nothing left to start
+    QUEUE_RUNNING, // a run the queue started is going
+    QUEUE_WAITING, // for the oven to finish some other run, or to cool
+} queue_state_t;
+
+typedef struct {
+    profile_type_t profile;
+    uint16_t       count;  // runs asked for
+    uint16_t       done;   // runs started
+    uint16_t       boards; // per run
+} queue_job_t;
+
+typedef struct {
+    queue_job_t jobs[QUEUE_MAX_JOBS]; // oldest first, the current one while it has runs left or going
+    uint8_t     num;
+    uint8_t     state;      // queue_state_t
+    bool        chained;    // the next start follows a queued run, so it's a full cycle
+    real_t      start_temp; // C, the next run starts below this
+    real_t      started;    // s, when the current or last queued run started
+    real_t      ended;      // s, when the last queued run ended
+    uint16_t    boards;     // of the current or last queued run
+    uint32_t    runs;       // started by the queue
+    real_t      cycle;      // s start to start, smoothed, NAN until measured
+    real_t      predicted;  // s start to start from the run in progress, NAN if unknown
+    real_t      wait;       // s until the next run starts, NAN if unknown or nothing queued
+} queue_t;
+
+void queue_init(queue_t *queue, real_t start_temp);
+bool queue_add(queue_t *queue, profile_type_t profile, uint16_t count, uint16_t boards);
+void queue_clear(queue_t *queue);
+bool queue_temp_set(queue_t *queue, real_t start_temp);
+bool queue_step(queue_t *queue, const control_t *ctrl, real_t now, profile_type_t *start);
+size_t queue_pending(const queue_t *queue); // runs not started yet
+real_t queue_throughput(const queue_t *queue); // boards per hour, NAN if unknown
+const char *queue_state_name(queue_state_t state);
+
+#endif // QUEUE_H
@@ -0,0 +1,19 @@
+#ifndef REAL_H
+#define REAL_H
+
+/*
+ * Scalar type of the control core. The ESP32-C3 has no FPU, so every
+ * operation is a soft-float library call, and single precision ones take
+ * about half the cycles of double. Building with CONTROL_DOUBLE gives the
+ * double reference the float path is checked against on the host (see
+ * sim/equiv_test.c). Core sources use <tgmath.h> so fabs() and friends follow
+ * real_t, literals must be float (1.0f) or cast so they don't promote.
+ */
+
+#ifdef CONTROL_DOUBLE
+typedef double real_t;
+#else
+typedef float real_t;
+#endif
+
+#endif // REAL_H
@@ -0,0 +1,30 @@
+#include "ring.h"
+
+/* public functions */
+void ring_init(ring_t *ring) {
+    spsc_init(&ring->spsc);
+}
+
+bool ring_push(ring_t *ring, const ring_sample_t *sample) {
+    unsigned slot;
+    if (!spsc_reserve(&ring->spsc, RING_LEN, &slot)) {
+        return false;
+    }
+    ring->samples[slot] = *sample;
+    spsc_commit(&ring->spsc);
+    return true;
+}
+
+bool ring_pop(ring_t *ring, ring_sample_t *sample) {
+    unsigned slot;
+    if (!spsc_front(&ring->spsc, RING_LEN, &slot)) {
+        return false;
+    }
+    *sample = ring->samples[slot];
+    spsc_release(&ring->spsc);
+    return true;
+}
+
+uint32_t ring_dropped(ring_t *ring) {
+    return spsc_dropped(&ring->spsc);
+}
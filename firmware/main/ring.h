@@ -0,0 +1,32 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensor.h"
+#include "spsc.h"
+
+/*
+ * Lock-free queue of raw sensor samples, see spsc.h. The acquisition task
+ * pushes and the oven task pops, neither ever blocks.
+ */
+
+#define RING_LEN (8) // power of two
+
+typedef struct {
+    int64_t  time; // us, when the frames were read
+    uint8_t  num;
+    uint16_t raw[SENSOR_MAX];
+} ring_sample_t;
+
+typedef struct {
+    ring_sample_t samples[RING_LEN];
+    spsc_t        spsc; // dropped counts pushes while full
+} ring_t;
+
+void ring_init(ring_t *ring);
+bool ring_push(ring_t *ring, const ring_sample_t *sample);
+bool ring_pop(ring_t *ring, ring_sample_t *sample);
+uint32_t ring_dropped(ring_t *ring);
+
+#endif // RING_H
@@ -0,0 +1,301 @@
+#include <math.h>
+#include <string.h>
+#include "runlog.h"
+
+/* private data */
+#define LIMIT(x, low, high) ((x < low) ? (low) : ((x > high) ? (high) : (x)))
+
+#define FIRST_OFFSET (sizeof(runlog_block_t) + sizeof(runlog_header_t)) // samples in a run's first block
+#define OFFSET       (sizeof(runlog_block_t))                            // in the others
+#define END_OFFSET   (RUNLOG_BLOCK - sizeof(runlog_end_t))               // samples stop here
+
+_Static_assert(sizeof(runlog_block_t) == 20, "block header layout");
+_Static_assert(sizeof(runlog_sample_t) == 6, "sample layout");
+
+/* private helpers */
+static uint32_t crc32(const void *data, size_t len) {
+    // only ever over a block header, no table needed
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= bytes[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static bool block_valid(const runlog_block_t *block) {
+    return block->magic == RUNLOG_MAGIC && block->run != 0 &&
+        block->crc == crc32(block, offsetof(runlog_block_t, crc));
+}
+
+static int block_find(const runlog_t *log, uint32_t run, uint16_t index) {
+    for (uint32_t i = 0; i < log->flash.blocks; i++) {
+        if (log->run[i] == run && log->index[i] == index) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool run_open(const runlog_t *log, uint32_t run) {
+    for (int zone = 0; zone < RUNLOG_ZONES; zone++) {
+        if (run != 0 && log->open[zone] == run) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void run_forget(runlog_t *log, uint32_t run) {
+    for (uint32_t i = 0; i < log->flash.blocks; i++) {
+        if (log->run[i] == run) {
+            log->run[i] = 0;
+        }
+    }
+}
+
+static bool block_flush(runlog_t *log, int zone, const runlog_end_t *end) {
+    // writes the zone's buffer to the block at head, evicting whatever run lives there, end only for the last
+    uint32_t pos = log->head;
+    if (run_open(log, log->run[pos])) {
+        return false; // the open runs alone fill the partition
+    }
+    if (log->run[pos] != 0) {
+        run_forget(log, log->run[pos]);
+        log->evicted++;
+    }
+
+    uint8_t *buf = log->buf[zone];
+    runlog_block_t *block = (runlog_block_t*) buf;
+    block->magic = RUNLOG_MAGIC;
+    block->run   = log->open[zone];
+    block->seq   = log->seq;
+    block->index = log->open_index[zone];
+    block->count = log->open_count[zone];
+    block->crc   = crc32(block, offsetof(runlog_block_t, crc));
+
+    // header last, so a write cut short leaves a free block rather than a bad one
+    uint32_t offset = pos * RUNLOG_BLOCK;
+    const runlog_flash_t *flash = &log->flash;
+    if (!flash->erase(flash->ctx, offset) ||
+        !flash->write(flash->ctx, offset + OFFSET, buf + OFFSET, log->len[zone] - OFFSET) ||
+        (end && !flash->write(flash->ctx, offset + END_OFFSET, end, sizeof(*end))) ||
+        !flash->write(flash->ctx, offset, block, sizeof(*block))) {
+        return false;
+    }
+
+    log->run[pos]   = log->open[zone];
+    log->index[pos] = log->open_index[zone];
+    log->count[pos] = log->open_count[zone];
+    log->head       = (pos + 1) % flash->blocks;
+    log->seq++;
+    log->open_index[zone]++;
+    log->open_count[zone] = 0;
+    log->len[zone]        = OFFSET;
+    return true;
+}
+
+/* public functions */
+bool runlog_mount(runlog_t *log, const runlog_flash_t *flash) {
+    log->flash = *flash;
+    if (log->flash.blocks > RUNLOG_MAX_BLOCKS) {
+        log->flash.blocks = RUNLOG_MAX_BLOCKS;
+    }
+    log->head    = 0;
+    log->seq     = 0;
+    log->next_id = 1;
+    log->evicted = 0;
+    memset(log->open, 0, sizeof(log->open));
+
+    // newest block decides where writing continues, highest id is the next one's
+    uint32_t newest_run = 0;
+    for (uint32_t i = 0; i < log->flash.blocks; i++) {
+        runlog_block_t block;
+        if (!flash->read(flash->ctx, i * RUNLOG_BLOCK, &block, sizeof(block))) {
+            return false;
+        }
+        bool valid   = block_valid(&block);
+        log->run[i]   = valid ? block.run   : 0;
+        log->index[i] = valid ? block.index : 0;
+        log->count[i] = valid ? block.count : 0;
+        if (valid && block.seq >= log->seq) {
+            log->seq  = block.seq + 1;
+            log->head = (i + 1) % log->flash.blocks;
+        }
+        if (valid && block.run > newest_run) {
+            newest_run = block.run;
+        }
+    }
+    log->next_id = newest_run + 1;
+
+    // drop runs cut short by eviction or a deletion that didn't finish
+    for (uint32_t i = 0; i < log->flash.blocks; i++) {
+        uint32_t run = log->run[i];
+        if (run == 0) {
+            continue;
+        }
+        uint16_t index = 0;
+        while (block_find(log, run, index) >= 0) {
+            index++;
+        }
+        for (uint32_t j = 0; j < log->flash.blocks; j++) {
+            if (log->run[j] == run && log->index[j] >= index) {
+                run_forget(log, run);
+                break;
+            }
+        }
+        if (index == 0) {
+            run_forget(log, run);
+        }
+    }
+    return true;
+}
+
+uint32_t runlog_begin(runlog_t *log, const runlog_header_t *header) {
+    int zone = header->zone;
+    if (zone >= RUNLOG_ZONES || log->open[zone] != 0 || log->flash.blocks < 2) {
+        return 0;
+    }
+    log->open[zone]       = log->next_id++;
+    log->open_index[zone] = 0;
+    log->open_count[zone] = 0;
+    memcpy(log->buf[zone] + OFFSET, header, sizeof(*header));
+    log->len[zone] = FIRST_OFFSET;
+    return log->open[zone];
+}
+
+bool runlog_append(runlog_t *log, int zone, const runlog_sample_t *sample) {
+    if (zone < 0 || zone >= RUNLOG_ZONES || log->open[zone] == 0) {
+        return false;
+    }
+    if (log->len[zone] + sizeof(*sample) > END_OFFSET && !block_flush(log, zone, NULL)) {
+        return false;
+    }
+    memcpy(log->buf[zone] + log->len[zone], sample, sizeof(*sample));
+    log->len[zone] += sizeof(*sample);
+    log->open_count[zone]++;
+    return true;
+}
+
+bool runlog_end(runlog_t *log, int zone, const analytics_result_t *quality) {
+    // a run without samples leaves nothing behind, blocks already written stay valid if this fails
+    if (zone < 0 || zone >= RUNLOG_ZONES) {
+        return false;
+    }
+    bool ok = true;
+    if (log->open[zone] != 0 && log->open_count[zone] > 0) {
+        runlog_end_t end = {
+            .magic   = RUNLOG_END_MAGIC,
+            .quality = quality ? *quality : (analytics_result_t) { .verdict = ANALYTICS_NONE },
+        };
+        ok = block_flush(log, zone, &end);
+    }
+    log->open[zone] = 0;
+    return ok;
+}
+
+size_t runlog_list(const runlog_t *log, uint32_t *runs, size_t max) {
+    size_t n = 0;
+    for (uint32_t i = 0; i < log->flash.blocks && n < max; i++) {
+        if (log->run[i] == 0 || log->index[i] != 0 || run_open(log, log->run[i])) {
+            continue;
+        }
+        // insertion sort, ids grow with time
+        size_t j = n++;
+        for (; j > 0 && runs[j - 1] > log->run[i]; j--) {
+            runs[j] = runs[j - 1];
+        }
+        runs[j] = log->run[i];
+    }
+    return n;
+}
+
+bool runlog_info(const runlog_t *log, uint32_t run, runlog_info_t *info) {
+    int pos = !run_open(log, run) ? block_find(log, run, 0) : -1;
+    if (pos < 0 || !log->flash.read(log->flash.ctx, pos * RUNLOG_BLOCK + OFFSET, &info->header, sizeof(info->header))) {
+        return false;
+    }
+    info->run     = run;
+    info->samples = 0;
+    info->blocks  = 0;
+    int last = pos;
+    for (uint32_t i = 0; i < log->flash.blocks; i++) {
+        if (log->run[i] == run) {
+            info->samples += log->count[i];
+            info->blocks++;
+            last = (log->index[i] > log->index[last]) ? i : last;
+        }
+    }
+    runlog_end_t end;
+    info->finished = log->flash.read(log->flash.ctx, last * RUNLOG_BLOCK + END_OFFSET, &end, sizeof(end)) &&
+        end.magic == RUNLOG_END_MAGIC;
+    info->quality  = info->finished ? end.quality : (analytics_result_t) { .verdict = ANALYTICS_NONE };
+    info->header.profile[PROFILE_NAME_LEN - 1] = '\0';
+    return true;
+}
+
+size_t runlog_read(const runlog_t *log, uint32_t run, uint32_t first, runlog_sample_t *out, size_t max) {
+    // samples first..first+max of a finished run, straight from flash
+    size_t n = 0;
+    if (run_open(log, run)) {
+        return 0;
+    }
+    for (uint16_t index = 0; n < max; index++) {
+        int pos = block_find(log, run, index);
+        if (pos < 0) {
+            break;
+        }
+        uint32_t count = log->count[pos];
+        if (first >= count) {
+            first -= count;
+            continue;
+        }
+        size_t len = LIMIT(count - first, 0, max - n);
+        uint32_t offset = pos * RUNLOG_BLOCK + (index == 0 ? FIRST_OFFSET : OFFSET) + first * sizeof(*out);
+        if (!log->flash.read(log->flash.ctx, offset, &out[n], len * sizeof(*out))) {
+            break;
+        }
+        n    += len;
+        first = 0;
+    }
+    return n;
+}
+
+bool runlog_delete(runlog_t *log, uint32_t run) {
+    if (run == 0 || run_open(log, run) || block_find(log, run, 0) < 0) {
+        return false;
+    }
+    // first block first, a run without it is dropped at mount
+    bool ok = true;
+    for (uint16_t index = 0; ; index++) {
+        int pos = block_find(log, run, index);
+        if (pos < 0) {
+            break;
+        }
+        ok = log->flash.erase(log->flash.ctx, pos * RUNLOG_BLOCK) && ok;
+        log->run[pos] = 0;
+    }
+    return ok;
+}
+
+runlog_sample_t runlog_pack(const history_sample_t *sample) {
+    runlog_sample_t packed = {
+        .current = lroundf(LIMIT(sample->current * 16.0f, INT16_MIN, INT16_MAX)),
+        .target  = lroundf(LIMIT(sample->target  * 16.0f, INT16_MIN, INT16_MAX)),
+        .duty    = lroundf(LIMIT(sample->duty, 0.0f, 1.0f) * UINT16_MAX),
+    };
+    return packed;
+}
+
+history_sample_t runlog_unpack(const runlog_sample_t *sample, uint32_t time) {
+    history_sample_t unpacked = {
+        .time    = time,
+        .current = sample->current / 16.0,
+        .target  = sample->target  / 16.0,
+        .duty    = (double) sample->duty / UINT16_MAX,
+    };
+    return unpacked;
+}
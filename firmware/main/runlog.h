@@ -0,0 +1,112 @@
+#ifndef RUNLOG_H
+#define RUNLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "analytics.h"
+#include "history.h"
+#include "profile.h"
+
+/*
+ * Append-only log of oven runs on a raw flash partition, used as a circle of
+ * erase blocks. Samples are buffered in RAM and each block is erased and
+ * written exactly once when it fills (or the run ends), so every block is
+ * erased once per lap of the partition. A block is written payload first and
+ * header last, a block without a valid header is treated as free. The last
+ * block of a finished run also ends in its quality result. When the write
+ * position reaches a block of an older run, that whole run is evicted.
+ * Each zone has a run of its own open, so blocks of runs that overlap
+ * interleave on flash and carry a write sequence to find the head by.
+ * Not thread-safe, the owner provides locking.
+ */
+
+#define RUNLOG_BLOCK      (4096) // flash erase block
+#define RUNLOG_MAX_BLOCKS (256)
+#define RUNLOG_ZONES      (4)    // runs open at once, one per zone
+#define RUNLOG_MAGIC      (0x4C52534F) // "OSRL"
+#define RUNLOG_END_MAGIC  (0x4552534F) // "OSRE"
+
+// flash access relative to the partition, false on error
+typedef struct {
+    bool   (*read)(void *ctx, uint32_t offset, void *buf, size_t len);
+    bool   (*write)(void *ctx, uint32_t offset, const void *buf, size_t len);
+    bool   (*erase)(void *ctx, uint32_t offset); // one block
+    void    *ctx;
+    uint32_t blocks;
+} runlog_flash_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t run;   // id, increasing, never 0
+    uint32_t seq;   // blocks written before this one
+    uint16_t index; // block within the run
+    uint16_t count; // samples in this block
+    uint32_t crc;   // of the fields above
+} runlog_block_t;
+
+// at the start of a run's first block
+typedef struct {
+    uint32_t start;  // unix time, 0 if the clock wasn't set
+    uint32_t period; // ms between samples
+    char     profile[PROFILE_NAME_LEN];
+    float    kp, ki, kd;
+    uint8_t  mode;   // control_mode_t
+    uint8_t  zone;   // see oven.h, 0 in runs from before zones
+    uint8_t  reserved[2];
+} runlog_header_t;
+
+// fixed point, 6 bytes per control tick
+typedef struct {
+    int16_t  current; // C * 16
+    int16_t  target;  // C * 16
+    uint16_t duty;    // 0-65535
+} runlog_sample_t;
+
+// at the very end of a run's last block, erased in the others
+typedef struct {
+    uint32_t           magic;
+    analytics_result_t quality;
+} runlog_end_t;
+
+typedef struct {
+    uint32_t           run;
+    uint32_t           samples;
+    uint32_t           blocks;
+    runlog_header_t    header;
+    bool               finished; // false if cut short by power loss
+    analytics_result_t quality;
+} runlog_info_t;
+
+typedef struct {
+    runlog_flash_t flash;
+    uint32_t       run[RUNLOG_MAX_BLOCKS];   // per block, 0 if free
+    uint16_t       index[RUNLOG_MAX_BLOCKS];
+    uint16_t       count[RUNLOG_MAX_BLOCKS];
+    uint32_t       head;    // next block to write
+    uint32_t       seq;     // of the next block written
+    uint32_t       next_id;
+    uint32_t       evicted; // runs dropped to make room
+
+    // run being written per zone, open is 0 if none
+    uint32_t open[RUNLOG_ZONES];
+    uint16_t open_index[RUNLOG_ZONES];
+    uint16_t open_count[RUNLOG_ZONES];
+    size_t   len[RUNLOG_ZONES];
+    uint8_t  buf[RUNLOG_ZONES][RUNLOG_BLOCK];
+} runlog_t;
+
+bool     runlog_mount(runlog_t *log, const runlog_flash_t *flash);
+uint32_t runlog_begin(runlog_t *log, const runlog_header_t *header); // in header->zone, 0 on failure
+bool     runlog_append(runlog_t *log, int zone, const runlog_sample_t *sample);
+bool     runlog_end(runlog_t *log, int zone, const analytics_result_t *quality);
+
+size_t runlog_list(const runlog_t *log, uint32_t *runs, size_t max); // oldest first, finished runs only
+bool   runlog_info(const runlog_t *log, uint32_t run, runlog_info_t *info);
+size_t runlog_read(const runlog_t *log, uint32_t run, uint32_t first, runlog_sample_t *out, size_t max);
+bool   runlog_delete(runlog_t *log, uint32_t run);
+
+runlog_sample_t  runlog_pack(const history_sample_t *sample);
+history_sample_t runlog_unpack(const runlog_sample_t *sample, uint32_t time);
+
+#endif // RUNLOG_H
@@ -0,0 +1,187 @@
+#include <string.h>
+#include <time.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_log.h>
+#include <esp_partition.h>
+#include "oven.h"
+#include "runs.h"
+
+/* private data */
+#define RUNS_PARTITION "runlog"
+#define RUNS_POLL_MS   (1000) // well inside the history ring
+#define RUNS_CHUNK     (16)   // samples per history read
+#define CLOCK_SET      (1600000000) // s, anything earlier means SNTP hasn't answered
+
+static const char *TAG = "runs";
+
+/*
+ * The oven task never sees the log. The runs task follows every zone's
+ * history like any other reader and does the flash writes, one erase block
+ * every few minutes of a run. The lock only covers the log's index and write
+ * buffers.
+ */
+_Static_assert(OVEN_MAX_ZONES <= RUNLOG_ZONES, "a run open per zone");
+
+static struct {
+    const esp_partition_t *part;
+    runlog_t               log;
+    SemaphoreHandle_t      lock;
+    uint32_t               seq[OVEN_MAX_ZONES]; // last history sample logged
+} runs_data;
+
+/* private helpers */
+static bool flash_read(void *ctx, uint32_t offset, void *buf, size_t len) {
+    return esp_partition_read(ctx, offset, buf, len) == ESP_OK;
+}
+
+static bool flash_write(void *ctx, uint32_t offset, const void *buf, size_t len) {
+    return esp_partition_write(ctx, offset, buf, len) == ESP_OK;
+}
+
+static bool flash_erase(void *ctx, uint32_t offset) {
+    return esp_partition_erase_range(ctx, offset, RUNLOG_BLOCK) == ESP_OK;
+}
+
+static void run_begin(int zone, const oven_status_t *status) {
+    runlog_header_t header = {
+        .start  = (time(NULL) > CLOCK_SET) ? time(NULL) : 0,
+        .period = CONTROL_PERIOD_MS,
+        .kp     = status->kp,
+        .ki     = status->ki,
+        .kd     = status->kd,
+        .mode   = status->mode,
+        .zone   = zone,
+    };
+    strncpy(header.profile, status->tuning ? "autotune" : profile_name(status->profile), sizeof(header.profile) - 1);
+
+    xSemaphoreTake(runs_data.lock, portMAX_DELAY);
+    uint32_t run = runlog_begin(&runs_data.log, &header);
+    xSemaphoreGive(runs_data.lock);
+    runs_data.seq[zone] = (status->seq > 0) ? (status->seq - 1) : 0; // from the tick that saw it running
+    ESP_LOGI(TAG, "recording run %u (%s in %s)", (unsigned) run, header.profile, oven_zone_name(zone));
+}
+
+static void run_follow(int zone) {
+    history_sample_t samples[RUNS_CHUNK];
+    size_t n;
+    do {
+        n = oven_history(zone, runs_data.seq[zone], samples, RUNS_CHUNK, &runs_data.seq[zone]);
+        xSemaphoreTake(runs_data.lock, portMAX_DELAY);
+        for (size_t i = 0; i < n; i++) {
+            const runlog_sample_t packed = runlog_pack(&samples[i]);
+            runlog_append(&runs_data.log, zone, &packed);
+        }
+        xSemaphoreGive(runs_data.lock);
+    } while (n == RUNS_CHUNK);
+}
+
+static void run_end(int zone, const oven_status_t *status) {
+    xSemaphoreTake(runs_data.lock, portMAX_DELAY);
+    uint32_t run     = runs_data.log.open[zone];
+    uint32_t evicted = runs_data.log.evicted;
+    bool ok = runlog_end(&runs_data.log, zone, &status->quality);
+    evicted = runs_data.log.evicted - evicted;
+    xSemaphoreGive(runs_data.lock);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "run %u incomplete, flash error or longer than the partition", (unsigned) run);
+    } else {
+        ESP_LOGI(TAG, "run %u saved (%s), evicted %u old runs", (unsigned) run,
+            analytics_verdict_name(status->quality.verdict), (unsigned) evicted);
+    }
+}
+
+static void runs_thread(void *arg) {
+    TickType_t wait = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&wait, pdMS_TO_TICKS(RUNS_POLL_MS));
+        for (int zone = 0; zone < oven_zone_count(); zone++) {
+            oven_status_t status;
+            oven_status(zone, &status);
+            bool recording = runs_recording(zone) != 0;
+            if (!recording && status.running) {
+                run_begin(zone, &status);
+                recording = true;
+            }
+            if (recording) {
+                run_follow(zone);
+                if (!status.running) {
+                    run_end(zone, &status);
+                }
+            }
+        }
+    }
+    vTaskDelete(NULL);
+}
+
+/* public functions */
+void runs_init(void) {
+    runs_data.part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, RUNS_PARTITION);
+    if (runs_data.part == NULL) {
+        ESP_LOGE(TAG, "no run log partition, runs won't be recorded");
+        return;
+    }
+    const runlog_flash_t flash = {
+        .read   = flash_read,
+        .write  = flash_write,
+        .erase  = flash_erase,
+        .ctx    = (void*) runs_data.part,
+        .blocks = runs_data.part->size / RUNLOG_BLOCK,
+    };
+    if (!runlog_mount(&runs_data.log, &flash)) {
+        ESP_LOGE(TAG, "can't read run log partition");
+        runs_data.part = NULL;
+        return;
+    }
+    ESP_LOGI(TAG, "run log mounted, %u blocks, next run %u",
+        (unsigned) runs_data.log.flash.blocks, (unsigned) runs_data.log.next_id);
+
+    runs_data.lock = xSemaphoreCreateMutex();
+    xTaskCreate(runs_thread, "runs", 3072, NULL, tskIDLE_PRIORITY + 2, NULL);
+}
+
+size_t runs_list(uint32_t *runs, size_t max) {
+    if (runs_data.part == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(runs_data.lock, portMAX_DELAY);
+    size_t n = runlog_list(&runs_data.log, runs, max);
+    xSemaphoreGive(runs_data.lock);
+    return n;
+}
+
+bool runs_info(uint32_t run, runlog_info_t *info) {
+    if (runs_data.part == NULL) {
+        return false;
+    }
+    xSemaphoreTake(runs_data.lock, portMAX_DELAY);
+    bool ok = runlog_info(&runs_data.log, run, info);
+    xSemaphoreGive(runs_data.lock);
+    return ok;
+}
+
+size_t runs_read(uint32_t run, uint32_t first, runlog_sample_t *samples, size_t max) {
+    if (runs_data.part == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(runs_data.lock, portMAX_DELAY);
+    size_t n = runlog_read(&runs_data.log, run, first, samples, max);
+    xSemaphoreGive(runs_data.lock);
+    return n;
+}
+
+bool runs_delete(uint32_t run) {
+    if (runs_data.part == NULL) {
+        return false;
+    }
+    xSemaphoreTake(runs_data.lock, portMAX_DELAY);
+    bool ok = runlog_delete(&runs_data.log, run);
+    xSemaphoreGive(runs_data.lock);
+    return ok;
+}
+
+uint32_t runs_recording(int zone) {
+    return runs_data.part ? runs_data.log.open[zone] : 0; // one aligned word
+}
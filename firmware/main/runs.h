@@ -0,0 +1,17 @@
+#ifndef RUNS_H
+#define RUNS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "runlog.h"
+
+// every run recorded to the runlog partition, safe to call from any task
+void     runs_init(void);
+size_t   runs_list(uint32_t *runs, size_t max); // oldest first
+bool     runs_info(uint32_t run, runlog_info_t *info);
+size_t   runs_read(uint32_t run, uint32_t first, runlog_sample_t *samples, size_t max);
+bool     runs_delete(uint32_t run);
+uint32_t runs_recording(int zone); // open run, 0 if none
+
+#endif // RUNS_H
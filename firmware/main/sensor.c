@@ -0,0 +1,140 @@
+#include <tgmath.h>
+#include "sensor.h"
+
+/* private data */
+#define SENSOR_LSB    (0.25f) // C
+#define OUTLIER_BAND  (10.0f) // C, faster than the oven can move in a tick
+#define RESYNC_TICKS  (8)    // all sensors rejected this long means the estimate is wrong
+
+#define MEAS_VAR      (0.25f)          // C^2 per sensor, MAX6675 noise is around +/-0.5C
+#define ACCEL_VAR     ((real_t) 0.05) // (C/s^2)^2, how quickly ramps start and stop
+
+/* private helpers */
+static real_t median(const real_t *vals, size_t num) {
+    real_t sorted[SENSOR_MAX];
+    for (size_t i = 0; i < num; i++) {
+        size_t j = i;
+        for (; j > 0 && sorted[j - 1] > vals[i]; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = vals[i];
+    }
+    return (num % 2) ? sorted[num / 2] : (sorted[num / 2 - 1] + sorted[num / 2]) * 0.5f;
+}
+
+static void filter_reset(sensor_filter_t *filter, real_t temp) {
+    filter->temp     = temp;
+    filter->rate     = 0.0f;
+    filter->p[0][0]  = MEAS_VAR;
+    filter->p[0][1]  = 0.0f;
+    filter->p[1][0]  = 0.0f;
+    filter->p[1][1]  = 1.0f; // (C/s)^2, could be mid-ramp
+    filter->rejected = 0;
+    filter->init     = true;
+}
+
+static void filter_predict(sensor_filter_t *filter, real_t dt) {
+    real_t (*p)[2] = filter->p;
+    filter->temp += filter->rate * dt;
+
+    // P = F P F' + Q, constant rate with white noise acceleration
+    real_t q = ACCEL_VAR * dt;
+    real_t cross = dt * p[1][1] + q * dt * 0.5f;
+    p[0][0] += dt * (p[1][0] + p[0][1]) + dt * dt * p[1][1] + q * dt * dt * (real_t) (1.0 / 3.0);
+    p[0][1] += cross;
+    p[1][0] += cross;
+    p[1][1] += q;
+}
+
+static void filter_update(sensor_filter_t *filter, real_t meas, real_t var) {
+    real_t (*p)[2] = filter->p;
+    real_t innov = meas - filter->temp;
+    real_t s_inv = 1.0f / (p[0][0] + var); // one divide instead of two
+    real_t k0    = p[0][0] * s_inv;
+    real_t k1    = p[1][0] * s_inv;
+    filter->temp += k0 * innov;
+    filter->rate += k1 * innov;
+
+    real_t p00 = p[0][0], p01 = p[0][1];
+    p[0][0] -= k0 * p00;
+    p[0][1] -= k0 * p01;
+    p[1][0] -= k1 * p00;
+    p[1][1] -= k1 * p01;
+}
+
+/* public functions */
+void sensor_decode(uint16_t raw, sensor_reading_t *reading) {
+    // D15 dummy, D14-D3 temp, D2 open, D1 device ID, D0 tri-state
+    reading->temp  = (real_t) (raw >> 3) * SENSOR_LSB; // exact, 12 bits
+    reading->fault = 0;
+    if (raw & 0x8002) {
+        reading->fault |= SENSOR_FAULT_BUS;
+    } else if (raw & 0x0004) {
+        reading->fault |= SENSOR_FAULT_OPEN;
+    }
+}
+
+const char *sensor_fault_name(uint8_t fault) {
+    if (fault & SENSOR_FAULT_BUS) {
+        return "bus";
+    } else if (fault & SENSOR_FAULT_OPEN) {
+        return "open";
+    } else if (fault & SENSOR_FAULT_OUTLIER) {
+        return "outlier";
+    }
+    return "ok";
+}
+
+void sensor_filter_init(sensor_filter_t *filter) {
+    filter->temp = 0.0f;
+    filter->rate = 0.0f;
+    filter->init = false;
+}
+
+// marks outliers in readings, returns false if every sensor has faulted
+bool sensor_fuse(sensor_filter_t *filter, sensor_reading_t *readings, size_t num, real_t dt) {
+    real_t vals[SENSOR_MAX];
+    size_t num_vals = 0;
+    for (size_t i = 0; i < num && i < SENSOR_MAX; i++) {
+        readings[i].fault &= ~SENSOR_FAULT_OUTLIER;
+        if (!readings[i].fault) {
+            vals[num_vals++] = readings[i].temp;
+        }
+    }
+    if (num_vals == 0) {
+        return false;
+    }
+    if (!filter->init) {
+        filter_reset(filter, median(vals, num_vals));
+    }
+    filter_predict(filter, dt);
+
+    // a majority decides when there is one, otherwise trust the estimate
+    real_t ref = (num_vals >= 3) ? median(vals, num_vals) : filter->temp;
+    real_t sum = 0.0f;
+    size_t used = 0;
+    for (size_t i = 0; i < num && i < SENSOR_MAX; i++) {
+        if (readings[i].fault) {
+            continue;
+        }
+        if (fabs(readings[i].temp - ref) > OUTLIER_BAND) {
+            readings[i].fault |= SENSOR_FAULT_OUTLIER;
+        } else {
+            sum += readings[i].temp;
+            used++;
+        }
+    }
+
+    if (used > 0) {
+        filter->rejected = 0;
+        filter_update(filter, sum / (real_t) used, MEAS_VAR / (real_t) used);
+    } else if (++filter->rejected >= RESYNC_TICKS) {
+        filter_reset(filter, median(vals, num_vals));
+    }
+    return true;
+}
+
+// temp extrapolated age seconds past the last fused sample
+real_t sensor_estimate(const sensor_filter_t *filter, real_t age) {
+    return filter->temp + filter->rate * age;
+}
@@ -0,0 +1,42 @@
+#ifndef SENSOR_H
+#define SENSOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "real.h"
+
+/*
+ * Thermocouple fusion. Raw MAX6675 frames are decoded with their fault bits,
+ * faulted and outlying sensors are dropped, and the rest are averaged into a
+ * constant-rate Kalman filter for a lower-noise temperature and rate estimate.
+ */
+
+#define SENSOR_MAX (4)
+
+// fault flags
+#define SENSOR_FAULT_OPEN    (1 << 0) // thermocouple input open (D2)
+#define SENSOR_FAULT_BUS     (1 << 1) // bad frame, dummy or device ID bit set
+#define SENSOR_FAULT_OUTLIER (1 << 2) // disagrees with the other sensors or the estimate
+
+typedef struct {
+    real_t  temp;  // C
+    uint8_t fault;
+} sensor_reading_t;
+
+typedef struct {
+    real_t temp;     // C
+    real_t rate;     // C/s
+    real_t p[2][2];  // estimate covariance
+    int    rejected; // consecutive ticks without a usable reading
+    bool   init;
+} sensor_filter_t;
+
+void sensor_decode(uint16_t raw, sensor_reading_t *reading);
+const char *sensor_fault_name(uint8_t fault);
+
+void sensor_filter_init(sensor_filter_t *filter);
+bool sensor_fuse(sensor_filter_t *filter, sensor_reading_t *readings, size_t num, real_t dt);
+real_t sensor_estimate(const sensor_filter_t *filter, real_t age);
+
+#endif // SENSOR_H
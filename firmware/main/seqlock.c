@@ -0,0 +1,26 @@
+#include "seqlock.h"
+
+/* public functions */
+void seqlock_init(seqlock_t *lock) {
+    atomic_init(&lock->seq, 0);
+}
+
+void seqlock_write_begin(seqlock_t *lock) {
+    unsigned seq = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+    atomic_store_explicit(&lock->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // odd seq visible before any data
+}
+
+void seqlock_write_end(seqlock_t *lock) {
+    unsigned seq = atomic_load_explicit(&lock->seq, memory_order_relaxed);
+    atomic_store_explicit(&lock->seq, seq + 1, memory_order_release);
+}
+
+unsigned seqlock_read_begin(seqlock_t *lock) {
+    return atomic_load_explicit(&lock->seq, memory_order_acquire);
+}
+
+bool seqlock_read_retry(seqlock_t *lock, unsigned seq) {
+    atomic_thread_fence(memory_order_acquire); // data reads done before seq is checked again
+    return (seq & 1) || atomic_load_explicit(&lock->seq, memory_order_relaxed) != seq;
+}
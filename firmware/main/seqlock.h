@@ -0,0 +1,27 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/*
+ * Sequence lock for one writer and any number of readers. The writer never
+ * waits, readers copy the data and retry if a write overlapped their copy.
+ *
+ *     do {
+ *         seq = seqlock_read_begin(&lock);
+ *         copy = data;
+ *     } while (seqlock_read_retry(&lock, seq));
+ */
+
+typedef struct {
+    atomic_uint seq; // odd while a write is in progress
+} seqlock_t;
+
+void     seqlock_init(seqlock_t *lock);
+void     seqlock_write_begin(seqlock_t *lock);
+void     seqlock_write_end(seqlock_t *lock);
+unsigned seqlock_read_begin(seqlock_t *lock);
+bool     seqlock_read_retry(seqlock_t *lock, unsigned seq);
+
+#endif // SEQLOCK_H
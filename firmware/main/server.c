@@ -1,145 +1,685 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <esp_http_server.h>
 #include <esp_log.h>
-#include <esp_spiffs.h>
+#include <esp_partition.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 #include <cJSON.h>
+#include "json.h"
+#include "metrics.h"
 #include "oven.h"
+#include "runs.h"
 #include "server.h"
+#include "wifi.h"
 
 /* private data */
 static const char* TAG = "server";
 
-#define SPIFFS_ROOT "/spiffs"
-#define SPIFFS_FILENAME_MAX_LEN 64
+// web UI blob written by tools/webui.py
+#define WEBUI_PARTITION "webui"
+#define WEBUI_MAGIC     (0x5752534F) // "OSRW"
+#define WEBUI_PATH_LEN  (64)
+#define WEBUI_ETAG_LEN  (20)
+#define WEBUI_MIME_LEN  (28)
+#define IMMUTABLE       "/static/" // build output with content hashes in the name
+
+typedef struct {
+    char     path[WEBUI_PATH_LEN];
+    char     etag[WEBUI_ETAG_LEN];
+    char     mime[WEBUI_MIME_LEN];
+    uint32_t offset; // from start of blob
+    uint32_t size;
+    uint32_t gz_offset;
+    uint32_t gz_size; // 0 if no gzip variant
+} webui_entry_t;
+
+typedef struct {
+    uint32_t      magic;
+    uint32_t      count;
+    webui_entry_t entries[]; // sorted by path
+} webui_index_t;
+
+#define HISTORY_CHUNK     (16) // samples per response chunk / stream frame
+#define SAMPLE_JSON_LEN   (80)
+#define TEMPS_JSON_LEN    (768) // status with every sensor, the run quality and predictions
+#define HISTORY_JSON_LEN  (HISTORY_CHUNK * SAMPLE_JSON_LEN + TEMPS_JSON_LEN)
+#define PROFILES_JSON_LEN (2048)
+#define PROFILE_UPLOAD_LEN (2048)
+#define MAX_CLIENTS       (13)
+#define MAX_ROUTES        (24)
+#define METRICS_CHUNK_LEN (1024)
+#define ROUTE_LABELS_LEN  (48)
+#define RUNS_CHUNK        (4)  // runs per list chunk
+#define RUN_JSON_LEN      (480)
+#define RUN_CSV_CHUNK     (32) // samples per download chunk
+#define RUN_CSV_LINE_LEN  (32)
+#define GAINS_JSON_LEN    (1024) // every schedule entry
+#define ZONES_JSON_LEN    (OVEN_MAX_ZONES * 160 + 64)
+#define QUEUE_JSON_LEN    (QUEUE_MAX_JOBS * 96 + 256)
+
+static const uint32_t ROUTE_BOUNDS[METRICS_BUCKETS - 1] = {1000, 5000, 10000, 50000, 100000, 500000, 1000000}; // us
+
+typedef struct {
+    const char    *uri;
+    httpd_method_t method;
+    esp_err_t    (*handler)(httpd_req_t *req);
+    metrics_hist_t latency;
+} server_route_t;
+
+/*
+ * All handlers and queued work run in the single server task, so the cached
+ * response bodies below need no locking.
+ */
+static struct {
+    const webui_index_t *webui;
+
+    httpd_handle_t server;
+    TaskHandle_t   stream_task;
+    uint32_t       stream_seq[OVEN_MAX_ZONES];
+    char           stream_buf[HISTORY_JSON_LEN];
+    struct {
+        int fd;
+        int zone;
+    } stream_subs[MAX_CLIENTS]; // which zone each websocket asked for
+
+    // per zone
+    oven_status_t temps_status[OVEN_MAX_ZONES]; // what temps_buf was built from
+    char          temps_buf[OVEN_MAX_ZONES][TEMPS_JSON_LEN];
+    size_t        temps_len[OVEN_MAX_ZONES];
+
+    char   profiles_buf[PROFILES_JSON_LEN];
+    size_t profiles_len;
+
+    profile_step_t upload_steps[PROFILE_MAX_STEPS];
+
+    server_route_t routes[MAX_ROUTES];
+    size_t         num_routes;
+} server_data;
+
+static const char *STEP_TYPES[] = {
+    [PROFILE_STEP_RAMP_TIME] = "ramp_time",
+    [PROFILE_STEP_RAMP_RATE] = "ramp_rate",
+    [PROFILE_STEP_HOLD]      = "hold",
+    [PROFILE_STEP_REACH]     = "reach",
+};
 
 /* private helpers */
-static inline bool is_file_ext(const char *filename, const char *ext) {
-    if (strlen(filename) < strlen(ext)) {
+static bool recv_body(httpd_req_t *req, char *buf, size_t size) {
+    // reads whole body and null terminates, sends an error response on failure
+    if (req->content_len >= size) { // includes null terminator!
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "too long");
+        return false;
+    }
+    int cur_len = 0, recv_len = 0;
+    while (cur_len < req->content_len) {
+        recv_len = httpd_req_recv(req, buf + cur_len, req->content_len - cur_len);
+        if (recv_len < 0) {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "fail?");
+            return false;
+        }
+        cur_len += recv_len;
+    }
+    buf[req->content_len] = '\0';
+    return true;
+}
+
+static bool query_uint(httpd_req_t *req, const char *key, uint32_t *val) {
+    char query[32], str[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, key, str, sizeof(str)) != ESP_OK) {
         return false;
     }
-    return strcasecmp(&filename[strlen(filename) - strlen(ext)], ext) == 0;
+    *val = strtoul(str, NULL, 10);
+    return true;
 }
 
-static esp_err_t http_get_handler(httpd_req_t *req) {
-    // get filename
-    char filename[sizeof(SPIFFS_ROOT) + SPIFFS_FILENAME_MAX_LEN] = SPIFFS_ROOT;
-    if (strcmp(req->uri, "/") == 0) {
-        strcat(filename, "/index.html"); // special case
-    } else {
-        strncat(filename, req->uri, SPIFFS_FILENAME_MAX_LEN);
+static bool query_zone(httpd_req_t *req, int *zone) {
+    // ?zone=<n>, the first zone without one, sends an error response for a zone that doesn't exist
+    uint32_t val = 0;
+    query_uint(req, "zone", &val);
+    if (val >= oven_zone_count()) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "no such zone");
+        return false;
+    }
+    *zone = val;
+    return true;
+}
+
+static void sample_json(json_t *json, const history_sample_t *sample) {
+    json_obj_begin(json, NULL);
+    json_uint(  json, "time",    sample->time);
+    json_number(json, "current", sample->current, 2);
+    json_number(json, "target",  sample->target,  2);
+    json_number(json, "duty",    sample->duty,    3);
+    json_obj_end(json);
+}
+
+static void quality_json(json_t *json, const analytics_result_t *quality) {
+    json_obj_begin(json, "quality");
+    json_string(json, "verdict",   analytics_verdict_name(quality->verdict));
+    json_arr_begin(json, "fails");
+    for (int i = 0; i < ANALYTICS_FAILS; i++) {
+        if (quality->fails & (1 << i)) {
+            json_string(json, NULL, analytics_fail_name(i));
+        }
+    }
+    json_arr_end(json);
+    json_number(json, "liquidus",  quality->liquidus,  1);
+    json_number(json, "peak",      quality->peak,      1);
+    json_number(json, "tal",       quality->tal,       1);
+    json_number(json, "ramp_up",   quality->ramp_up,   2);
+    json_number(json, "ramp_down", quality->ramp_down, 2);
+    json_number(json, "soak",      quality->soak,      1);
+    json_number(json, "dev_max",   quality->dev_max,   1);
+    json_number(json, "dev_rms",   quality->dev_rms,   2);
+    json_obj_end(json);
+}
+
+static void plant_json(json_t *json, const ident_model_t *plant) {
+    // null until the oven has been watched long enough
+    json_obj_begin(json, "plant");
+    json_bool(  json, "valid",   plant->valid);
+    json_number(json, "gain",    plant->valid ? plant->gain    : NAN, 1);
+    json_number(json, "tau",     plant->valid ? plant->tau     : NAN, 1);
+    json_number(json, "delay",   plant->valid ? plant->delay   : NAN, 2);
+    json_number(json, "ambient", plant->valid ? plant->ambient : NAN, 1);
+    json_obj_end(json);
+}
+
+static void status_json(json_t *json, const oven_status_t *status) {
+    json_number(json, "current", status->current, 2);
+    json_number(json, "target",  status->target,  2);
+    json_bool(  json, "running", status->running);
+    json_bool(  json, "tuning",  status->tuning);
+    json_number(json, "rate",    status->rate, 3);
+    json_bool(  json, "faulted", status->faulted);
+    json_arr_begin(json, "sensors");
+    for (size_t i = 0; i < status->num_sensors; i++) {
+        json_obj_begin(json, NULL);
+        json_number(json, "temp",  status->sensors[i].temp, 2);
+        json_string(json, "fault", sensor_fault_name(status->sensors[i].fault));
+        json_obj_end(json);
+    }
+    json_arr_end(json);
+    quality_json(json, &status->quality);
+    json_number(json, "eta",      status->eta,      0);
+    json_number(json, "cooldown", status->cooldown, 0);
+    plant_json(json, &status->plant);
+}
+
+static void webui_init(void) {
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+        ESP_PARTITION_SUBTYPE_ANY, WEBUI_PARTITION);
+    const void *ptr;
+    esp_partition_mmap_handle_t handle;
+    if (part == NULL || esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle) != ESP_OK) {
+        ESP_LOGE(TAG, "can't map web UI partition");
+        return;
     }
 
-    ESP_LOGI(TAG, "serving %s", filename);
+    const webui_index_t *webui = ptr;
+    if (webui->magic != WEBUI_MAGIC ||
+        webui->count > (part->size - sizeof(webui_index_t)) / sizeof(webui_entry_t)) {
+        ESP_LOGE(TAG, "web UI partition not flashed");
+        return;
+    }
+    server_data.webui = webui;
+    ESP_LOGI(TAG, "web UI has %d files", (int) webui->count);
+}
 
-    // open file
-    struct stat file_stat;
-    if (stat(filename, &file_stat) != 0) {
+static const webui_entry_t *webui_find(const char *path) {
+    if (server_data.webui == NULL) {
+        return NULL;
+    }
+    size_t low = 0, high = server_data.webui->count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        const webui_entry_t *entry = &server_data.webui->entries[mid];
+        int cmp = strncmp(path, entry->path, WEBUI_PATH_LEN);
+        if (cmp == 0) {
+            return entry;
+        } else if (cmp < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t http_get_handler(httpd_req_t *req) {
+    // get path, without any query
+    char path[WEBUI_PATH_LEN] = "/index.html"; // special case
+    if (strcmp(req->uri, "/") != 0) {
+        size_t len = strcspn(req->uri, "?");
+        if (len >= sizeof(path)) {
+            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "file doesn't exist");
+            return ESP_OK;
+        }
+        memcpy(path, req->uri, len);
+        path[len] = '\0';
+    }
+
+    const webui_entry_t *entry = webui_find(path);
+    if (entry == NULL) {
         httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "file doesn't exist");
         return ESP_OK;
     }
 
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "can't read file");
+    // use gzip variant if the client takes it
+    bool gz = false;
+    if (entry->gz_size > 0) {
+        char enc[64] = "";
+        httpd_req_get_hdr_value_str(req, "Accept-Encoding", enc, sizeof(enc));
+        gz = strstr(enc, "gzip") != NULL;
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+
+    // caching, hashed build output never changes
+    char etag[WEBUI_ETAG_LEN + 6];
+    snprintf(etag, sizeof(etag), "\"%.*s%s\"", WEBUI_ETAG_LEN, entry->etag, gz ? "-gz" : "");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", (strncmp(path, IMMUTABLE, strlen(IMMUTABLE)) == 0) ?
+        "public, max-age=31536000, immutable" : "no-cache");
+
+    char match[128] = "";
+    httpd_req_get_hdr_value_str(req, "If-None-Match", match, sizeof(match));
+    if (strstr(match, etag) != NULL || strcmp(match, "*") == 0) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        httpd_resp_send(req, NULL, 0);
         return ESP_OK;
     }
 
-    // set correct MIME type
-    const char *mime_map[][2] = {
-        { ".html", "text/html"              },
-        { ".js",   "application/javascript" },
-        { ".css",  "text/css"               },
-        { ".ico",  "image/x-icon"           },
-        { ".png",  "image/png"              },
-        { ".json", "application/json"       },
-    };
-    bool mime_flag = false;
-    for (int i = 0; i < sizeof(mime_map) / sizeof(mime_map[0]); i++) {
-        if (is_file_ext(filename, mime_map[i][0])) {
-            httpd_resp_set_type(req, mime_map[i][1]);
-            mime_flag = true;
-            break;
-        }
+    ESP_LOGI(TAG, "serving %s%s", path, gz ? " (gzip)" : "");
+
+    // send straight from mapped flash
+    const char *base = (const char*) server_data.webui;
+    httpd_resp_set_type(req, entry->mime);
+    if (gz) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        httpd_resp_send(req, base + entry->gz_offset, entry->gz_size);
+    } else {
+        httpd_resp_send(req, base + entry->offset, entry->size);
+    }
+    return ESP_OK;
+}
+
+static void temps_update(int zone) {
+    // rebuilt at most once per control tick (or start/stop), every request for the zone shares it
+    oven_status_t status;
+    oven_status(zone, &status);
+    oven_status_t *cached = &server_data.temps_status[zone];
+    if (server_data.temps_len[zone] > 0 && status.seq == cached->seq &&
+        status.running == cached->running && status.tuning == cached->tuning &&
+        status.target == cached->target) {
+        return;
     }
-    if (!mime_flag) {
-        httpd_resp_set_type(req, "text/plain"); // .txt, etc.
+
+    json_t json;
+    json_init(&json, server_data.temps_buf[zone], sizeof(server_data.temps_buf[zone]));
+    json_obj_begin(&json, NULL);
+    status_json(&json, &status);
+    json_obj_end(&json);
+    server_data.temps_status[zone] = status;
+    server_data.temps_len[zone]    = json.len;
+}
+
+static esp_err_t http_temps_handler(httpd_req_t *req) {
+    int zone;
+    if (!query_zone(req, &zone)) {
+        return ESP_OK;
     }
+    temps_update(zone);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, server_data.temps_buf[zone], server_data.temps_len[zone]);
+    return ESP_OK;
+}
 
-    // send file
-    static char chunk[32768]; // can't put on the stack
-    size_t chunk_size;
+static esp_err_t http_history_handler(httpd_req_t *req) {
+    // only send samples after ?since=<seq>
+    int zone;
+    uint32_t since = 0;
+    if (!query_zone(req, &zone)) {
+        return ESP_OK;
+    }
+    query_uint(req, "since", &since);
+
+    // stream samples in chunks, can be up to HISTORY_LEN of them
+    httpd_resp_set_type(req, "application/json");
+
+    history_sample_t samples[HISTORY_CHUNK];
+    char buf[HISTORY_JSON_LEN];
+    json_t json;
+    json_init(&json, buf, sizeof(buf));
+    json_obj_begin(&json, NULL);
+    json_arr_begin(&json, "samples");
+    size_t n;
     do {
-        chunk_size = fread(chunk, 1, sizeof(chunk), file);
-        httpd_resp_send_chunk(req, chunk, chunk_size);
-    } while (chunk_size > 0);
+        n = oven_history(zone, since, samples, HISTORY_CHUNK, &since);
+        for (size_t i = 0; i < n; i++) {
+            sample_json(&json, &samples[i]);
+        }
+        if (json.len > 0) { // zero length ends the response
+            httpd_resp_send_chunk(req, json.buf, json.len);
+        }
+        json_clear(&json);
+    } while (n == HISTORY_CHUNK);
+    json_arr_end(&json);
+
+    // latest status and where to continue from
+    oven_status_t status;
+    oven_status(zone, &status);
+    json_uint(&json, "seq", since);
+    status_json(&json, &status);
+    json_obj_end(&json);
+    httpd_resp_send_chunk(req, json.buf, json.len);
     httpd_resp_send_chunk(req, NULL, 0);
-    fclose(file);
 
     return ESP_OK;
 }
 
-static esp_err_t http_temps_handler(httpd_req_t *req) {
+static esp_err_t http_stream_handler(httpd_req_t *req) {
+    if (req->method == HTTP_GET) {
+        // handshake done, stream_send picks it up, a slot left by a closed socket is reused
+        uint32_t zone = 0;
+        query_uint(req, "zone", &zone);
+        if (zone >= oven_zone_count()) {
+            return ESP_FAIL; // already upgraded, too late for an error response, so close it
+        }
+        int fd = httpd_req_to_sockfd(req);
+        size_t slot = MAX_CLIENTS;
+        for (size_t i = 0; i < MAX_CLIENTS && slot == MAX_CLIENTS; i++) {
+            if (server_data.stream_subs[i].fd == fd) {
+                slot = i;
+            }
+        }
+        for (size_t i = 0; i < MAX_CLIENTS && slot == MAX_CLIENTS; i++) {
+            if (httpd_ws_get_fd_info(server_data.server, server_data.stream_subs[i].fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+                slot = i;
+            }
+        }
+        if (slot < MAX_CLIENTS) {
+            server_data.stream_subs[slot].fd   = fd;
+            server_data.stream_subs[slot].zone = zone;
+        }
+        return ESP_OK;
+    }
+
+    // nothing to do with client messages, just drain them
+    uint8_t buf[32];
+    httpd_ws_frame_t frame = {
+        .payload = buf,
+    };
+    return httpd_ws_recv_frame(req, &frame, sizeof(buf));
+}
+
+static int stream_zone(int fd) {
+    for (size_t i = 0; i < MAX_CLIENTS; i++) {
+        if (server_data.stream_subs[i].fd == fd) {
+            return server_data.stream_subs[i].zone;
+        }
+    }
+    return 0;
+}
+
+static void stream_zone_send(int zone, const int *fds, size_t num_fds) {
+    // one frame per tick is built for the zone and shared by all its clients
+    uint32_t *seq = &server_data.stream_seq[zone];
+    size_t subs = 0;
+    for (size_t i = 0; i < num_fds; i++) {
+        subs += stream_zone(fds[i]) == zone;
+    }
+    if (subs == 0) {
+        *seq = 0; // nobody watching, the next subscriber starts live
+        return;
+    }
+    if (*seq == 0) {
+        oven_status_t status;
+        oven_status(zone, &status);
+        *seq = (status.seq > 0) ? (status.seq - 1) : 0; // start live
+    }
+
+    history_sample_t samples[HISTORY_CHUNK];
+    size_t n = oven_history(zone, *seq, samples, HISTORY_CHUNK, seq);
+    if (n == 0) {
+        return;
+    }
+
     oven_status_t status;
-    oven_status(&status);
+    oven_status(zone, &status);
+    json_t json;
+    json_init(&json, server_data.stream_buf, sizeof(server_data.stream_buf));
+    json_obj_begin(&json, NULL);
+    json_arr_begin(&json, "samples");
+    for (size_t i = 0; i < n; i++) {
+        sample_json(&json, &samples[i]);
+    }
+    json_arr_end(&json);
+    json_uint(&json, "seq", *seq);
+    status_json(&json, &status);
+    json_obj_end(&json);
 
-    httpd_resp_set_type(req, "application/json");
-    cJSON *root = cJSON_CreateObject();
+    httpd_ws_frame_t frame = {
+        .final   = true,
+        .type    = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t*) json.buf,
+        .len     = json.len,
+    };
+    for (size_t i = 0; i < num_fds; i++) {
+        if (stream_zone(fds[i]) == zone) {
+            httpd_ws_send_frame_async(server_data.server, fds[i], &frame);
+        }
+    }
+}
 
-    cJSON_AddNumberToObject(root, "current", status.current);
-    cJSON_AddNumberToObject(root, "target",  status.target);
-    cJSON_AddBoolToObject(  root, "running", status.running);
+static void stream_send(void *arg) {
+    // runs in the server task, zones one after the other through the shared buffer
+    int fds[MAX_CLIENTS];
+    size_t num_fds = MAX_CLIENTS;
+    if (httpd_get_client_list(server_data.server, &num_fds, fds) != ESP_OK) {
+        return;
+    }
+    size_t num_ws = 0;
+    for (size_t i = 0; i < num_fds; i++) {
+        if (httpd_ws_get_fd_info(server_data.server, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            fds[num_ws++] = fds[i];
+        }
+    }
+    for (int zone = 0; zone < oven_zone_count(); zone++) {
+        stream_zone_send(zone, fds, num_ws);
+    }
+}
 
-    const char *root_str = cJSON_Print(root);
-    httpd_resp_sendstr(req, root_str);
-    free((void*) root_str);
-    cJSON_Delete(root);
+static void stream_thread(void *arg) {
+    // keeps network work off the oven task
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        httpd_queue_work(server_data.server, stream_send, NULL);
+    }
+    vTaskDelete(NULL);
+}
 
-    return ESP_OK;
+static void stream_notify(void *arg) {
+    xTaskNotifyGive(server_data.stream_task);
+}
+
+static void profiles_update(void) {
+    // only rebuilt when profiles are added or removed
+    json_t json;
+    json_init(&json, server_data.profiles_buf, sizeof(server_data.profiles_buf));
+    json_obj_begin(&json, NULL);
+    json_arr_begin(&json, "profiles");
+    for (profile_type_t i = 0; i < profile_count(); i++) {
+        json_obj_begin(&json, NULL);
+        json_string(&json, "name",    profile_name(i));
+        json_bool(  &json, "builtin", i < PROFILE_BUILTIN_COUNT);
+        json_obj_end(&json);
+    }
+    json_arr_end(&json);
+    json_obj_end(&json);
+    server_data.profiles_len = json.len;
+    if (!json_ok(&json)) {
+        ESP_LOGE(TAG, "profiles don't fit in response buffer");
+    }
 }
 
 static esp_err_t http_profiles_handler(httpd_req_t *req) {
     httpd_resp_set_type(req, "application/json");
-    cJSON *root  = cJSON_CreateObject();
-    cJSON *profs = cJSON_AddArrayToObject(root, "profiles");
+    httpd_resp_send(req, server_data.profiles_buf, server_data.profiles_len);
+    return ESP_OK;
+}
+
+static bool parse_step(const cJSON *step_json, profile_step_t *step) {
+    cJSON *type_json  = cJSON_GetObjectItem(step_json, "type");
+    cJSON *temp_json  = cJSON_GetObjectItem(step_json, "temp");
+    cJSON *value_json = cJSON_GetObjectItem(step_json, "value");
+    if (!cJSON_IsString(type_json) || !cJSON_IsNumber(value_json)) {
+        return false;
+    }
+    for (int i = 0; i < sizeof(STEP_TYPES) / sizeof(STEP_TYPES[0]); i++) {
+        if (strcmp(cJSON_GetStringValue(type_json), STEP_TYPES[i]) == 0) {
+            step->type  = i;
+            step->temp  = cJSON_IsNumber(temp_json) ? cJSON_GetNumberValue(temp_json) : 0.0; // hold has none
+            step->value = cJSON_GetNumberValue(value_json);
+            return step->type == PROFILE_STEP_HOLD || cJSON_IsNumber(temp_json);
+        }
+    }
+    return false;
+}
 
-    for (profile_type_t i = 0; i < PROFILE_TYPE_COUNT; i++) {
-        cJSON *prof = cJSON_CreateObject();
-        cJSON_AddStringToObject(prof, "name", profile_name(i));
-        cJSON_AddItemToArray(profs, prof);
+static bool parse_limits(const cJSON *limits_json, profile_limits_t *limits) {
+    // optional, anything left out doesn't limit
+    *limits = (profile_limits_t) {
+        .peak_max      = INFINITY,
+        .tal_max       = INFINITY,
+        .ramp_up_max   = INFINITY,
+        .ramp_down_max = INFINITY,
+        .soak_max      = INFINITY,
+    };
+    if (limits_json == NULL) {
+        return true;
     }
+    struct {
+        const char *key;
+        real_t     *val;
+    } fields[] = {
+        { "liquidus",      &limits->liquidus },
+        { "peak_min",      &limits->peak_min },
+        { "peak_max",      &limits->peak_max },
+        { "tal_min",       &limits->tal_min },
+        { "tal_max",       &limits->tal_max },
+        { "ramp_up_max",   &limits->ramp_up_max },
+        { "ramp_down_max", &limits->ramp_down_max },
+        { "soak_low",      &limits->soak_low },
+        { "soak_high",     &limits->soak_high },
+        { "soak_min",      &limits->soak_min },
+        { "soak_max",      &limits->soak_max },
+        { "dev_max",       &limits->dev_max },
+    };
+    for (int i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        cJSON *val_json = cJSON_GetObjectItem(limits_json, fields[i].key);
+        if (cJSON_IsNumber(val_json)) {
+            *fields[i].val = cJSON_GetNumberValue(val_json);
+        } else if (val_json != NULL) {
+            return false;
+        }
+    }
+    return cJSON_IsObject(limits_json) && limits->liquidus > 0.0;
+}
 
-    const char *root_str = cJSON_Print(root);
-    httpd_resp_sendstr(req, root_str);
-    free((void*) root_str);
+static esp_err_t http_profile_add_handler(httpd_req_t *req) {
+    /* read request into buffer */
+    char *buf = malloc(PROFILE_UPLOAD_LEN); // rare, keep it off the stack
+    if (buf == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "no memory");
+        return ESP_OK;
+    }
+    if (!recv_body(req, buf, PROFILE_UPLOAD_LEN)) {
+        free(buf);
+        return ESP_OK;
+    }
+
+    /* parse JSON values */
+    cJSON *root       = cJSON_Parse(buf);
+    cJSON *name_json  = cJSON_GetObjectItem(root, "name");
+    cJSON *steps_json = cJSON_GetObjectItem(root, "steps");
+    free(buf);
+    size_t num_steps = 0;
+    profile_limits_t limits;
+    bool ok = cJSON_IsString(name_json) && cJSON_IsArray(steps_json) &&
+        cJSON_GetArraySize(steps_json) <= PROFILE_MAX_STEPS &&
+        parse_limits(cJSON_GetObjectItem(root, "limits"), &limits);
+    if (ok) {
+        const cJSON *step_json;
+        cJSON_ArrayForEach(step_json, steps_json) {
+            ok = ok && parse_step(step_json, &server_data.upload_steps[num_steps++]);
+        }
+    }
+    char name[PROFILE_NAME_LEN] = "";
+    if (ok) {
+        strncpy(name, cJSON_GetStringValue(name_json), sizeof(name) - 1);
+    }
     cJSON_Delete(root);
+    if (!ok) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad json");
+        return ESP_OK;
+    }
+
+    /* process request */
+    bool saved;
+    int type = oven_profile_add(name, server_data.upload_steps, num_steps, &limits, &saved);
+    if (type < 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "invalid profile, no room or failed to save");
+        return ESP_OK;
+    }
+    profiles_update();
 
+    char resp[32];
+    json_t json;
+    json_init(&json, resp, sizeof(resp));
+    json_obj_begin(&json, NULL);
+    json_uint(&json, "idx", type);
+    json_bool(&json, "saved", saved); // false: usable until a reboot
+    json_obj_end(&json);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json.buf, json.len);
+    return ESP_OK;
+}
+
+static esp_err_t http_profile_remove_handler(httpd_req_t *req) {
+    uint32_t idx;
+    if (!query_uint(req, "idx", &idx)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing idx");
+        return ESP_OK;
+    }
+    if (!oven_profile_remove(idx)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "not a user profile or oven running");
+        return ESP_OK;
+    }
+    profiles_update();
+    httpd_resp_sendstr(req, "removed profile!");
     return ESP_OK;
 }
 
 static esp_err_t http_start_handler(httpd_req_t *req) {
     /* read request into buffer */
+    int zone;
     char buf[128];
-    if (req->content_len >= sizeof(buf)) { // includes null terminator!
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "too long");
+    if (!query_zone(req, &zone) || !recv_body(req, buf, sizeof(buf))) {
         return ESP_OK;
     }
-    int cur_len = 0, recv_len = 0;
-    while (cur_len < req->content_len) {
-        recv_len = httpd_req_recv(req, buf + cur_len, req->content_len);
-        if (recv_len < 0) {
-            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "fail?");
-            return ESP_OK;
-        }
-        cur_len += recv_len;
-    }
-    buf[req->content_len] = '\0';
 
     /* parse JSON values */
     cJSON *root      = cJSON_Parse(buf);
     cJSON *idx_json  = cJSON_GetObjectItem(root, "idx");
     cJSON *temp_json = cJSON_GetObjectItem(root, "temp");
-    if (!cJSON_IsNumber(idx_json) || !cJSON_IsNumber(temp_json)) {
+    if (!cJSON_IsNumber(idx_json) || !cJSON_IsNumber(temp_json) ||
+        cJSON_GetNumberValue(idx_json) < 0 || cJSON_GetNumberValue(idx_json) >= profile_count()) {
         cJSON_Delete(root);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad json");
         return ESP_OK;
@@ -149,72 +689,555 @@ static esp_err_t http_start_handler(httpd_req_t *req) {
     cJSON_Delete(root);
 
     /* process request */
-    oven_start(idx, temp);
+    if (!oven_start(zone, idx, temp)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "oven busy");
+        return ESP_OK;
+    }
     httpd_resp_sendstr(req, "starting oven!");
     return ESP_OK;
 }
 
 static esp_err_t http_stop_handler(httpd_req_t *req) {
-    oven_stop();
+    int zone;
+    if (!query_zone(req, &zone)) {
+        return ESP_OK;
+    }
+    if (!oven_stop(zone)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "oven busy");
+        return ESP_OK;
+    }
     httpd_resp_sendstr(req, "stopping oven!");
     return ESP_OK;
 }
 
+static esp_err_t http_autotune_handler(httpd_req_t *req) {
+    int zone;
+    if (!query_zone(req, &zone)) {
+        return ESP_OK;
+    }
+    autotune_t tune;
+    oven_autotune_status(zone, &tune);
+
+    char resp[160];
+    json_t json;
+    json_init(&json, resp, sizeof(resp));
+    json_obj_begin(&json, NULL);
+    json_string(&json, "state",    autotune_state_name(tune.state));
+    json_number(&json, "setpoint", tune.setpoint, 1);
+    json_number(&json, "time",     tune.time,     1);
+    if (tune.state == AUTOTUNE_DONE) {
+        json_number(&json, "ku", tune.ku, 5);
+        json_number(&json, "pu", tune.pu, 1);
+        json_number(&json, "kp", tune.kp, 5);
+        json_number(&json, "ki", tune.ki, 5);
+        json_number(&json, "kd", tune.kd, 5);
+    }
+    json_obj_end(&json);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json.buf, json.len);
+    return ESP_OK;
+}
+
+static esp_err_t http_zcd_handler(httpd_req_t *req) {
+    zcd_t zcd;
+    oven_zcd_status(&zcd);
+
+    char resp[320];
+    json_t json;
+    json_init(&json, resp, sizeof(resp));
+    json_obj_begin(&json, NULL);
+    json_number(&json, "hz",       500000.0 / zcd.period, 2);
+    json_uint(&json,   "period",   zcd.period);
+    json_uint(&json,   "edges",    zcd.edges);
+    json_uint(&json,   "spurious", zcd.spurious);
+    json_uint(&json,   "missed",   zcd.missed);
+    json_arr_begin(&json, "jitter_us"); // bucket upper bounds, the last bucket is everything above
+    for (int i = 0; i < ZCD_JITTER_LEN - 1; i++) {
+        json_uint(&json, NULL, zcd_jitter_bound(i));
+    }
+    json_arr_end(&json);
+    json_arr_begin(&json, "jitter");
+    for (int i = 0; i < ZCD_JITTER_LEN; i++) {
+        json_uint(&json, NULL, zcd.jitter[i]);
+    }
+    json_arr_end(&json);
+    double mean = zcd.isr_count ? (double) zcd.isr_sum / zcd.isr_count : 0.0;
+    json_number(&json, "isr_mean_us", mean / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, 2);
+    json_number(&json, "isr_max_us",  (double) zcd.isr_max / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, 2);
+    json_obj_end(&json);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json.buf, json.len);
+    return ESP_OK;
+}
+
+static esp_err_t http_autotune_start_handler(httpd_req_t *req) {
+    int zone;
+    char buf[64];
+    if (!query_zone(req, &zone) || !recv_body(req, buf, sizeof(buf))) {
+        return ESP_OK;
+    }
+    cJSON *root      = cJSON_Parse(buf);
+    cJSON *temp_json = cJSON_GetObjectItem(root, "temp");
+    bool valid       = cJSON_IsNumber(temp_json) && cJSON_GetNumberValue(temp_json) > ROOM_TEMP;
+    double temp      = valid ? cJSON_GetNumberValue(temp_json) : 0.0;
+    cJSON_Delete(root);
+    if (!valid) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad json");
+        return ESP_OK;
+    }
+    if (!oven_autotune(zone, temp)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "oven running");
+        return ESP_OK;
+    }
+    httpd_resp_sendstr(req, "starting autotune!");
+    return ESP_OK;
+}
+
+static void gains_json(json_t *json, const char *key, const control_gains_t *gains) {
+    json_obj_begin(json, key);
+    json_number(json, "kp", gains->kp, 5);
+    json_number(json, "ki", gains->ki, 5);
+    json_number(json, "kd", gains->kd, 5);
+    json_obj_end(json);
+}
+
+static esp_err_t http_gains_handler(httpd_req_t *req) {
+    int zone;
+    if (!query_zone(req, &zone)) {
+        return ESP_OK;
+    }
+    oven_status_t status;
+    oven_status(zone, &status);
+    control_sched_t sched;
+    oven_sched_get(zone, &sched);
+    const control_gains_t in_use = {
+        .kp = status.kp,
+        .ki = status.ki,
+        .kd = status.kd,
+    };
+
+    char resp[GAINS_JSON_LEN];
+    json_t json;
+    json_init(&json, resp, sizeof(resp));
+    json_obj_begin(&json, NULL);
+    gains_json(&json, "pid", &status.gains);
+    json_arr_begin(&json, "sched");
+    for (size_t i = 0; i < sched.num; i++) {
+        json_obj_begin(&json, NULL);
+        json_string(&json, "phase", control_phase_name(sched.entries[i].phase));
+        json_number(&json, "temp",  sched.entries[i].temp, 1);
+        gains_json(&json, "gains", &sched.entries[i].gains);
+        json_obj_end(&json);
+    }
+    json_arr_end(&json);
+    json_string(&json, "phase", control_phase_name(status.phase));
+    gains_json(&json, "in_use", &in_use);
+    json_obj_end(&json);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json.buf, json.len);
+    return ESP_OK;
+}
+
+static bool parse_gains(const cJSON *gains_json, control_gains_t *gains) {
+    cJSON *kp_json = cJSON_GetObjectItem(gains_json, "kp");
+    cJSON *ki_json = cJSON_GetObjectItem(gains_json, "ki");
+    cJSON *kd_json = cJSON_GetObjectItem(gains_json, "kd");
+    if (!cJSON_IsNumber(kp_json) || !cJSON_IsNumber(ki_json) || !cJSON_IsNumber(kd_json)) {
+        return false;
+    }
+    gains->kp = cJSON_GetNumberValue(kp_json);
+    gains->ki = cJSON_GetNumberValue(ki_json);
+    gains->kd = cJSON_GetNumberValue(kd_json);
+    return true;
+}
+
+static bool parse_sched_entry(const cJSON *entry_json, control_sched_entry_t *entry) {
+    cJSON *phase_json = cJSON_GetObjectItem(entry_json, "phase");
+    cJSON *temp_json  = cJSON_GetObjectItem(entry_json, "temp");
+    if (!cJSON_IsString(phase_json) || !cJSON_IsNumber(temp_json) ||
+        !parse_gains(cJSON_GetObjectItem(entry_json, "gains"), &entry->gains)) {
+        return false;
+    }
+    entry->temp = cJSON_GetNumberValue(temp_json);
+    for (int i = CONTROL_PHASE_ANY; i <= CONTROL_PHASE_COOL; i++) {
+        if (strcmp(cJSON_GetStringValue(phase_json), control_phase_name(i)) == 0) {
+            entry->phase = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t http_gains_set_handler(httpd_req_t *req) {
+    // either or both of the gains set outright and the whole schedule, as GET returns them
+    int zone;
+    char buf[GAINS_JSON_LEN];
+    if (!query_zone(req, &zone) || !recv_body(req, buf, sizeof(buf))) {
+        return ESP_OK;
+    }
+    cJSON *root       = cJSON_Parse(buf);
+    cJSON *pid_json   = cJSON_GetObjectItem(root, "pid");
+    cJSON *sched_json = cJSON_GetObjectItem(root, "sched");
+    bool set_pid      = pid_json != NULL;
+    bool set_sched    = sched_json != NULL;
+    control_gains_t pid;
+    control_sched_t sched = { .num = 0 };
+    bool ok = cJSON_IsObject(root) && (set_pid || set_sched) && (!set_pid || parse_gains(pid_json, &pid)) &&
+        (!set_sched || (cJSON_IsArray(sched_json) && cJSON_GetArraySize(sched_json) <= CONTROL_SCHED_MAX));
+    if (ok && set_sched) {
+        const cJSON *entry_json;
+        cJSON_ArrayForEach(entry_json, sched_json) {
+            ok = ok && parse_sched_entry(entry_json, &sched.entries[sched.num++]);
+        }
+    }
+    cJSON_Delete(root);
+    if (!ok || (set_sched && !control_sched_sort(&sched))) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad json");
+        return ESP_OK;
+    }
+
+    /* process request */
+    if ((set_pid && !oven_pid_set(zone, pid.kp, pid.ki, pid.kd)) || (set_sched && !oven_sched_set(zone, &sched))) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "oven busy");
+        return ESP_OK;
+    }
+    httpd_resp_sendstr(req, "gains set!");
+    return ESP_OK;
+}
+
+static void run_json(json_t *json, const runlog_info_t *info) {
+    json_obj_begin(json, NULL);
+    json_uint(  json, "id",       info->run);
+    json_uint(  json, "zone",     info->header.zone);
+    json_uint(  json, "start",    info->header.start);
+    json_string(json, "profile",  info->header.profile);
+    json_string(json, "mode",     control_mode_name(info->header.mode));
+    json_number(json, "kp",       info->header.kp, 5);
+    json_number(json, "ki",       info->header.ki, 5);
+    json_number(json, "kd",       info->header.kd, 5);
+    json_uint(  json, "samples",  info->samples);
+    json_number(json, "duration", (double) info->samples * info->header.period / 1000.0, 1);
+    json_bool(  json, "finished", info->finished);
+    if (info->finished) {
+        quality_json(json, &info->quality);
+    }
+    json_obj_end(json);
+}
+
+static esp_err_t http_runs_handler(httpd_req_t *req) {
+    // oldest first, a few runs per chunk
+    static uint32_t runs[RUNLOG_MAX_BLOCKS]; // only ever used from the server task
+    size_t num_runs = runs_list(runs, RUNLOG_MAX_BLOCKS);
+
+    char buf[RUNS_CHUNK * RUN_JSON_LEN];
+    json_t json;
+    json_init(&json, buf, sizeof(buf));
+    httpd_resp_set_type(req, "application/json");
+    json_obj_begin(&json, NULL);
+    json_arr_begin(&json, "recording"); // per zone
+    for (int zone = 0; zone < oven_zone_count(); zone++) {
+        json_uint(&json, NULL, runs_recording(zone));
+    }
+    json_arr_end(&json);
+    json_arr_begin(&json, "runs");
+    for (size_t i = 0; i < num_runs; i++) {
+        runlog_info_t info;
+        if (runs_info(runs[i], &info)) { // else deleted or evicted meanwhile
+            run_json(&json, &info);
+        }
+        if (i % RUNS_CHUNK == RUNS_CHUNK - 1) {
+            httpd_resp_send_chunk(req, json.buf, json.len);
+            json_clear(&json);
+        }
+    }
+    json_arr_end(&json);
+    json_obj_end(&json);
+    httpd_resp_send_chunk(req, json.buf, json.len);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static esp_err_t http_run_handler(httpd_req_t *req) {
+    // CSV read from flash a chunk at a time, a run is far bigger than RAM allows
+    uint32_t id;
+    runlog_info_t info;
+    if (!query_uint(req, "id", &id) || !runs_info(id, &info)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such run");
+        return ESP_OK;
+    }
+    char disposition[48];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"run-%u.csv\"", (unsigned) id);
+    httpd_resp_set_type(req, "text/csv");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    httpd_resp_sendstr_chunk(req, "time,current,target,duty\n");
+
+    runlog_sample_t samples[RUN_CSV_CHUNK];
+    char buf[RUN_CSV_CHUNK * RUN_CSV_LINE_LEN];
+    uint32_t first = 0;
+    size_t n;
+    do {
+        n = runs_read(id, first, samples, RUN_CSV_CHUNK);
+        size_t len = 0;
+        for (size_t i = 0; i < n; i++) {
+            history_sample_t sample = runlog_unpack(&samples[i], (first + i) * info.header.period);
+            len += snprintf(&buf[len], sizeof(buf) - len, "%.2f,%.2f,%.2f,%.4f\n",
+                sample.time / 1000.0, sample.current, sample.target, sample.duty);
+        }
+        if (len > 0 && httpd_resp_send_chunk(req, buf, len) != ESP_OK) {
+            return ESP_FAIL; // client went away
+        }
+        first += n;
+    } while (n == RUN_CSV_CHUNK);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static esp_err_t http_run_delete_handler(httpd_req_t *req) {
+    uint32_t id;
+    if (!query_uint(req, "id", &id)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing id");
+        return ESP_OK;
+    }
+    if (!runs_delete(id)) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such run or still recording");
+        return ESP_OK;
+    }
+    httpd_resp_sendstr(req, "deleted run!");
+    return ESP_OK;
+}
+
+static esp_err_t http_zones_handler(httpd_req_t *req) {
+    // each zone at a glance, and what it costs the control task
+    char resp[ZONES_JSON_LEN];
+    json_t json;
+    json_init(&json, resp, sizeof(resp));
+    json_obj_begin(&json, NULL);
+    json_arr_begin(&json, "zones");
+    for (int zone = 0; zone < oven_zone_count(); zone++) {
+        oven_status_t status;
+        oven_status(zone, &status);
+        json_obj_begin(&json, NULL);
+        json_string(&json, "name",       oven_zone_name(zone));
+        json_number(&json, "current",    status.current, 2);
+        json_number(&json, "target",     status.target,  2);
+        json_bool(  &json, "running",    status.running);
+        json_bool(  &json, "tuning",     status.tuning);
+        json_bool(  &json, "faulted",    status.faulted);
+        json_uint(  &json, "cycles_max", status.cycles_max);
+        json_obj_end(&json);
+    }
+    json_arr_end(&json);
+    json_uint(&json, "tick_cycles", CONTROL_PERIOD_MS * 1000 * CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    json_obj_end(&json);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json.buf, json.len);
+    return ESP_OK;
+}
+
+static esp_err_t http_queue_handler(httpd_req_t *req) {
+    int zone;
+    if (!query_zone(req, &zone)) {
+        return ESP_OK;
+    }
+    queue_t queue;
+    oven_queue_status(zone, &queue);
+
+    char resp[QUEUE_JSON_LEN];
+    json_t json;
+    json_init(&json, resp, sizeof(resp));
+    json_obj_begin(&json, NULL);
+    json_string(&json, "state",      queue_state_name(queue.state));
+    json_number(&json, "start_temp", queue.start_temp, 1);
+    json_arr_begin(&json, "jobs");
+    for (size_t i = 0; i < queue.num; i++) {
+        const queue_job_t *job = &queue.jobs[i];
+        json_obj_begin(&json, NULL);
+        json_uint(  &json, "idx",     job->profile);
+        json_string(&json, "profile", profile_name(job->profile));
+        json_uint(  &json, "count",   job->count);
+        json_uint(  &json, "done",    job->done);
+        json_uint(  &json, "boards",  job->boards);
+        json_obj_end(&json);
+    }
+    json_arr_end(&json);
+    json_uint(  &json, "pending",    queue_pending(&queue));
+    json_uint(  &json, "runs",       queue.runs);
+    json_number(&json, "wait",       queue.wait,      1); // s until the next run starts
+    json_number(&json, "cycle",      queue.cycle,     1); // s start to start, measured
+    json_number(&json, "predicted",  queue.predicted, 1);
+    json_number(&json, "throughput", queue_throughput(&queue), 2); // boards/h
+    json_obj_end(&json);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_send(req, json.buf, json.len);
+    return ESP_OK;
+}
+
+static esp_err_t http_queue_add_handler(httpd_req_t *req) {
+    // a job, the start temperature, or both
+    int zone;
+    char buf[128];
+    if (!query_zone(req, &zone) || !recv_body(req, buf, sizeof(buf))) {
+        return ESP_OK;
+    }
+    cJSON *root        = cJSON_Parse(buf);
+    cJSON *idx_json    = cJSON_GetObjectItem(root, "idx");
+    cJSON *count_json  = cJSON_GetObjectItem(root, "count");
+    cJSON *boards_json = cJSON_GetObjectItem(root, "boards");
+    cJSON *temp_json   = cJSON_GetObjectItem(root, "start_temp");
+    bool add           = idx_json != NULL;
+    bool set_temp      = temp_json != NULL;
+    double count       = cJSON_IsNumber(count_json) ? cJSON_GetNumberValue(count_json) : 1.0;
+    double boards      = cJSON_IsNumber(boards_json) ? cJSON_GetNumberValue(boards_json) : 1.0;
+    bool ok = cJSON_IsObject(root) && (add || set_temp) && (!set_temp || cJSON_IsNumber(temp_json)) &&
+        (!add || (cJSON_IsNumber(idx_json) && cJSON_GetNumberValue(idx_json) >= 0 &&
+        count >= 1.0 && count <= UINT16_MAX && boards >= 1.0 && boards <= UINT16_MAX));
+    profile_type_t idx = ok && add ? cJSON_GetNumberValue(idx_json) : 0;
+    double temp        = ok && set_temp ? cJSON_GetNumberValue(temp_json) : 0.0;
+    cJSON_Delete(root);
+    if (!ok) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad json");
+        return ESP_OK;
+    }
+
+    /* process request */
+    if (set_temp && !oven_queue_temp(zone, temp)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "start temperature out of range");
+        return ESP_OK;
+    }
+    if (add && !oven_queue_add(zone, idx, count, boards)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "queue full or profile can't be queued");
+        return ESP_OK;
+    }
+    httpd_resp_sendstr(req, add ? "queued!" : "start temperature set!");
+    return ESP_OK;
+}
+
+static esp_err_t http_queue_clear_handler(httpd_req_t *req) {
+    int zone;
+    if (!query_zone(req, &zone)) {
+        return ESP_OK;
+    }
+    oven_queue_clear(zone);
+    httpd_resp_sendstr(req, "queue cleared!");
+    return ESP_OK;
+}
+
+static void metrics_flush(void *ctx, const char *buf, size_t len) {
+    httpd_resp_send_chunk((httpd_req_t*) ctx, buf, len);
+}
+
+static esp_err_t http_metrics_handler(httpd_req_t *req) {
+    // Prometheus text format, streamed a chunk at a time
+    char buf[METRICS_CHUNK_LEN];
+    metrics_t m;
+    metrics_init(&m, buf, sizeof(buf), metrics_flush, req);
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    oven_metrics(&m);
+
+    metrics_family(&m, "osro_http_request_seconds", "histogram", "HTTP handler time per route.");
+    for (size_t i = 0; i < server_data.num_routes; i++) {
+        server_route_t *route = &server_data.routes[i];
+        char labels[ROUTE_LABELS_LEN];
+        snprintf(labels, sizeof(labels), "method=\"%s\",uri=\"%s\"", http_method_str(route->method), route->uri);
+        metrics_hist(&m, "osro_http_request_seconds", labels, &route->latency);
+    }
+
+    uint32_t oven_stack, temp_stack;
+    oven_stack_free(&oven_stack, &temp_stack);
+    metrics_family(&m, "osro_task_stack_free_bytes", "gauge", "Least free stack seen per task.");
+    metrics_value(&m, "osro_task_stack_free_bytes", "task=\"oven\"",   oven_stack);
+    metrics_value(&m, "osro_task_stack_free_bytes", "task=\"temp\"",   temp_stack);
+    metrics_value(&m, "osro_task_stack_free_bytes", "task=\"httpd\"",  uxTaskGetStackHighWaterMark(NULL));
+    metrics_value(&m, "osro_task_stack_free_bytes", "task=\"stream\"", uxTaskGetStackHighWaterMark(server_data.stream_task));
+
+    metrics_family(&m, "osro_heap_free_bytes", "gauge", "Free heap.");
+    metrics_value(&m, "osro_heap_free_bytes", NULL, esp_get_free_heap_size());
+    metrics_family(&m, "osro_heap_min_free_bytes", "gauge", "Least free heap since boot.");
+    metrics_value(&m, "osro_heap_min_free_bytes", NULL, esp_get_minimum_free_heap_size());
+
+    int rssi;
+    if (wifi_rssi(&rssi)) {
+        metrics_family(&m, "osro_wifi_rssi_dbm", "gauge", "Signal strength of the access point.");
+        metrics_value(&m, "osro_wifi_rssi_dbm", NULL, rssi);
+    }
+    metrics_family(&m, "osro_wifi_reconnects_total", "counter", "Station disconnects.");
+    metrics_value(&m, "osro_wifi_reconnects_total", NULL, wifi_reconnects());
+
+    metrics_end(&m);
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+static esp_err_t http_timed_handler(httpd_req_t *req) {
+    server_route_t *route = (server_route_t*) req->user_ctx;
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = route->handler(req);
+    metrics_observe(&route->latency, esp_timer_get_time() - start);
+    return err;
+}
+
+static void route_add(const char *uri, httpd_method_t method, esp_err_t (*handler)(httpd_req_t *req), bool websocket) {
+    // every handler goes through http_timed_handler for /metrics
+    if (server_data.num_routes >= MAX_ROUTES) {
+        ESP_LOGE(TAG, "too many routes, %s not registered", uri);
+        return;
+    }
+    server_route_t *route = &server_data.routes[server_data.num_routes++];
+    route->uri     = uri;
+    route->method  = method;
+    route->handler = handler;
+    metrics_hist_init(&route->latency, ROUTE_BOUNDS);
+
+    const httpd_uri_t config = {
+        .uri          = uri,
+        .method       = method,
+        .handler      = http_timed_handler,
+        .user_ctx     = route,
+        .is_websocket = websocket,
+    };
+    httpd_register_uri_handler(server_data.server, &config);
+}
+
 /* public functions */
 void server_init(void) {
-    // init SPIFFS
-    esp_vfs_spiffs_conf_t cfg = {
-        .base_path              = SPIFFS_ROOT,
-        .partition_label        = NULL,
-        .max_files              = 32,
-        .format_if_mount_failed = true,
-    };
-    esp_vfs_spiffs_register(&cfg);
+    webui_init();
+    profiles_update();
 
     // init http server
     httpd_handle_t server = NULL;
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.uri_match_fn = httpd_uri_match_wildcard;
     config.lru_purge_enable = true;
+    config.max_open_sockets = MAX_CLIENTS;
+    config.max_uri_handlers = MAX_ROUTES;
+    config.stack_size = 6144; // history handler builds a full chunk on the stack
     httpd_start(&server, &config);
+    server_data.server = server;
 
-    static const httpd_uri_t temps = {
-        .uri       = "/temps",
-        .method    = HTTP_GET,
-        .handler   = http_temps_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &temps);
-
-    static const httpd_uri_t profiles = {
-        .uri       = "/profiles",
-        .method    = HTTP_GET,
-        .handler   = http_profiles_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &profiles);
-
-    static const httpd_uri_t start = {
-        .uri       = "/start",
-        .method    = HTTP_POST,
-        .handler   = http_start_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &start);
+    route_add("/temps",    HTTP_GET,    http_temps_handler,          false);
+    route_add("/history",  HTTP_GET,    http_history_handler,        false);
+    route_add("/stream",   HTTP_GET,    http_stream_handler,         true);
+    route_add("/profiles", HTTP_GET,    http_profiles_handler,       false);
+    route_add("/profiles", HTTP_POST,   http_profile_add_handler,    false);
+    route_add("/profiles", HTTP_DELETE, http_profile_remove_handler, false);
+    route_add("/start",    HTTP_POST,   http_start_handler,          false);
+    route_add("/stop",     HTTP_POST,   http_stop_handler,           false);
+    route_add("/autotune", HTTP_GET,    http_autotune_handler,       false);
+    route_add("/autotune", HTTP_POST,   http_autotune_start_handler, false);
+    route_add("/gains",    HTTP_GET,    http_gains_handler,          false);
+    route_add("/gains",    HTTP_POST,   http_gains_set_handler,      false);
+    route_add("/zones",    HTTP_GET,    http_zones_handler,          false);
+    route_add("/queue",    HTTP_GET,    http_queue_handler,          false);
+    route_add("/queue",    HTTP_POST,   http_queue_add_handler,      false);
+    route_add("/queue",    HTTP_DELETE, http_queue_clear_handler,    false);
+    route_add("/zcd",      HTTP_GET,    http_zcd_handler,            false);
+    route_add("/metrics",  HTTP_GET,    http_metrics_handler,        false);
+    route_add("/runs",     HTTP_GET,    http_runs_handler,           false);
+    route_add("/runs",     HTTP_DELETE, http_run_delete_handler,     false);
+    route_add("/run",      HTTP_GET,    http_run_handler,            false);
+    route_add("/*",        HTTP_GET,    http_get_handler,            false); // last, matches everything
 
-    static const httpd_uri_t stop = {
-        .uri       = "/stop",
-        .method    = HTTP_POST,
-        .handler   = http_stop_handler,
-        .user_ctx  = NULL
-    };
-    httpd_register_uri_handler(server, &stop);
-
-    static const httpd_uri_t get = {
-        .uri      = "/*",
-        .method   = HTTP_GET,
-        .handler  = http_get_handler,
-        .user_ctx = NULL,
-    };
-    httpd_register_uri_handler(server, &get);
+    // push every new sample to /stream clients
+    xTaskCreate(stream_thread, "stream", 2048, NULL, tskIDLE_PRIORITY + 5, &server_data.stream_task);
+    oven_listen(stream_notify, NULL);
 }
@@ -0,0 +1,42 @@
+#include <nvs.h>
+#include "settings.h"
+
+/* private data */
+#define NAMESPACE "osro"
+
+/* public functions */
+esp_err_t settings_get(const char *key, void *buf, size_t *len) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, key, buf, len);
+        nvs_close(handle);
+    }
+    return err;
+}
+
+esp_err_t settings_set(const char *key, const void *buf, size_t len) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, key, buf, len);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    return err;
+}
+
+esp_err_t settings_erase(const char *key) {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_erase_key(handle, key);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    return err;
+}
@@ -0,0 +1,12 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stddef.h>
+#include <esp_err.h>
+
+// persistent blobs in NVS, get with buf NULL to query the stored length
+esp_err_t settings_get(const char *key, void *buf, size_t *len);
+esp_err_t settings_set(const char *key, const void *buf, size_t len);
+esp_err_t settings_erase(const char *key);
+
+#endif // SETTINGS_H
@@ -0,0 +1,45 @@
+#include "spsc.h"
+
+/* public functions */
+void spsc_init(spsc_t *q) {
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->dropped, 0);
+}
+
+bool spsc_reserve(spsc_t *q, unsigned len, unsigned *slot) {
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_acquire); // slot free once released
+    if (head - tail >= len) {
+        // consumer stalled, keep what it hasn't seen yet
+        atomic_store_explicit(&q->dropped,
+            atomic_load_explicit(&q->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+        return false;
+    }
+    *slot = head % len;
+    return true;
+}
+
+void spsc_commit(spsc_t *q) {
+    unsigned head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release); // publish after the copy
+}
+
+bool spsc_front(spsc_t *q, unsigned len, unsigned *slot) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&q->head, memory_order_acquire); // slot filled once committed
+    if (head == tail) {
+        return false;
+    }
+    *slot = tail % len;
+    return true;
+}
+
+void spsc_release(spsc_t *q) {
+    unsigned tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release); // slot free after the copy
+}
+
+uint32_t spsc_dropped(spsc_t *q) {
+    return atomic_load_explicit(&q->dropped, memory_order_relaxed);
+}
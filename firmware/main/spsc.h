@@ -0,0 +1,33 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Indices of a lock-free single-producer single-consumer queue, whose slots
+ * live in the caller's array of len (a power of two). Neither side ever
+ * blocks, and only plain 32-bit atomic loads and stores are used, fine
+ * without the A extension.
+ *
+ *     if (spsc_reserve(&q, LEN, &slot)) {   if (spsc_front(&q, &slot)) {
+ *         items[slot] = item;                   item = items[slot];
+ *         spsc_commit(&q);                      spsc_release(&q);
+ *     }                                     }
+ */
+
+typedef struct {
+    atomic_uint head;    // written by the producer only
+    atomic_uint tail;    // written by the consumer only
+    atomic_uint dropped; // reserves while full
+} spsc_t;
+
+void     spsc_init(spsc_t *q);
+bool     spsc_reserve(spsc_t *q, unsigned len, unsigned *slot); // producer, false if full
+void     spsc_commit(spsc_t *q);
+bool     spsc_front(spsc_t *q, unsigned len, unsigned *slot);   // consumer, false if empty
+void     spsc_release(spsc_t *q);
+uint32_t spsc_dropped(spsc_t *q);
+
+#endif // SPSC_H
@@ -0,0 +1,89 @@
+#include <string.h>
+#include "trace.h"
+
+/* private helpers */
+static uint16_t crc16(const uint8_t *data, size_t len) {
+    // CCITT, polynomial 0x1021, initial 0xFFFF
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+/* public functions */
+void trace_init(trace_ring_t *ring) {
+    spsc_init(&ring->spsc);
+}
+
+bool trace_push(trace_ring_t *ring, const trace_record_t *rec) {
+    unsigned slot;
+    if (!spsc_reserve(&ring->spsc, TRACE_LEN, &slot)) {
+        return false;
+    }
+    ring->records[slot] = *rec;
+    spsc_commit(&ring->spsc);
+    return true;
+}
+
+bool trace_pop(trace_ring_t *ring, trace_record_t *rec) {
+    unsigned slot;
+    if (!spsc_front(&ring->spsc, TRACE_LEN, &slot)) {
+        return false;
+    }
+    *rec = ring->records[slot];
+    spsc_release(&ring->spsc);
+    return true;
+}
+
+uint32_t trace_dropped(trace_ring_t *ring) {
+    return spsc_dropped(&ring->spsc);
+}
+
+// out must hold TRACE_FRAME_LEN bytes, returns how many were used
+size_t trace_frame(const trace_record_t *rec, uint8_t *out) {
+    const size_t len = sizeof(*rec);
+    out[0] = TRACE_SYNC0;
+    out[1] = TRACE_SYNC1;
+    out[2] = len;
+    memcpy(&out[3], rec, len); // both ends are little endian
+    uint16_t crc = crc16(&out[2], len + 1);
+    out[3 + len] = crc & 0xFF;
+    out[4 + len] = crc >> 8;
+    return len + 5;
+}
+
+void trace_parser_init(trace_parser_t *parser) {
+    parser->len = 0;
+    parser->bad = 0;
+}
+
+// feed one byte at a time, returns true with rec filled when a frame completes
+bool trace_parse(trace_parser_t *parser, uint8_t byte, trace_record_t *rec) {
+    if ((parser->len == 0 && byte != TRACE_SYNC0) || (parser->len == 1 && byte != TRACE_SYNC1)) {
+        parser->len = (byte == TRACE_SYNC0) ? 1 : 0; // still hunting
+        return false;
+    }
+    if (parser->len == 2 && byte != sizeof(*rec)) {
+        parser->bad++;
+        parser->len = (byte == TRACE_SYNC0) ? 1 : 0;
+        return false;
+    }
+    parser->buf[parser->len++] = byte;
+    if (parser->len < TRACE_FRAME_LEN) {
+        return false;
+    }
+
+    parser->len = 0;
+    const size_t len = sizeof(*rec);
+    uint16_t crc = parser->buf[3 + len] | (parser->buf[4 + len] << 8);
+    if (crc != crc16(&parser->buf[2], len + 1)) {
+        parser->bad++;
+        return false;
+    }
+    memcpy(rec, &parser->buf[3], len);
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sensor.h"
+#include "spsc.h"
+
+/*
+ * Per-tick control loop trace. The oven task pushes fixed-size records into a
+ * preallocated lock-free ring (dropping, never waiting, when it's full) and
+ * the console drains them as frames:
+ *
+ *     0xA5 0x5A <len> <record, little endian> <CRC-16/CCITT of len and record>
+ *
+ * The frames share the console with log text, so the parser hunts for the
+ * sync bytes and throws away anything that fails the length or CRC check.
+ */
+
+#define TRACE_LEN       (256) // records, power of two, ~1 min at 250ms
+#define TRACE_SYNC0     (0xA5)
+#define TRACE_SYNC1     (0x5A)
+#define TRACE_FRAME_LEN (sizeof(trace_record_t) + 5)
+
+#define TRACE_RUNNING  (1 << 0)
+#define TRACE_TUNING   (1 << 1)
+#define TRACE_FAULTED  (1 << 2)
+#define TRACE_INT_HELD (1 << 3) // integrator clamped or frozen by anti-windup
+
+typedef struct {
+    uint32_t seq;   // control tick, gaps mean dropped records
+    uint32_t time;  // ms since boot
+    float    temp;  // C, what the controller saw
+    float    target;
+    float    p, i, d; // PID terms, duty
+    float    ff;      // feedforward duty
+    float    duty;    // commanded
+    uint32_t pwm;     // applied duty, PWM_ONE = full
+    uint16_t raw[SENSOR_MAX]; // thermocouple frames
+    uint8_t  flags;
+    uint8_t  reserved[3];
+} trace_record_t;
+
+_Static_assert(sizeof(trace_record_t) == 52, "trace wire format changed");
+
+typedef struct {
+    trace_record_t records[TRACE_LEN];
+    spsc_t         spsc; // dropped counts pushes while full
+} trace_ring_t;
+
+typedef struct {
+    uint8_t  buf[TRACE_FRAME_LEN];
+    size_t   len;
+    uint32_t bad; // frames that failed the length or CRC check
+} trace_parser_t;
+
+void     trace_init(trace_ring_t *ring);
+bool     trace_push(trace_ring_t *ring, const trace_record_t *rec);
+bool     trace_pop(trace_ring_t *ring, trace_record_t *rec);
+uint32_t trace_dropped(trace_ring_t *ring);
+
+size_t trace_frame(const trace_record_t *rec, uint8_t *out);
+void   trace_parser_init(trace_parser_t *parser);
+bool   trace_parse(trace_parser_t *parser, uint8_t byte, trace_record_t *rec);
+
+#endif // TRACE_H
@@ -4,6 +4,7 @@
 #include <esp_console.h>
 #include <esp_log.h>
 #include <esp_mac.h>
+#include <esp_sntp.h>
 #include <esp_wifi.h>
 #include <esp_wpa2.h>
 #include "wifi.h"
@@ -19,6 +20,8 @@ static struct {
     struct arg_end *end;
 } connect_args;
 
+static uint32_t reconnects; // station disconnects, only the event task writes it
+
 /* private helpers */
 static void wifi_connect_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     switch (event_id) {
@@ -40,6 +43,7 @@ static void wifi_connect_handler(void *arg, esp_event_base_t event_base, int32_t
 
         case WIFI_EVENT_STA_DISCONNECTED:
             ESP_LOGI(TAG, "retry connect to the AP...");
+            reconnects++;
             esp_wifi_connect();
             break;
     }
@@ -173,6 +177,11 @@ void wifi_init(void) {
     mdns_hostname_set(CONFIG_WIFI_MDNS_HOSTNAME);
     mdns_instance_name_set(CONFIG_WIFI_MDNS_DEFAULT_INSTANCE);
 
+    // wall clock for run logs, retried in the background until a server answers
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, "pool.ntp.org");
+    sntp_init();
+
     // init command
     connect_args.type = arg_str1(NULL, NULL,   "<type>", "type (ap, open, wpa2, wpa3, wpa2_ent)");
     connect_args.ssid = arg_str1(NULL, NULL,   "<ssid>", "SSID");
@@ -188,3 +197,16 @@ void wifi_init(void) {
     };
     esp_console_cmd_register(&connect_cmd);
 }
+
+bool wifi_rssi(int *rssi) {
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return false;
+    }
+    *rssi = ap.rssi;
+    return true;
+}
+
+uint32_t wifi_reconnects(void) {
+    return reconnects;
+}
@@ -1,6 +1,11 @@
 #ifndef WIFI_H
 #define WIFI_H
 
-void wifi_init(void);
+#include <stdbool.h>
+#include <stdint.h>
+
+void     wifi_init(void);
+bool     wifi_rssi(int *rssi); // false if not connected
+uint32_t wifi_reconnects(void);
 
 #endif // WIFI_H
@@ -0,0 +1,61 @@
+#include <stdlib.h>
+#include <string.h>
+#include "zcd.h"
+
+/* private data */
+#define PERIOD_NOMINAL (1000000 / 120)      // us, 60Hz
+#define PERIOD_MIN     (1000000 / (2 * 70)) // us
+#define PERIOD_MAX     (1000000 / (2 * 45)) // us
+#define PERIOD_SHIFT   (3)                  // period filter, 1/8 per edge
+
+static const uint32_t JITTER_BOUNDS[ZCD_JITTER_LEN] = {
+    10, 20, 50, 100, 200, 500, 1000, UINT32_MAX, // us
+};
+
+/* private helpers */
+static void jitter_add(zcd_t *zcd, uint32_t jitter) {
+    int i = 0;
+    while (jitter >= JITTER_BOUNDS[i]) {
+        i++;
+    }
+    zcd->jitter[i]++;
+}
+
+/* public functions */
+void zcd_init(zcd_t *zcd) {
+    memset(zcd, 0, sizeof(*zcd));
+    zcd->edge   = -1;
+    zcd->period = PERIOD_NOMINAL;
+}
+
+// called on every zero cross edge with its timestamp
+zcd_edge_t zcd_edge(zcd_t *zcd, int64_t now) {
+    zcd_edge_t result = ZCD_EDGE_OK;
+    if (zcd->edge >= 0) {
+        int64_t dt = now - zcd->edge;
+        if (dt < zcd->period * 3 / 4) {
+            zcd->spurious++;
+            return ZCD_EDGE_SPURIOUS; // keep timing from the real one
+        }
+        if (dt <= zcd->period * 5 / 4) {
+            int32_t err = (int32_t) dt - (int32_t) zcd->period;
+            jitter_add(zcd, abs(err));
+            zcd->period += err / (1 << PERIOD_SHIFT);
+            zcd->period  = (zcd->period < PERIOD_MIN) ? PERIOD_MIN : (zcd->period > PERIOD_MAX) ? PERIOD_MAX : zcd->period;
+        } else {
+            // don't let a long gap drag the period, just count what's missing, an edge more
+            // for every period past the quarter that made this one MISSED
+            uint32_t gap = (uint32_t) ((dt - zcd->period / 4) / zcd->period);
+            zcd->missed += (gap > 0) ? gap : 1;
+            result = ZCD_EDGE_MISSED;
+        }
+    }
+    zcd->edge = now;
+    zcd->edges++;
+    return result;
+}
+
+// upper bound (exclusive, us) of a jitter histogram bucket
+uint32_t zcd_jitter_bound(int bucket) {
+    return JITTER_BOUNDS[bucket];
+}
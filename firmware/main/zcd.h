@@ -0,0 +1,46 @@
+#ifndef ZCD_H
+#define ZCD_H
+
+#include <stdint.h>
+
+/*
+ * Zero cross edge tracking and mains health. The zero cross ISR hands every
+ * edge to zcd_edge, which filters the half-cycle period, rejects edges that
+ * come too soon (bounces, noise) and notices ones that never came. The
+ * counters are plain increments so the ISR can afford them, the owner
+ * provides locking for readers.
+ */
+
+#define ZCD_JITTER_LEN (8) // histogram buckets, see zcd_jitter_bound
+
+typedef enum {
+    ZCD_EDGE_OK,       // about a half-cycle after the last
+    ZCD_EDGE_SPURIOUS, // too soon, ignored
+    ZCD_EDGE_MISSED,   // too late, edges went missing and timing resyncs here
+} zcd_edge_t;
+
+typedef struct {
+    int64_t  edge;     // us, last accepted, < 0 before the first
+    uint32_t period;   // us, filtered half-cycle
+    uint32_t edges;    // accepted
+    uint32_t spurious;
+    uint32_t missed;   // edges that should have been there
+    uint32_t jitter[ZCD_JITTER_LEN]; // |edge to edge - period|
+    uint32_t isr_count;
+    uint32_t isr_max;  // CPU cycles
+    uint64_t isr_sum;  // CPU cycles
+} zcd_t;
+
+void       zcd_init(zcd_t *zcd);
+zcd_edge_t zcd_edge(zcd_t *zcd, int64_t now);
+uint32_t   zcd_jitter_bound(int bucket);
+
+__attribute__((always_inline)) static inline void zcd_isr_time(zcd_t *zcd, uint32_t cycles) {
+    zcd->isr_count++;
+    zcd->isr_sum += cycles;
+    if (cycles > zcd->isr_max) {
+        zcd->isr_max = cycles;
+    }
+}
+
+#endif // ZCD_H
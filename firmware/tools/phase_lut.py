@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""
+Generates the phase-angle firing table, power to angle, as a const array so
+it lives in flash and the firmware computes nothing at boot. Entry i is the
+fraction of the half-cycle (0xFFFF = end) at which firing a resistive load
+delivers i / (entries - 1) of full power. The entry count comes from
+PHASE_LUT_BITS in phase.h.
+
+usage: phase_lut.py <phase.h> <output header>
+"""
+
+import math
+import re
+import sys
+from pathlib import Path
+
+def power(angle: float) -> float:
+    # as phase_power in phase.c, falls monotonically from 1 to 0 over the half-cycle
+    a = angle * math.pi
+    return 1.0 - a / math.pi + math.sin(2.0 * a) / (2.0 * math.pi)
+
+def angle_for(want: float) -> float:
+    low, high = 0.0, 1.0
+    for _ in range(32):
+        mid = (low + high) / 2.0
+        if power(mid) > want:
+            low = mid
+        else:
+            high = mid
+    return (low + high) / 2.0
+
+def main(header: Path, out: Path):
+    bits = re.search(r"#define\s+PHASE_LUT_BITS\s+\((\d+)\)", header.read_text())
+    if not bits:
+        raise SystemExit(f"no PHASE_LUT_BITS in {header}")
+    num = (1 << int(bits.group(1))) + 1
+    angles = [min(math.floor(angle_for(i / (num - 1)) * 65536.0 + 0.5), 65535) for i in range(num)] # C's round()
+
+    rows = [", ".join(f"0x{a:04X}" for a in angles[i:i + 8]) for i in range(0, num, 8)]
+    out.parent.mkdir(parents=True, exist_ok=True)
+    out.write_text(
+        "// generated by tools/phase_lut.py from phase.h, do not edit\n"
+        f"static const uint16_t PHASE_LUT[{num}] = {{\n" +
+        "".join(f"    {row},\n" for row in rows) +
+        "};\n")
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print(__doc__.strip(), file=sys.stderr)
+        sys.exit(1)
+    main(Path(sys.argv[1]), Path(sys.argv[2]))
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Packs the web UI build into a single blob for the webui partition, which the
+server maps straight out of flash. Layout (little endian):
+
+    header  magic u32, count u32
+    index   count entries sorted by path, see ENTRY
+    data    file contents, 4 byte aligned
+
+Compressible files also get a gzip variant, and every entry carries its MIME
+type and an ETag so the server has nothing to compute at request time.
+
+usage: webui.py <webui build dir> <output file> [max size]
+"""
+
+import gzip
+import hashlib
+import struct
+import sys
+from pathlib import Path
+
+MAGIC  = 0x5752534F # "OSRW"
+HEADER = struct.Struct("<II")
+ENTRY  = struct.Struct("<64s20s28sIIII") # path, etag, mime, offset, size, gz_offset, gz_size
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".js":   "application/javascript",
+    ".css":  "text/css",
+    ".ico":  "image/x-icon",
+    ".png":  "image/png",
+    ".json": "application/json",
+    ".svg":  "image/svg+xml",
+}
+COMPRESS_EXTS = {".html", ".js", ".css", ".json", ".ico", ".txt", ".svg", ".map"}
+
+def cstr(s: str, size: int) -> bytes:
+    b = s.encode()
+    if len(b) >= size:
+        raise ValueError(f"'{s}' too long, max {size - 1} bytes")
+    return b
+
+def main(src: Path, out: Path, max_size: int):
+    files = sorted((("/" + p.relative_to(src).as_posix()).encode(), p)
+        for p in src.rglob("*") if p.is_file())
+
+    data   = bytearray()
+    offset = HEADER.size + len(files) * ENTRY.size
+    def append(blob: bytes) -> int:
+        start = offset + len(data)
+        data.extend(blob)
+        data.extend(b"\0" * (-len(data) % 4))
+        return start
+
+    index = []
+    for path, f in files:
+        raw  = f.read_bytes()
+        ext  = f.suffix.lower()
+        mime = MIME_TYPES.get(ext, "text/plain")
+        etag = hashlib.sha256(raw).hexdigest()[:16]
+
+        gz_offset, gz_size = 0, 0
+        if ext in COMPRESS_EXTS:
+            comp = gzip.compress(raw, compresslevel=9, mtime=0)
+            if len(comp) < len(raw):
+                gz_offset, gz_size = append(comp), len(comp)
+        index.append(ENTRY.pack(cstr(path.decode(), 64), cstr(etag, 20), cstr(mime, 28),
+            append(raw), len(raw), gz_offset, gz_size))
+
+    blob = HEADER.pack(MAGIC, len(files)) + b"".join(index) + data
+    if max_size and len(blob) > max_size:
+        raise SystemExit(f"web UI is {len(blob)} bytes, partition is {max_size}")
+    out.parent.mkdir(parents=True, exist_ok=True)
+    out.write_bytes(blob)
+    print(f"packed {len(files)} files, {len(blob)} bytes")
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (3, 4):
+        print(__doc__.strip(), file=sys.stderr)
+        sys.exit(1)
+    main(Path(sys.argv[1]), Path(sys.argv[2]), int(sys.argv[3], 0) if len(sys.argv) == 4 else 0)
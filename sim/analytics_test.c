@@ -0,0 +1,113 @@
+#include <math.h>
+#include <stdio.h>
+#include "check.h"
+#include "analytics.h"
+
+/*
+ * Feeds the reflow analytics synthetic runs whose process window is known in
+ * closed form: a trapezoid through the soak window, above liquidus and back
+ * down. Checks each metric, that upward limits fail the run as soon as they
+ * break, that the rest are judged at the end and that an aborted run fails.
+ */
+
+/* private data */
+#define DT (0.25) // s, control period
+
+static const profile_limits_t limits = {
+    .liquidus = 217.0,
+    .peak_min = 235.0, .peak_max = 250.0,
+    .tal_min  = 30.0,  .tal_max  = 90.0,
+    .ramp_up_max = 3.0, .ramp_down_max = 6.0,
+    .soak_low = 150.0, .soak_high = 200.0,
+    .soak_min = 60.0,  .soak_max  = 120.0,
+    .dev_max  = 10.0,
+};
+
+/* private helpers */
+// 1C/s to 150, 0.5C/s to 200, 2C/s to peak, hold, 3C/s down to 100
+static double trapezoid(double t, double peak, double hold) {
+    const double t1 = 125.0, t2 = t1 + 100.0, t3 = t2 + (peak - 200.0) / 2.0, t4 = t3 + hold;
+    if (t < t1) {
+        return 25.0 + t;
+    } else if (t < t2) {
+        return 150.0 + 0.5 * (t - t1);
+    } else if (t < t3) {
+        return 200.0 + 2.0 * (t - t2);
+    } else if (t < t4) {
+        return peak;
+    }
+    return fmax(100.0, peak - 3.0 * (t - t4));
+}
+
+static analytics_t run(double peak, double hold, double offset, double end, double fail_at, double *failed) {
+    analytics_t an;
+    analytics_start(&an, &limits);
+    *failed = NAN;
+    for (double t = DT; t <= end + 1e-9; t += DT) {
+        double target = trapezoid(t, peak, hold);
+        analytics_step(&an, target + offset, target, DT);
+        if (isnan(*failed) && an.result.verdict == ANALYTICS_FAIL) {
+            *failed = t;
+        }
+    }
+    analytics_finish(&an, end >= fail_at);
+    return an;
+}
+
+static void good_test(void) {
+    // 245 peak held 10s: above 217 from 233.5s, back below at 266.83s
+    double failed;
+    analytics_t an = run(245.0, 10.0, 0.0, 300.0, 0.0, &failed);
+    const analytics_result_t *res = &an.result;
+    check("peak", res->peak, 245.0, 1e-9);
+    check("tal", res->tal, 266.833 - 233.5, DT);
+    check("soak", res->soak, 100.0, DT);
+    check("ramp up", res->ramp_up, 2.0, 0.05);
+    check("ramp down", res->ramp_down, 3.0, 0.05);
+    check("verdict", res->verdict, ANALYTICS_PASS, 0);
+    printf("good     peak %.1fC tal %.1fs soak %.1fs ramp +%.2f/-%.2fC/s: %s\n", res->peak, res->tal,
+        res->soak, res->ramp_up, res->ramp_down, analytics_verdict_name(res->verdict));
+}
+
+static void early_test(void) {
+    // a 255C peak fails while heating, well before the run ends
+    double failed;
+    analytics_t an = run(255.0, 10.0, 0.0, 300.0, 0.0, &failed);
+    check("peak high", an.result.fails, ANALYTICS_PEAK_HIGH, 0);
+    check("fails at 250C", failed, 225.0 + 25.0 + DT, DT);
+    printf("early    peak high failed at %.2fs\n", failed);
+
+    // lagging 15C behind breaks the tracking limit on the first tick
+    an = run(245.0, 10.0, -15.0, 300.0, 0.0, &failed);
+    check("deviation", !!(an.result.fails & ANALYTICS_DEVIATION), 1, 0);
+    check("deviation rms", an.result.dev_rms, 15.0, 1e-9);
+    check("fails on first tick", failed, DT, 1e-9);
+}
+
+static void end_test(void) {
+    // too short above liquidus is only known at the end
+    double failed;
+    analytics_t an = run(236.0, 0.0, 0.0, 300.0, 0.0, &failed);
+    check("tal short", an.result.fails, ANALYTICS_TAL_SHORT, 0);
+    check("judged at end", isnan(failed), 1, 0);
+
+    // stopped halfway through the soak
+    an = run(245.0, 10.0, 0.0, 150.0, 300.0, &failed);
+    check("aborted", an.result.fails, ANALYTICS_ABORTED | ANALYTICS_PEAK_LOW | ANALYTICS_TAL_SHORT |
+        ANALYTICS_SOAK_SHORT, 0);
+
+    // no limits, nothing judged
+    const profile_limits_t none = { .liquidus = 0.0 };
+    analytics_start(&an, &none);
+    analytics_step(&an, 400.0, 25.0, DT);
+    analytics_finish(&an, false);
+    check("no limits", an.result.verdict, ANALYTICS_NONE, 0);
+}
+
+/* public functions */
+int main(void) {
+    good_test();
+    early_test();
+    end_test();
+    return check_result();
+}
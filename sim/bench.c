@@ -0,0 +1,541 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "control.h"
+#include "history.h"
+#include "phase.h"
+#include "plant.h"
+#include "ring.h"
+#include "sensor.h"
+#include "zcd.h"
+
+/*
+ * Replays reflow profiles against the simulated oven and reports how well the
+ * control core tracks them. With --check, exits non-zero if any scenario is
+ * outside its regression limits. With --zones, runs that many ovens in
+ * lockstep the way the firmware's control task steps its zones, and reports
+ * what a tick costs per zone against the control period.
+ */
+
+/* private data */
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+#define MAX_STEPS    (4096)  // ~17 min of control ticks
+#define SETTLE_BAND  (5.0)   // C
+#define CPU_REPEAT   (200)
+#define MANUAL_TIME  (270.0) // s
+#define TUNE_STEPS   (8192)  // ~34 min, longer than the autotune timeout
+#define FAULT_TIME   (60.0)  // s, when --open disconnects a sensor
+#define OPEN_FRAME   (0x7FFC) // full scale with the open bit set
+#define PWM_EDGES    (10000000)
+#define ZONES_MAX    (64)
+#define ZONE_SPREAD  (0.03)  // plant gain and time constant differ this much from zone to zone
+
+typedef struct {
+    const char    *name;
+    profile_type_t type;
+    double         manual_temp;
+    double         max_rms;       // regression limits
+    double         max_overshoot;
+} scenario_t;
+
+typedef struct {
+    double rms;
+    double max_err;
+    double overshoot;
+    double settle;
+    double duration;
+    double chatter;
+    int    starts;    // most heaters turned on in one half-cycle
+    double ns_per_step;
+    analytics_result_t quality; // what the firmware would report for the run
+} result_t;
+
+static const scenario_t scenarios[] = {
+    { .name = "SAC305",       .type = PROFILE_TYPE_SAC305,   .max_rms = 8.0, .max_overshoot = 5.0 },
+    { .name = "Sn63/Pb37",    .type = PROFILE_TYPE_SN63PB37, .max_rms = 8.0, .max_overshoot = 5.0 },
+    { .name = "Manual 150C",  .type = PROFILE_TYPE_MANUAL,   .manual_temp = 150.0,
+      .max_rms = 45.0, .max_overshoot = 15.0 },
+};
+
+// simulated oven hardware, sampled by the acquisition task and driven by PWM
+typedef struct {
+    plant_t         plant;
+    control_pwm_t   pwm;
+    zcd_t           zcd;
+    ring_t          ring;
+    sensor_filter_t filter;
+    double          temp;        // what the controller sees
+    long            edge;        // zero crosses so far
+    int64_t         sample_time; // us, newest fused sample
+    int             starts;      // most heaters turned on in one half-cycle
+} rig_t;
+
+static const control_mode_t modes[] = {
+    CONTROL_MODE_PID,
+    CONTROL_MODE_FEEDFORWARD,
+};
+
+static struct {
+    double kp, ki, kd;
+    plant_params_t plant;
+    control_model_t model;
+    int  sensors;
+    int  open_sensor;
+    bool raw;
+    double sample_period; // s
+    control_fire_t fire;
+
+    double times[MAX_STEPS];
+    double temps[MAX_STEPS];   // what the controller saw
+    double actual[MAX_STEPS];  // true oven temp
+    double targets[MAX_STEPS];
+    double duties[MAX_STEPS];
+} bench_data;
+
+/* private helpers */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void controller_init(control_t *ctrl, control_mode_t mode) {
+    control_init(ctrl);
+    control_pid_set(ctrl, bench_data.kp, bench_data.ki, bench_data.kd);
+    control_mode_set(ctrl, mode);
+    control_model_set(ctrl, &bench_data.model);
+}
+
+static void rig_acquire(rig_t *rig) {
+    // the acquisition task: MAX6675 frames with a timestamp into the ring
+    double t = rig->edge / PLANT_EDGE_RATE;
+    ring_sample_t sample = {
+        .time = llround(t * 1e6),
+        .num  = bench_data.sensors,
+    };
+    for (int i = 0; i < bench_data.sensors; i++) {
+        sample.raw[i] = plant_frame(&rig->plant);
+        if (i == bench_data.open_sensor && t >= FAULT_TIME) {
+            sample.raw[i] = OPEN_FRAME;
+        }
+    }
+    ring_push(&rig->ring, &sample);
+}
+
+static void rig_init(rig_t *rig) {
+    plant_init(&rig->plant, &bench_data.plant);
+    control_pwm_init(&rig->pwm, 0, PWM_CHANNELS);
+    zcd_init(&rig->zcd);
+    ring_init(&rig->ring);
+    sensor_filter_init(&rig->filter);
+    rig->edge        = 0;
+    rig->sample_time = -1;
+    rig->starts      = 0;
+    rig_acquire(rig);
+}
+
+static bool rig_sense(rig_t *rig, double *temp) {
+    // the oven task: fuse every sample published since the last tick
+    ring_sample_t sample;
+    bool ok = true;
+    while (ring_pop(&rig->ring, &sample)) {
+        sensor_reading_t readings[SENSOR_MAX];
+        double sum = 0.0;
+        for (int i = 0; i < sample.num; i++) {
+            sensor_decode(sample.raw[i], &readings[i]);
+            sum += readings[i].temp;
+        }
+        double dt = (rig->sample_time >= 0) ? (sample.time - rig->sample_time) / 1e6 : bench_data.sample_period;
+        rig->sample_time = sample.time;
+        if (bench_data.raw) {
+            rig->temp = sum / sample.num; // plain average like before fusion
+        } else {
+            ok = sensor_fuse(&rig->filter, readings, sample.num, dt);
+        }
+    }
+    if (!bench_data.raw) {
+        rig->temp = sensor_estimate(&rig->filter, rig->edge / PLANT_EDGE_RATE - rig->sample_time / 1e6);
+    }
+    *temp = rig->temp;
+    return ok;
+}
+
+static void rig_run(rig_t *rig, double duty) {
+    // one control period of zero crosses, sampling on its own schedule
+    const long sample_edges = lround(bench_data.sample_period * PLANT_EDGE_RATE);
+    rig->pwm.duty = control_pwm_duty(duty);
+    for (int i = 0; i < PWM_PERIOD; i++) {
+        if (bench_data.fire == CONTROL_FIRE_PHASE) {
+            const double period = 1e6 / PLANT_EDGE_RATE;
+            zcd_edge(&rig->zcd, llround(rig->edge * period));
+            uint32_t delay = phase_delay(rig->pwm.duty, rig->zcd.period);
+            plant_edge(&rig->plant, (delay == PHASE_OFF) ? 0.0 : phase_power(delay / period));
+        } else {
+            uint32_t was_on  = rig->pwm.on;
+            bool     started = false; // a rig is an oven of its own
+            uint32_t on      = control_pwm_edge(&rig->pwm, &started);
+            rig->starts = fmax(rig->starts, __builtin_popcount(on & ~was_on));
+            plant_edge(&rig->plant, __builtin_popcount(on) / (double) PWM_CHANNELS);
+        }
+        if (++rig->edge % sample_edges == 0) {
+            rig_acquire(rig);
+        }
+    }
+}
+
+static size_t simulate(const scenario_t *sc, control_mode_t mode, result_t *res) {
+    static rig_t rig;
+    rig_init(&rig);
+
+    control_t ctrl;
+    controller_init(&ctrl, mode);
+    control_start(&ctrl, sc->type);
+    ctrl.cursor.manual_temp = sc->manual_temp;
+
+    size_t n = 0;
+    while (n < MAX_STEPS) {
+        double t = n * CONTROL_PERIOD;
+        if (sc->type == PROFILE_TYPE_MANUAL && t >= MANUAL_TIME) {
+            control_stop(&ctrl);
+        }
+
+        double temp;
+        if (!rig_sense(&rig, &temp)) {
+            break; // the oven task stops when every sensor has faulted
+        }
+        control_step(&ctrl, temp, t);
+        if (!ctrl.running) {
+            break;
+        }
+        bench_data.times[n]   = t;
+        bench_data.temps[n]   = temp;
+        bench_data.actual[n]  = rig.plant.temp;
+        bench_data.targets[n] = ctrl.target;
+        bench_data.duties[n]  = ctrl.duty;
+        n++;
+
+        rig_run(&rig, ctrl.duty);
+    }
+    res->starts  = rig.starts;
+    res->quality = ctrl.analytics.result;
+    return n;
+}
+
+static void analyze(size_t n, result_t *res) {
+    // heating phase ends at the target peak, cooling is passive
+    size_t peak = 0;
+    double max_temp = -INFINITY;
+    for (size_t i = 0; i < n; i++) {
+        if (bench_data.targets[i] > bench_data.targets[peak]) {
+            peak = i;
+        }
+        max_temp = fmax(max_temp, bench_data.actual[i]);
+    }
+    bool flat = peak == 0;
+    if (flat) {
+        peak = n - 1; // flat target
+    }
+
+    double sq = 0.0;
+    res->max_err = 0.0;
+    for (size_t i = 0; i <= peak; i++) {
+        double err = bench_data.targets[i] - bench_data.actual[i];
+        sq += err * err;
+        res->max_err = fmax(res->max_err, fabs(err));
+    }
+
+    // settling from the last setpoint step, or a profile's peak, until the oven is in the band around
+    // that setpoint and stays there; a profile's target leaves the peak at once, so there only above it counts
+    size_t from = flat ? 0 : peak;
+    for (size_t i = 1; flat && i < n; i++) {
+        from = (bench_data.targets[i] != bench_data.targets[i - 1]) ? i : from;
+    }
+    double setpoint = bench_data.targets[from];
+    res->settle = NAN;
+    for (size_t i = n; i-- > from;) {
+        double err = bench_data.actual[i] - setpoint;
+        if (err > SETTLE_BAND || (flat && err < -SETTLE_BAND)) {
+            break; // the last tick out of the band
+        }
+        if (err >= -SETTLE_BAND) {
+            res->settle = bench_data.times[i] - bench_data.times[from];
+        }
+    }
+    res->rms       = sqrt(sq / (peak + 1));
+    res->overshoot = fmax(0.0, max_temp - bench_data.targets[peak]);
+    res->duration  = n * CONTROL_PERIOD;
+
+    // mean duty change per tick, sensor noise through the D term shows up here
+    double chatter = 0.0;
+    for (size_t i = 1; i < n; i++) {
+        chatter += fabs(bench_data.duties[i] - bench_data.duties[i - 1]);
+    }
+    res->chatter = chatter / n;
+}
+
+static double cpu_cost(const scenario_t *sc, control_mode_t mode, size_t n) {
+    // replay the recorded temperatures through a fresh controller
+    volatile double sink = 0.0;
+    double start = now_ns();
+    for (int r = 0; r < CPU_REPEAT; r++) {
+        control_t ctrl;
+        controller_init(&ctrl, mode);
+        control_start(&ctrl, sc->type);
+        for (size_t i = 0; i < n; i++) {
+            control_step(&ctrl, bench_data.temps[i], bench_data.times[i]);
+            sink += ctrl.duty;
+        }
+    }
+    (void) sink;
+    return (now_ns() - start) / ((double) CPU_REPEAT * n);
+}
+
+static double pwm_cost(void) {
+    // the zero cross ISR's share, sweeping duty so branches aren't predictable
+    control_pwm_t pwm;
+    zcd_t zcd;
+    control_pwm_init(&pwm, 0, PWM_CHANNELS);
+    zcd_init(&zcd);
+    volatile uint32_t sink = 0;
+    double start = now_ns();
+    for (long i = 0; i < PWM_EDGES; i++) {
+        pwm.duty = (i * 40503u) % (PWM_ONE + 1);
+        if (bench_data.fire == CONTROL_FIRE_PHASE) {
+            zcd_edge(&zcd, i * 8333);
+            sink += phase_delay(pwm.duty, zcd.period);
+        } else {
+            bool started = false;
+            sink += control_pwm_edge(&pwm, &started);
+        }
+    }
+    (void) sink;
+    return (now_ns() - start) / PWM_EDGES;
+}
+
+static bool autotune(double setpoint) {
+    // relay experiment from room temperature, same loop as the oven task
+    static rig_t rig;
+    rig_init(&rig);
+
+    control_t ctrl;
+    control_init(&ctrl);
+    control_autotune(&ctrl, setpoint);
+
+    for (size_t n = 0; n < TUNE_STEPS && ctrl.running; n++) {
+        double temp;
+        if (!rig_sense(&rig, &temp)) {
+            break;
+        }
+        control_step(&ctrl, temp, n * CONTROL_PERIOD);
+        rig_run(&rig, ctrl.duty);
+    }
+
+    const autotune_t *at = &ctrl.tune;
+    printf("tune  %s @ %.1fC after %.1fs: ku %.5f pu %.1fs\n",
+        autotune_state_name(at->state), setpoint, at->time, at->ku, at->pu);
+    if (at->state != AUTOTUNE_DONE) {
+        return false;
+    }
+    bench_data.kp = at->kp;
+    bench_data.ki = at->ki;
+    bench_data.kd = at->kd;
+    return true;
+}
+
+static int zones(int num, bool check) {
+    // every zone's share of the oven task each tick: fusion, control, history, timed together
+    static rig_t rigs[ZONES_MAX];
+    static control_t ctrls[ZONES_MAX];
+    static history_t hists[ZONES_MAX];
+    const scenario_t *scs[ZONES_MAX];
+    double sq[ZONES_MAX] = {0}, peak[ZONES_MAX] = {0}, max_temp[ZONES_MAX] = {0};
+    size_t heating[ZONES_MAX] = {0};
+    const plant_params_t base = bench_data.plant;
+    for (int z = 0; z < num; z++) {
+        bench_data.plant = base;
+        bench_data.plant.gain *= 1.0 - ZONE_SPREAD * (z % 4);
+        bench_data.plant.tau  *= 1.0 + ZONE_SPREAD * (z % 4);
+        bench_data.model.gain = bench_data.plant.gain;
+        bench_data.model.tau  = bench_data.plant.tau;
+        rig_init(&rigs[z]);
+        controller_init(&ctrls[z], CONTROL_MODE_FEEDFORWARD);
+        history_init(&hists[z]);
+        scs[z] = &scenarios[z % 2]; // the two lead-free and leaded profiles, alternating
+        control_start(&ctrls[z], scs[z]->type);
+    }
+    bench_data.plant = base;
+
+    double busy = 0.0, worst = 0.0;
+    size_t n = 0;
+    for (int running = num; running > 0 && n < MAX_STEPS; n++) {
+        double t = n * CONTROL_PERIOD;
+        double start = now_ns();
+        for (int z = 0; z < num; z++) {
+            double temp;
+            if (ctrls[z].running && rig_sense(&rigs[z], &temp)) {
+                control_step(&ctrls[z], temp, t);
+            }
+            const history_sample_t sample = {
+                .time    = t * 1000,
+                .current = ctrls[z].current,
+                .target  = ctrls[z].target,
+                .duty    = ctrls[z].duty,
+            };
+            history_push(&hists[z], &sample);
+        }
+        double tick = now_ns() - start;
+        busy += tick;
+        worst = fmax(worst, tick);
+
+        running = 0;
+        for (int z = 0; z < num; z++) {
+            if (!ctrls[z].running) {
+                continue;
+            }
+            running++;
+            if (ctrls[z].target >= peak[z]) { // tracking up to the peak, cooling is passive
+                double err = ctrls[z].target - rigs[z].plant.temp;
+                sq[z]  += err * err;
+                peak[z] = ctrls[z].target;
+                heating[z]++;
+            }
+            max_temp[z] = fmax(max_temp[z], rigs[z].plant.temp);
+            rig_run(&rigs[z], ctrls[z].duty);
+        }
+    }
+
+    int fails = 0;
+    printf("%-5s %-12s %8s %9s\n", "zone", "scenario", "rms(C)", "over(C)");
+    for (int z = 0; z < num; z++) {
+        double rms  = sqrt(sq[z] / heating[z]);
+        double over = fmax(0.0, max_temp[z] - peak[z]);
+        bool ok = rms <= scs[z]->max_rms && over <= scs[z]->max_overshoot;
+        printf("%-5d %-12s %8.2f %9.2f%s\n", z, scs[z]->name, rms, over, (check && !ok) ? "  FAIL" : "");
+        fails += !ok;
+    }
+    double per_zone = busy / n / num;
+    size_t state = sizeof(control_t) + sizeof(sensor_filter_t) + sizeof(ring_t) + sizeof(history_t);
+    printf("\n%d zones, %zu ticks: %.0f ns/tick mean, %.0f worst, %.0f ns/zone\n", num, n, busy / n, worst, per_zone);
+    printf("%.0f zones fit in the %.0f ms period on this host, scale by its speed over the target's\n",
+        CONTROL_PERIOD * 1e9 / per_zone, CONTROL_PERIOD * 1000);
+    printf("%zu bytes of controller state per zone, %zu of it history\n", state, sizeof(history_t));
+    if (worst > CONTROL_PERIOD * 1e9) {
+        printf("FAIL ticks overran the control period\n");
+        fails++;
+    }
+    return (check && fails) ? 1 : 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [--check] [--pid <kp> <ki> <kd>] [--plant <gain> <tau> <delay>] "
+        "[--model <gain> <tau> <delay>] [--autotune <temp>] [--noise <C>] [--sensors <n>] [--open <idx>] "
+        "[--sample <ms>] [--raw] [--fire <burst|phase>] [--zones <n>]\n", prog);
+}
+
+/* public functions */
+int main(int argc, char **argv) {
+    bool check = false;
+    double tune_temp = NAN;
+    bool model = false;
+    int num_zones = 0;
+    bench_data.kp    = 0.3; // Kconfig defaults
+    bench_data.ki    = 0.01;
+    bench_data.kd    = 0.0;
+    bench_data.plant = PLANT_DEFAULT;
+    bench_data.sensors     = 1;
+    bench_data.open_sensor = -1;
+    bench_data.sample_period = CONTROL_PERIOD;
+    profile_init();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else if (strcmp(argv[i], "--pid") == 0 && i + 3 < argc) {
+            bench_data.kp = atof(argv[++i]);
+            bench_data.ki = atof(argv[++i]);
+            bench_data.kd = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--plant") == 0 && i + 3 < argc) {
+            bench_data.plant.gain  = atof(argv[++i]);
+            bench_data.plant.tau   = atof(argv[++i]);
+            bench_data.plant.delay = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--model") == 0 && i + 3 < argc) {
+            bench_data.model.gain  = atof(argv[++i]);
+            bench_data.model.tau   = atof(argv[++i]);
+            bench_data.model.delay = atof(argv[++i]);
+            model = true;
+        } else if (strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+            bench_data.plant.noise = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--sensors") == 0 && i + 1 < argc) {
+            bench_data.sensors = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--open") == 0 && i + 1 < argc) {
+            bench_data.open_sensor = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sample") == 0 && i + 1 < argc) {
+            bench_data.sample_period = atof(argv[++i]) / 1000.0;
+        } else if (strcmp(argv[i], "--raw") == 0) {
+            bench_data.raw = true;
+        } else if (strcmp(argv[i], "--fire") == 0 && i + 1 < argc) {
+            bench_data.fire = strcmp(argv[++i], control_fire_name(CONTROL_FIRE_PHASE)) == 0 ?
+                CONTROL_FIRE_PHASE : CONTROL_FIRE_BURST;
+        } else if (strcmp(argv[i], "--zones") == 0 && i + 1 < argc) {
+            num_zones = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--autotune") == 0 && i + 1 < argc) {
+            tune_temp = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (bench_data.sensors < 1 || bench_data.sensors > SENSOR_MAX ||
+        bench_data.sample_period * PLANT_EDGE_RATE < 1.0 || num_zones < 0 || num_zones > ZONES_MAX) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (!model) { // feedforward gets a perfect model unless told otherwise
+        bench_data.model.gain  = bench_data.plant.gain;
+        bench_data.model.tau   = bench_data.plant.tau;
+        bench_data.model.delay = bench_data.plant.delay;
+    }
+
+    if (!isnan(tune_temp) && !autotune(tune_temp)) {
+        return 1;
+    }
+    printf("pid   kp %.5f ki %.5f kd %.5f\n", bench_data.kp, bench_data.ki, bench_data.kd);
+    printf("plant gain %.1fC tau %.1fs delay %.1fs\n",
+        bench_data.plant.gain, bench_data.plant.tau, bench_data.plant.delay);
+    printf("model gain %.1fC tau %.1fs delay %.1fs\n",
+        bench_data.model.gain, bench_data.model.tau, bench_data.model.delay);
+    printf("pwm   %s firing, %d channels, %.1f ns/edge\n",
+        control_fire_name(bench_data.fire), PWM_CHANNELS, pwm_cost());
+    printf("sense %d sensors every %.0fms noise %.2fC%s%s\n\n", bench_data.sensors,
+        bench_data.sample_period * 1000, bench_data.plant.noise,
+        bench_data.open_sensor >= 0 ? ", one opens" : "", bench_data.raw ? ", averaged" : ", fused");
+    if (num_zones > 0) {
+        return zones(num_zones, check);
+    }
+    printf("%-12s %-4s %8s %8s %9s %8s %8s %8s %6s %9s %8s %7s %8s\n",
+        "scenario", "mode", "rms(C)", "max(C)", "over(C)", "settle", "time(s)", "chatter", "starts", "ns/step",
+        "peak(C)", "tal(s)", "quality");
+
+    int fails = 0;
+    for (size_t s = 0; s < COUNT_OF(scenarios); s++) {
+        for (size_t m = 0; m < COUNT_OF(modes); m++) {
+            const scenario_t *sc = &scenarios[s];
+            result_t res;
+            size_t n = simulate(sc, modes[m], &res);
+            analyze(n, &res);
+            res.ns_per_step = cpu_cost(sc, modes[m], n);
+
+            bool ok = res.rms <= sc->max_rms && res.overshoot <= sc->max_overshoot && res.starts <= 1 &&
+                isfinite(res.settle);
+            printf("%-12s %-4s %8.2f %8.2f %9.2f %8.1f %8.1f %8.4f %6d %9.1f %8.1f %7.1f %8s%s\n", sc->name,
+                control_mode_name(modes[m]), res.rms, res.max_err, res.overshoot, res.settle, res.duration,
+                res.chatter, res.starts, res.ns_per_step, res.quality.peak, res.quality.tal,
+                analytics_verdict_name(res.quality.verdict), (check && !ok) ? "  FAIL" : "");
+            fails += !ok;
+        }
+    }
+    return (check && fails) ? 1 : 0;
+}
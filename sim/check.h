@@ -0,0 +1,27 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <math.h>
+#include <stdio.h>
+
+/*
+ * Checks for the sim tests, one test program per include. A failed check
+ * prints the first few failures and counts; main returns check_result().
+ */
+
+#define CHECK_PRINT_MAX (10)
+
+static int check_errors;
+
+static inline void check(const char *what, double got, double want, double tol) {
+    if (!(fabs(got - want) <= tol) && check_errors++ < CHECK_PRINT_MAX) {
+        printf("FAIL %s: got %.6g want %.6g\n", what, got, want);
+    }
+}
+
+static inline int check_result(void) {
+    printf("%d errors\n", check_errors);
+    return (check_errors == 0) ? 0 : 1;
+}
+
+#endif // CHECK_H
@@ -0,0 +1,227 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "control.h"
+#include "plant.h"
+#include "sensor.h"
+
+/*
+ * Checks the float control core against the same sources built in double
+ * (CONTROL_DOUBLE). This file is built both ways: the double build runs each
+ * scenario closed loop against the simulated oven and, with --dump, prints
+ * every tick's thermocouple frames and its outputs. The float build replays
+ * those frames through its own sensor fusion and controller and checks
+ * fused temperature, target, duty and the run's quality stay within a small
+ * tolerance of the reference, tick by tick. Host time says nothing about the
+ * target, its cost per tick is osro_control_step_cycles in /metrics.
+ *
+ * usage: equiv_test <reference binary>   or   equiv_ref --dump
+ */
+
+/* private data */
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+#define MAX_TICKS  (8192)
+#define SENSORS    (3)
+#define NOISE      (0.5) // C, so fusion has outliers and disagreement to deal with
+#define LINE_LEN   (256)
+
+#define TEMP_TOL   (0.01)  // C
+#define DUTY_TOL   (1e-3)  // 64 PWM_ONE LSBs
+#define PEAK_TOL   (0.01)  // C
+#define TAL_TOL    (0.5)   // s, a liquidus crossing may move by a tick
+#define GAIN_TOL   (1e-3)  // relative
+
+typedef struct {
+    const char    *name;
+    profile_type_t type;
+    double         manual_temp;
+    control_mode_t mode;
+    double         tune; // autotune setpoint, 0 to run the profile
+} scenario_t;
+
+typedef struct {
+    uint16_t raw[SENSORS];
+    double   temp, target, duty;
+} tick_t;
+
+static const scenario_t scenarios[] = {
+    { .name = "SAC305 pid",    .type = PROFILE_TYPE_SAC305,   .mode = CONTROL_MODE_PID },
+    { .name = "SAC305 ff",     .type = PROFILE_TYPE_SAC305,   .mode = CONTROL_MODE_FEEDFORWARD },
+    { .name = "Sn63/Pb37 pid", .type = PROFILE_TYPE_SN63PB37, .mode = CONTROL_MODE_PID },
+    { .name = "Sn63/Pb37 ff",  .type = PROFILE_TYPE_SN63PB37, .mode = CONTROL_MODE_FEEDFORWARD },
+    { .name = "Manual 150C",   .type = PROFILE_TYPE_MANUAL,   .manual_temp = 150.0, .mode = CONTROL_MODE_PID },
+    { .name = "autotune 180C", .tune = 180.0 },
+};
+
+static struct {
+    tick_t ticks[MAX_TICKS];
+    int    errors;
+} equiv_data;
+
+/* private helpers */
+static void setup(const scenario_t *sc, control_t *ctrl, sensor_filter_t *filter) {
+    control_init(ctrl);
+    control_pid_set(ctrl, 0.3, 0.01, 0.0); // Kconfig defaults
+    control_mode_set(ctrl, sc->mode);
+    const control_model_t model = {
+        .gain  = PLANT_DEFAULT.gain,
+        .tau   = PLANT_DEFAULT.tau,
+        .delay = PLANT_DEFAULT.delay,
+    };
+    control_model_set(ctrl, &model);
+    sensor_filter_init(filter);
+    if (sc->tune > 0.0) {
+        control_autotune(ctrl, sc->tune);
+    } else {
+        control_start(ctrl, sc->type);
+        ctrl->cursor.manual_temp = sc->manual_temp;
+    }
+}
+
+// one oven task tick from a set of frames, false once the run is over
+static bool step(control_t *ctrl, sensor_filter_t *filter, const uint16_t *raw, size_t n) {
+    sensor_reading_t readings[SENSORS];
+    for (int i = 0; i < SENSORS; i++) {
+        sensor_decode(raw[i], &readings[i]);
+    }
+    if (!sensor_fuse(filter, readings, SENSORS, CONTROL_PERIOD)) {
+        return false;
+    }
+    control_step(ctrl, sensor_estimate(filter, 0.0f), n * CONTROL_PERIOD);
+    return ctrl->running;
+}
+
+// closed loop against the plant, fills equiv_data.ticks
+static size_t run(const scenario_t *sc, control_t *ctrl) {
+    static plant_t plant;
+    plant_params_t params = PLANT_DEFAULT;
+    params.noise = NOISE;
+    plant_init(&plant, &params);
+
+    sensor_filter_t filter;
+    setup(sc, ctrl, &filter);
+    size_t n = 0;
+    bool running = true;
+    while (running && n < MAX_TICKS) {
+        tick_t *tick = &equiv_data.ticks[n];
+        for (int i = 0; i < SENSORS; i++) {
+            tick->raw[i] = plant_frame(&plant);
+        }
+        running = step(ctrl, &filter, tick->raw, n++); // the last tick is kept, it may finish a tune
+        tick->temp   = filter.temp;
+        tick->target = ctrl->target;
+        tick->duty   = ctrl->duty;
+        plant_run(&plant, ctrl->duty);
+    }
+    return n;
+}
+
+static void dump(void) {
+    for (size_t s = 0; s < COUNT_OF(scenarios); s++) {
+        control_t ctrl;
+        size_t n = run(&scenarios[s], &ctrl);
+        printf("run %zu %zu\n", s, n);
+        for (size_t i = 0; i < n; i++) {
+            const tick_t *tick = &equiv_data.ticks[i];
+            printf("%u %u %u %a %a %a\n", tick->raw[0], tick->raw[1], tick->raw[2],
+                tick->temp, tick->target, tick->duty);
+        }
+        const analytics_result_t *q = &ctrl.analytics.result;
+        printf("end %a %a %a %a %a\n", (double) q->peak, (double) q->tal,
+            (double) ctrl.pid.kp, (double) ctrl.pid.ki, (double) ctrl.pid.kd);
+    }
+}
+
+static void check(const char *run, const char *what, double got, double want, double tol) {
+    if (!(fabs(got - want) <= tol) && equiv_data.errors++ < 10) {
+        printf("FAIL %s %s: got %.6f want %.6f\n", run, what, got, want);
+    }
+}
+
+static bool compare(const scenario_t *sc, FILE *ref) {
+    // the reference's frames through this build, open loop so differences can't compound
+    char line[LINE_LEN];
+    size_t s, n;
+    if (!fgets(line, sizeof(line), ref) || sscanf(line, "run %zu %zu", &s, &n) != 2 ||
+        s != (size_t) (sc - scenarios) || n > MAX_TICKS) {
+        return false;
+    }
+    control_t ctrl;
+    sensor_filter_t filter;
+    setup(sc, &ctrl, &filter);
+    double temp_err = 0.0, target_err = 0.0, duty_err = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        tick_t *want = &equiv_data.ticks[i];
+        unsigned raw[SENSORS];
+        if (!fgets(line, sizeof(line), ref) || sscanf(line, "%u %u %u %la %la %la", &raw[0], &raw[1], &raw[2],
+                &want->temp, &want->target, &want->duty) != 6) {
+            return false;
+        }
+        for (int j = 0; j < SENSORS; j++) {
+            want->raw[j] = raw[j];
+        }
+        if (!step(&ctrl, &filter, want->raw, i) && i + 1 < n) {
+            check(sc->name, "ended at tick", i, n, 0.0);
+            return true;
+        }
+        temp_err   = fmax(temp_err, fabs(filter.temp - want->temp));
+        target_err = fmax(target_err, fabs(ctrl.target - want->target));
+        duty_err   = fmax(duty_err, fabs(ctrl.duty - want->duty));
+    }
+    double peak, tal, kp, ki, kd;
+    if (!fgets(line, sizeof(line), ref) ||
+        sscanf(line, "end %la %la %la %la %la", &peak, &tal, &kp, &ki, &kd) != 5) {
+        return false;
+    }
+    const analytics_result_t *q = &ctrl.analytics.result;
+    printf("%-14s %5zu %10.5f %10.5f %9.6f %8.4f %7.2f\n", sc->name, n, temp_err, target_err,
+        duty_err, fabs(q->peak - peak), fabs(q->tal - tal));
+    check(sc->name, "temp", temp_err, 0.0, TEMP_TOL);
+    check(sc->name, "target", target_err, 0.0, TEMP_TOL);
+    check(sc->name, "duty", duty_err, 0.0, DUTY_TOL);
+    check(sc->name, "peak", q->peak, peak, PEAK_TOL);
+    check(sc->name, "tal", q->tal, tal, TAL_TOL);
+    check(sc->name, "kp", ctrl.pid.kp, kp, fabs(kp) * GAIN_TOL);
+    check(sc->name, "ki", ctrl.pid.ki, ki, fabs(ki) * GAIN_TOL);
+    check(sc->name, "kd", ctrl.pid.kd, kd, fabs(kd) * GAIN_TOL);
+    return true;
+}
+
+/* public functions */
+int main(int argc, char **argv) {
+    profile_init();
+    if (argc == 2 && strcmp(argv[1], "--dump") == 0) {
+        dump();
+        return 0;
+    }
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <reference binary> | --dump\n", argv[0]);
+        return 2;
+    }
+
+    char cmd[LINE_LEN];
+    snprintf(cmd, sizeof(cmd), "%s --dump", argv[1]);
+    FILE *ref = popen(cmd, "r");
+    if (ref == NULL) {
+        perror(cmd);
+        return 1;
+    }
+    printf("real_t is %zu bytes, reference is double, worst difference per run\n\n", sizeof(real_t));
+    printf("%-14s %5s %10s %10s %9s %8s %7s\n", "scenario", "ticks", "temp(C)", "target(C)",
+        "duty", "peak(C)", "tal(s)");
+    for (size_t s = 0; s < COUNT_OF(scenarios); s++) {
+        if (!compare(&scenarios[s], ref)) {
+            printf("FAIL bad reference output for %s\n", scenarios[s].name);
+            equiv_data.errors++;
+            break;
+        }
+    }
+    if (pclose(ref) != 0) {
+        printf("FAIL reference exited with an error\n");
+        equiv_data.errors++;
+    }
+    printf("%d errors\n", equiv_data.errors);
+    return (equiv_data.errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include <math.h>
+#include <stdio.h>
+#include "check.h"
+#include "control.h"
+#include "plant.h"
+
+/*
+ * Runs the controller against simulated ovens that differ from the default
+ * and checks what it learns of them during one run: gain, time constant,
+ * dead time and ambient, the run's predicted end (with a wait on temperature,
+ * where the profile clock alone can't tell) and the predicted cool-down to
+ * CONTROL_SAFE_TEMP against how long the simulated oven actually takes.
+ * Also checks the predicted end doesn't creep closer while the oven is stuck
+ * short of a wait's threshold.
+ */
+
+/* private data */
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+#define SENSORS    (3)
+#define MAX_TICKS  (20000)
+#define GAIN_TOL   (0.1)  // relative
+#define TAU_TOL    (0.1)  // relative
+#define DELAY_TOL  (1.0)  // s, candidates are a few ticks apart
+#define AMBIENT_TOL (5.0) // C
+#define ETA_TOL    (0.1)  // relative, of the time left
+#define COOL_TOL   (0.1)  // relative
+#define STUCK_TIME (60.0) // s, held short of the wait
+
+static const plant_params_t plants[] = {
+    { .gain = 400.0, .tau = 180.0, .delay = 6.0, .ambient = 25.0, .noise = 0.5 },
+    { .gain = 300.0, .tau = 120.0, .delay = 3.0, .ambient = 20.0, .noise = 0.5 },
+    { .gain = 600.0, .tau = 300.0, .delay = 8.0, .ambient = 30.0, .noise = 0.5 },
+};
+
+// ramp, then wait for the oven at full power, so the end depends on the oven
+static const profile_step_t wait_steps[] = {
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 150.0,     .value = 120.0 },
+    { .type = PROFILE_STEP_HOLD,                         .value = 30.0 },
+    { .type = PROFILE_STEP_REACH,     .temp = 230.0,     .value = 3.0 },
+    { .type = PROFILE_STEP_HOLD,                         .value = 20.0 },
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = ROOM_TEMP, .value = 60.0 },
+};
+
+/* private helpers */
+static void run(const plant_params_t *params, profile_type_t type) {
+    static plant_t plant;
+    plant_init(&plant, params);
+    sensor_filter_t filter;
+    sensor_filter_init(&filter);
+    control_t ctrl;
+    control_init(&ctrl);
+    control_pid_set(&ctrl, 0.3, 0.01, 0.0);
+    control_start(&ctrl, type);
+
+    // predictions as the wait starts and as the run ends, checked against what happens
+    double eta = NAN, eta_at = 0.0, cool = NAN, cool_at = 0.0;
+    size_t n = 0;
+    for (; n < MAX_TICKS; n++) {
+        double t = n * CONTROL_PERIOD;
+        bool was_running = ctrl.running;
+        control_step(&ctrl, plant_sense(&plant, &filter, SENSORS), t);
+        if (isnan(eta) && ctrl.running && ctrl.cursor.seg == 2) {
+            eta    = ctrl.eta;
+            eta_at = t;
+        }
+        if (was_running && !ctrl.running) {
+            cool    = ctrl.cooldown;
+            cool_at = t;
+            check("eta", eta, t - eta_at, (t - eta_at) * ETA_TOL);
+        }
+        if (!ctrl.running && filter.temp <= CONTROL_SAFE_TEMP) {
+            break;
+        }
+        plant_run(&plant, ctrl.duty);
+    }
+    double cooled = n * CONTROL_PERIOD - cool_at;
+
+    const ident_model_t *m = &ctrl.ident.model;
+    printf("plant %5.0fC %5.0fs %4.1fs %4.1fC  learned %5.0fC %5.0fs %4.1fs %4.1fC  eta %5.1fs of %5.1fs  "
+        "cool %5.1fs of %5.1fs\n", params->gain, params->tau, params->delay, params->ambient,
+        m->gain, m->tau, m->delay, m->ambient, eta, cool_at - eta_at, cool, cooled);
+    if (!m->valid) {
+        check("model valid", 0, 1, 0);
+    }
+    check("gain", m->gain, params->gain, params->gain * GAIN_TOL);
+    check("tau", m->tau, params->tau, params->tau * TAU_TOL);
+    check("delay", m->delay, params->delay, DELAY_TOL);
+    check("ambient", m->ambient, params->ambient, AMBIENT_TOL);
+    check("cooldown", cool, cooled, cooled * COOL_TOL);
+}
+
+static void stuck_test(profile_type_t type) {
+    // the oven held where the wait began, with the model as learned up to there, so only the clock moves
+    static plant_t plant;
+    plant_init(&plant, &plants[0]);
+    sensor_filter_t filter;
+    sensor_filter_init(&filter);
+    control_t ctrl;
+    control_init(&ctrl);
+    control_pid_set(&ctrl, 0.3, 0.01, 0.0);
+    control_start(&ctrl, type);
+
+    size_t n = 0;
+    for (; n < MAX_TICKS && ctrl.cursor.seg < 2; n++) {
+        control_step(&ctrl, plant_sense(&plant, &filter, SENSORS), n * CONTROL_PERIOD);
+        plant_run(&plant, ctrl.duty);
+    }
+    const ident_t learned = ctrl.ident;
+    const double held = ctrl.current;
+    double eta = NAN, lowest = INFINITY;
+    for (size_t end = n + STUCK_TIME / CONTROL_PERIOD; n < end; n++) {
+        ctrl.ident = learned;
+        control_step(&ctrl, held, n * CONTROL_PERIOD);
+        eta    = isnan(eta) ? ctrl.eta : eta;
+        lowest = fmin(lowest, ctrl.eta);
+    }
+    printf("stuck at %.1fC for %.0fs: eta %.1fs, lowest %.1fs\n", held, STUCK_TIME, eta, lowest);
+    check("stuck eta known", isfinite(eta), 1, 0);
+    check("still waiting", ctrl.cursor.seg, 2, 0);
+    check("stuck eta", lowest, eta, 1e-3 * eta);
+}
+
+static void time_to_test(void) {
+    const ident_model_t m = { .gain = 400.0, .tau = 180.0, .ambient = 25.0, .valid = true };
+    check("heat", ident_time_to(&m, 25.0, 225.0, 1.0), 180.0 * log(2.0), 1e-3);
+    check("cool", ident_time_to(&m, 225.0, 125.0, 0.0), 180.0 * log(2.0), 1e-3);
+    check("passed", ident_time_to(&m, 40.0, 50.0, 0.0), 0.0, 0.0);
+    check("never", isinf(ident_time_to(&m, 100.0, 20.0, 0.0)), 1, 0);
+    check("predict", ident_predict(&m, 225.0, 0.0, 180.0 * log(2.0)), 125.0, 1e-3);
+}
+
+/* public functions */
+int main(void) {
+    profile_init();
+    int wait = profile_add("wait", wait_steps, COUNT_OF(wait_steps), NULL);
+    time_to_test();
+    for (size_t i = 0; i < COUNT_OF(plants); i++) {
+        run(&plants[i], wait);
+    }
+    stuck_test(wait);
+    return check_result();
+}
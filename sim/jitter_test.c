@@ -0,0 +1,212 @@
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "command.h"
+#include "control.h"
+#include "history.h"
+#include "seqlock.h"
+
+/*
+ * Runs a control loop the way the oven task does (drain commands, step,
+ * publish history and a snapshot under seqlocks) on a real-time thread, first
+ * alone and then with "HTTP" threads hammering snapshots, history and
+ * commands. The loop's wake-up jitter must not change under load, and no
+ * reader may ever see a torn snapshot.
+ */
+
+/* private data */
+#define PERIOD_NS    (2000000) // faster than the firmware to get enough ticks
+#define NUM_TICKS    (1000)    // per run
+#define NUM_ROUNDS   (5)       // idle and loaded runs, interleaved, odd for the median
+#define NUM_READERS  (2)
+#define TOLERANCE_US (200.0)   // allowed growth of the median p99 under load
+#define SKIP         (77)      // ctest SKIP_RETURN_CODE
+
+typedef struct {
+    uint32_t  tick;
+    control_t ctrl;
+    uint32_t  tick_end; // == tick unless the copy is torn
+} snapshot_t;
+
+static struct {
+    control_t       ctrl;
+    queue_t         queue;
+    history_t       history;
+    seqlock_t       history_lock;
+    snapshot_t      snapshot;
+    seqlock_t       snapshot_lock;
+    command_queue_t commands;
+    pthread_mutex_t client_lock;
+    atomic_uint     reply_id;
+    atomic_bool     done;
+    atomic_long     reads, torn, sent, applied;
+    double          latency[NUM_TICKS]; // us
+} test;
+
+/* private helpers */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *control_thread(void *arg) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (int i = 0; i < NUM_TICKS; i++) {
+        next.tv_nsec += PERIOD_NS;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        test.latency[i] = (now_ns() - (next.tv_sec * 1000000000LL + next.tv_nsec)) / 1000.0;
+
+        command_t cmd;
+        while (command_pop(&test.commands, &cmd)) {
+            command_apply(&test.ctrl, &test.queue, &cmd);
+            atomic_fetch_add(&test.applied, 1);
+            atomic_store(&test.reply_id, cmd.id);
+        }
+        control_step(&test.ctrl, 25.0 + i * 0.1, i * CONTROL_PERIOD);
+
+        const history_sample_t sample = {
+            .time    = i,
+            .current = test.ctrl.current,
+            .target  = test.ctrl.target,
+            .duty    = test.ctrl.duty,
+        };
+        seqlock_write_begin(&test.history_lock);
+        history_push(&test.history, &sample);
+        seqlock_write_end(&test.history_lock);
+
+        seqlock_write_begin(&test.snapshot_lock);
+        test.snapshot.tick     = i;
+        test.snapshot.ctrl     = test.ctrl;
+        test.snapshot.tick_end = i;
+        seqlock_write_end(&test.snapshot_lock);
+    }
+    return NULL;
+}
+
+static void *reader_thread(void *arg) {
+    history_sample_t samples[HISTORY_LEN];
+    while (!atomic_load(&test.done)) {
+        snapshot_t snap;
+        unsigned seq;
+        do {
+            seq  = seqlock_read_begin(&test.snapshot_lock);
+            snap = test.snapshot;
+        } while (seqlock_read_retry(&test.snapshot_lock, seq));
+        atomic_fetch_add(&test.torn, snap.tick != snap.tick_end);
+
+        uint32_t hist_seq;
+        do {
+            seq = seqlock_read_begin(&test.history_lock);
+            history_read(&test.history, 0, samples, HISTORY_LEN, &hist_seq);
+        } while (seqlock_read_retry(&test.history_lock, seq));
+        atomic_fetch_add(&test.reads, 1);
+    }
+    return NULL;
+}
+
+static void *client_thread(void *arg) {
+    uint32_t id = 0;
+    while (!atomic_load(&test.done)) {
+        command_t cmd = {
+            .type   = COMMAND_PID,
+            .pid.kp = 0.1,
+            .pid.ki = 0.001,
+            .pid.kd = 0.0,
+        };
+        pthread_mutex_lock(&test.client_lock);
+        cmd.id = ++id;
+        if (command_push(&test.commands, &cmd)) {
+            atomic_fetch_add(&test.sent, 1);
+            while (atomic_load(&test.reply_id) != id && !atomic_load(&test.done)) {
+                sched_yield(); // the firmware blocks on a semaphore instead
+            }
+        }
+        pthread_mutex_unlock(&test.client_lock);
+    }
+    return NULL;
+}
+
+static int compare(const void *a, const void *b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// runs the loop once, returns the p99 wake-up latency in us, or < 0 if not allowed
+static double run(int num_load, double *max) {
+    control_init(&test.ctrl);
+    queue_init(&test.queue, CONTROL_SAFE_TEMP);
+    control_pid_set(&test.ctrl, 0.1, 0.001, 0.0);
+    control_start(&test.ctrl, PROFILE_TYPE_MANUAL);
+    history_init(&test.history);
+    seqlock_init(&test.history_lock);
+    seqlock_init(&test.snapshot_lock);
+    command_queue_init(&test.commands);
+    atomic_store(&test.done, false);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    struct sched_param param = { .sched_priority = 50 };
+    pthread_attr_setschedparam(&attr, &param);
+
+    pthread_t control, load[NUM_READERS + 1];
+    if (pthread_create(&control, &attr, control_thread, NULL) != 0) {
+        return -1.0;
+    }
+    for (int i = 0; i < num_load; i++) {
+        pthread_create(&load[i], NULL, (i < NUM_READERS) ? reader_thread : client_thread, NULL);
+    }
+    pthread_join(control, NULL);
+    atomic_store(&test.done, true);
+    for (int i = 0; i < num_load; i++) {
+        pthread_join(load[i], NULL);
+    }
+
+    qsort(test.latency, NUM_TICKS, sizeof(test.latency[0]), compare);
+    *max = test.latency[NUM_TICKS - 1];
+    return test.latency[NUM_TICKS * 99 / 100];
+}
+
+/* public functions */
+int main(void) {
+    pthread_mutex_init(&test.client_lock, NULL);
+
+    // Host noise (other processes, clock changes) spoils the odd run of either kind, and the
+    // median p99 ignores up to two of each. Contention from the load raises every loaded run.
+    double idle_p99[NUM_ROUNDS], load_p99[NUM_ROUNDS];
+    double idle_max = 0.0, load_max = 0.0;
+    printf("tick latency   p99 (us)  max (us)\n");
+    for (int i = 0; i < NUM_ROUNDS; i++) {
+        double max;
+        idle_p99[i] = run(0, &max);
+        if (idle_p99[i] < 0.0) {
+            printf("SCHED_FIFO not permitted, skipping\n");
+            return SKIP;
+        }
+        printf("idle         %9.1f %9.1f\n", idle_p99[i], max);
+        idle_max = fmax(idle_max, max);
+        load_p99[i] = run(NUM_READERS + 1, &max);
+        printf("loaded       %9.1f %9.1f\n", load_p99[i], max);
+        load_max = fmax(load_max, max);
+    }
+    qsort(idle_p99, NUM_ROUNDS, sizeof(idle_p99[0]), compare);
+    qsort(load_p99, NUM_ROUNDS, sizeof(load_p99[0]), compare);
+    double idle   = idle_p99[NUM_ROUNDS / 2];
+    double loaded = load_p99[NUM_ROUNDS / 2];
+    printf("median p99 idle %.1fus, loaded %.1fus, worst idle %.1fus, loaded %.1fus\n", idle, loaded, idle_max, load_max);
+    printf("%ld reads, %ld torn, %ld commands sent, %ld applied\n",
+        (long) test.reads, (long) test.torn, (long) test.sent, (long) test.applied);
+
+    bool ok = loaded <= idle + TOLERANCE_US && test.torn == 0 && test.reads > 0 && test.applied > 0;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include "metrics.h"
+
+/*
+ * Renders a histogram and a few values through a deliberately tiny buffer and
+ * compares the reassembled output with the expected exposition text.
+ */
+
+/* private data */
+#define CHUNK_LEN (64) // smaller than the whole output, larger than any line
+
+static const uint32_t BOUNDS[METRICS_BUCKETS - 1] = {100, 200, 500, 1000, 2000, 5000, 10000};
+
+static const char EXPECTED[] =
+    "# HELP t_seconds Test.\n"
+    "# TYPE t_seconds histogram\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"0.0001\"} 2\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"0.0002\"} 2\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"0.0005\"} 3\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"0.001\"} 3\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"0.002\"} 3\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"0.005\"} 3\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"0.01\"} 3\n"
+    "t_seconds_bucket{uri=\"/x\",le=\"+Inf\"} 4\n"
+    "t_seconds_sum{uri=\"/x\"} 20.00045\n"
+    "t_seconds_count{uri=\"/x\"} 4\n"
+    "# HELP n_total Test.\n"
+    "# TYPE n_total counter\n"
+    "n_total 4294967295\n"
+    "n_total{a=\"b\"} 0.5\n";
+
+static struct {
+    char   out[4096];
+    size_t len;
+    int    flushes;
+    int    torn; // chunks not ending on a line
+} test;
+
+/* private helpers */
+static void flush(void *ctx, const char *buf, size_t len) {
+    memcpy(&test.out[test.len], buf, len);
+    test.len += len;
+    test.flushes++;
+    test.torn += buf[len - 1] != '\n';
+}
+
+/* public functions */
+int main(void) {
+    metrics_hist_t hist;
+    metrics_hist_init(&hist, BOUNDS);
+    metrics_observe(&hist, 0);
+    metrics_observe(&hist, 100); // bounds are inclusive
+    metrics_observe(&hist, 350);
+    metrics_observe(&hist, 20000000);
+
+    char buf[CHUNK_LEN];
+    metrics_t m;
+    metrics_init(&m, buf, sizeof(buf), flush, NULL);
+    metrics_family(&m, "t_seconds", "histogram", "Test.");
+    metrics_hist(&m, "t_seconds", "uri=\"/x\"", &hist);
+    metrics_family(&m, "n_total", "counter", "Test.");
+    metrics_value(&m, "n_total", NULL, 4294967295.0);
+    metrics_value(&m, "n_total", "a=\"b\"", 0.5);
+    metrics_end(&m);
+    test.out[test.len] = '\0';
+
+    bool ok = strcmp(test.out, EXPECTED) == 0 && test.torn == 0;
+    if (!ok) {
+        printf("got:\n%s\nwant:\n%s\n", test.out, EXPECTED);
+    }
+    printf("%zu bytes in %d chunks, %d torn\n", test.len, test.flushes, test.torn);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+#include <math.h>
+#include <string.h>
+#include "plant.h"
+
+/* private data */
+#define LIMIT(x, low, high) ((x < low) ? (low) : ((x > high) ? (high) : (x)))
+
+#define SENSOR_LSB (0.25) // MAX6675 resolution, C
+
+const plant_params_t PLANT_DEFAULT = {
+    .gain    = 400.0,
+    .tau     = 180.0,
+    .delay   = 6.0,
+    .ambient = 25.0,
+    .noise   = 0.0,
+};
+
+/* private helpers */
+static double gaussian(uint32_t *rng) {
+    // xorshift32 into Box-Muller, deterministic so runs are repeatable
+    double u[2];
+    for (int i = 0; i < 2; i++) {
+        *rng ^= *rng << 13;
+        *rng ^= *rng >> 17;
+        *rng ^= *rng << 5;
+        u[i] = (*rng + 1.0) / 4294967297.0;
+    }
+    return sqrt(-2.0 * log(u[0])) * cos(2.0 * M_PI * u[1]);
+}
+
+static double reading(plant_t *plant) {
+    // one thermocouple, noisy and quantized
+    double temp = plant->temp;
+    if (plant->params.noise > 0.0) {
+        temp += plant->params.noise * gaussian(&plant->rng);
+    }
+    return floor(temp / SENSOR_LSB) * SENSOR_LSB;
+}
+
+/* public functions */
+void plant_init(plant_t *plant, const plant_params_t *params) {
+    memset(plant, 0, sizeof(*plant));
+    plant->params   = *params;
+    plant->temp     = params->ambient;
+    plant->rng      = 0x12345678;
+    plant->line_len = LIMIT((size_t) round(params->delay * PLANT_EDGE_RATE), 1, PLANT_DELAY_MAX);
+    control_pwm_init(&plant->pwm, 0, PWM_CHANNELS);
+}
+
+void plant_edge(plant_t *plant, double power) {
+    double u = plant->line[plant->line_idx];
+    plant->line[plant->line_idx] = power;
+    plant->line_idx = (plant->line_idx + 1) % plant->line_len;
+
+    double dt = 1.0 / PLANT_EDGE_RATE;
+    double ss   = plant->params.ambient + u * plant->params.gain;
+    double rise = plant->temp - plant->params.ambient;
+    double loss = (plant->params.loss > 0.0) ? plant->params.loss * rise * rise : 0.0;
+    plant->temp += (ss - plant->temp - loss) * dt / plant->params.tau;
+}
+
+void plant_run(plant_t *plant, real_t duty) {
+    // whole half-cycles per heater from control_pwm_edge, like the zero cross ISR
+    plant->pwm.duty = control_pwm_duty(duty);
+    for (int i = 0; i < PWM_PERIOD; i++) {
+        bool started = false;
+        uint32_t on = control_pwm_edge(&plant->pwm, &started);
+        plant_edge(plant, __builtin_popcount(on) / (double) PWM_CHANNELS);
+    }
+}
+
+// one MAX6675 read, temp in D14-D3
+uint16_t plant_frame(plant_t *plant) {
+    int code = LIMIT((int) (reading(plant) / SENSOR_LSB), 0, 0x0FFF);
+    return code << 3;
+}
+
+// what the control task sees: every thermocouple read once, decoded and fused
+double plant_sense(plant_t *plant, sensor_filter_t *filter, size_t sensors) {
+    sensor_reading_t readings[SENSOR_MAX];
+    for (size_t i = 0; i < sensors; i++) {
+        sensor_decode(plant_frame(plant), &readings[i]);
+    }
+    sensor_fuse(filter, readings, sensors, CONTROL_PERIOD);
+    return filter->temp;
+}
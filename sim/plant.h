@@ -0,0 +1,50 @@
+#ifndef PLANT_H
+#define PLANT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "control.h"
+#include "sensor.h"
+
+/*
+ * First-order-plus-dead-time oven model, stepped once per mains zero cross.
+ *     tau * dT/dt = gain * u(t - delay) - (T - ambient)
+ * optionally with losses growing faster than linear, like a real oven's
+ * radiation, so it's slower to heat and quicker to cool the hotter it is.
+ * plant_run drives it the way the firmware does, through the burst modulator.
+ */
+
+#define PLANT_EDGE_RATE (120.0) // zero crosses per second @ 60Hz AC
+#define PLANT_DELAY_MAX (4096)  // edges, ~34s
+
+typedef struct {
+    double gain;    // C above ambient at 100% duty
+    double tau;     // s
+    double delay;   // s
+    double ambient; // C
+    double noise;   // C, standard deviation of each sensor reading
+    double loss;    // 1/C, losses grow as rise * (1 + loss * rise) above ambient, 0 for the linear oven
+} plant_params_t;
+
+typedef struct {
+    plant_params_t params;
+    double         temp;
+    uint32_t       rng;
+
+    float  line[PLANT_DELAY_MAX]; // heater power, 0-1
+    size_t line_len;
+    size_t line_idx;
+
+    control_pwm_t pwm; // the heaters' modulator, one zone's
+} plant_t;
+
+extern const plant_params_t PLANT_DEFAULT;
+
+void   plant_init(plant_t *plant, const plant_params_t *params);
+void   plant_edge(plant_t *plant, double power);
+void   plant_run(plant_t *plant, real_t duty); // one control period of zero crosses at duty
+uint16_t plant_frame(plant_t *plant);
+double plant_sense(plant_t *plant, sensor_filter_t *filter, size_t sensors); // fused, one control period on
+
+#endif // PLANT_H
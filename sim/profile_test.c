@@ -0,0 +1,150 @@
+#include <math.h>
+#include <stdio.h>
+#include "check.h"
+#include "command.h"
+#include "profile.h"
+
+/*
+ * Compiles a profile with every step type and checks the segments' times,
+ * temperatures and slopes, the steps the compiler refuses, and a run through
+ * it: targets along the ramps, waits that hold the target and profile time
+ * until the oven gets there from either side, profile time that leaves the
+ * waits out, and a cursor that only ever moves forward. Also checks that a
+ * manual run started in one zone leaves another zone's manual target alone.
+ */
+
+/* private data */
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+#define DT      (0.25)  // s, control period
+#define TOL     (1e-3)
+#define LAG     (20.0)  // s, of the simulated oven behind its target
+#define RUN_MAX (2000.0) // s
+
+// from ROOM_TEMP: 100s to 150, 0.5C/s to 200, hold 30s, wait for 230, 2C/s down, wait for 55
+static const profile_step_t steps[] = {
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 150.0, .value = 100.0 },
+    { .type = PROFILE_STEP_RAMP_RATE, .temp = 200.0, .value = 0.5 },
+    { .type = PROFILE_STEP_HOLD,                     .value = 30.0 },
+    { .type = PROFILE_STEP_REACH,     .temp = 230.0, .value = 3.0 },
+    { .type = PROFILE_STEP_RAMP_RATE, .temp = 100.0, .value = 2.0 },
+    { .type = PROFILE_STEP_REACH,     .temp = 50.0,  .value = 5.0 },
+};
+
+// start, end, temp, slope, thresh, wait
+static const profile_segment_t want[] = {
+    {   0.0, 100.0, ROOM_TEMP, 1.25, 0.0,    0 },
+    { 100.0, 200.0, 150.0,     0.5,  0.0,    0 },
+    { 200.0, 230.0, 200.0,     0.0,  0.0,    0 },
+    { 230.0, 230.0, 230.0,     0.0,  227.0,  1 },
+    { 230.0, 295.0, 230.0,    -2.0,  0.0,    0 },
+    { 295.0, 295.0, 50.0,      0.0,  55.0,  -1 },
+};
+
+/* private helpers */
+static void compile_test(void) {
+    profile_segment_t segs[COUNT_OF(steps)];
+    int n = profile_compile(steps, COUNT_OF(steps), ROOM_TEMP, segs, COUNT_OF(segs));
+    check("segments", n, COUNT_OF(want), 0);
+    for (int i = 0; i < n; i++) {
+        check("start", segs[i].start, want[i].start, TOL);
+        check("end",   segs[i].end,   want[i].end,   TOL);
+        check("temp",  segs[i].temp,  want[i].temp,  TOL);
+        check("slope", segs[i].slope, want[i].slope, TOL);
+        check("wait",  segs[i].wait,  want[i].wait,  0);
+        if (want[i].wait) {
+            check("thresh", segs[i].thresh, want[i].thresh, TOL);
+        }
+    }
+
+    const profile_step_t bad[][1] = {
+        {{ .type = PROFILE_STEP_RAMP_RATE, .temp = 150.0, .value = 0.0 }},
+        {{ .type = PROFILE_STEP_HOLD,                     .value = -1.0 }},
+        {{ .type = PROFILE_STEP_REACH,     .temp = NAN,   .value = 3.0 }},
+        {{ .type = PROFILE_STEP_REACH + 1, .temp = 150.0, .value = 3.0 }},
+    };
+    for (size_t i = 0; i < COUNT_OF(bad); i++) {
+        check("refused", profile_compile(bad[i], 1, ROOM_TEMP, segs, COUNT_OF(segs)), -1, 0);
+    }
+    check("too many", profile_compile(steps, COUNT_OF(steps), ROOM_TEMP, segs, COUNT_OF(segs) - 1), -1, 0);
+}
+
+static void wait_test(profile_type_t type) {
+    // the first wait by hand, the oven gets within 3C of 230 at 290s
+    profile_cursor_t cursor;
+    profile_cursor_init(&cursor, type);
+    profile_status_t status = profile_status(&cursor, 150.0, 170.0);
+    check("rate ramp", status.temp, 175.0, TOL);
+    check("rate slope", status.slope, 0.5, TOL);
+    status = profile_status(&cursor, 260.0, 220.0);
+    check("waiting", status.temp, 230.0, TOL);
+    check("wait slope", status.slope, 0.0, 0.0);
+    check("wait not done", status.done, false, 0);
+    check("wait segment", cursor.seg, 3, 0);
+    status = profile_status(&cursor, 290.0, 226.9);
+    check("short of it", status.temp, 230.0, TOL);
+    check("still waiting", cursor.seg, 3, 0);
+    status = profile_status(&cursor, 290.25, 227.0);
+    check("wait offset", cursor.offset, 60.25, TOL);
+    check("resumed", status.temp, 230.0, TOL);
+    status = profile_status(&cursor, 300.25, 227.0);
+    check("after wait", status.temp, 210.0, TOL); // 10s of profile time into the ramp down
+    check("down slope", status.slope, -2.0, TOL);
+}
+
+static void run_test(profile_type_t type) {
+    // an oven a lag behind its target, so both waits take a while
+    profile_cursor_t cursor;
+    profile_cursor_init(&cursor, type);
+    double temp = ROOM_TEMP, waited = 0.0, t = 0.0;
+    size_t seg = 0;
+    profile_status_t status = { .done = false };
+    for (; !status.done && t < RUN_MAX; t += DT) {
+        status = profile_status(&cursor, t, temp);
+        check("forward", cursor.seg >= seg, true, 0);
+        seg = cursor.seg;
+        if (!status.done && status.slope == 0.0 && cursor.seg < COUNT_OF(want) && want[cursor.seg].wait) {
+            waited += DT;
+        }
+        temp += (status.temp - temp) * DT / LAG;
+    }
+    check("done", status.done, true, 0);
+    check("end temp", status.temp, 50.0, TOL);
+    check("ran to the end", cursor.seg, COUNT_OF(want), 0);
+    // profile time is run time less the waits, each a tick or less out
+    check("profile time", t - cursor.offset, want[COUNT_OF(want) - 1].end, 2 * DT);
+    check("waits", cursor.offset, waited, 2 * DT);
+    printf("run %.1fs, %.1fs of it waiting, profile time %.1fs\n", t, cursor.offset, t - cursor.offset);
+}
+
+static void manual_test(void) {
+    // two zones, each with its own controller and queue like the oven task's
+    control_t ctrls[2];
+    queue_t queues[2];
+    for (int z = 0; z < 2; z++) {
+        control_init(&ctrls[z]);
+        queue_init(&queues[z], 60.0f);
+    }
+    const command_t a = { .type = COMMAND_START, .zone = 0, .start = { .profile = PROFILE_TYPE_MANUAL, .temp = 120.0 } };
+    const command_t b = { .type = COMMAND_START, .zone = 1, .start = { .profile = PROFILE_TYPE_MANUAL, .temp = 180.0 } };
+    check("zone A started", command_apply(&ctrls[0], &queues[0], &a), true, 0);
+    control_step(&ctrls[0], ROOM_TEMP, 0.0f);
+    check("zone A target", ctrls[0].target, 120.0, TOL);
+    check("zone B started", command_apply(&ctrls[1], &queues[1], &b), true, 0);
+    control_step(&ctrls[0], ROOM_TEMP, DT);
+    control_step(&ctrls[1], ROOM_TEMP, 0.0f);
+    check("zone A unchanged", ctrls[0].target, 120.0, TOL);
+    check("zone B target", ctrls[1].target, 180.0, TOL);
+}
+
+/* public functions */
+int main(void) {
+    profile_init();
+    compile_test();
+    int type = profile_add("every step", steps, COUNT_OF(steps), NULL);
+    check("added", type >= PROFILE_BUILTIN_COUNT, true, 0);
+    wait_test(type);
+    run_test(type);
+    manual_test();
+    return check_result();
+}
@@ -0,0 +1,118 @@
+#include <math.h>
+#include <stdio.h>
+#include "check.h"
+#include "command.h"
+#include "control.h"
+#include "plant.h"
+#include "queue.h"
+
+/*
+ * Runs a batch from the run queue against a simulated oven: every run starts
+ * by itself once the last has ended and the oven has cooled below the start
+ * temperature, the cycle time predicted during the first run matches the one
+ * measured, and a stop or clear leaves nothing more to start. Also checks
+ * what the queue refuses.
+ */
+
+/* private data */
+#define MAX_TICKS  (20000)
+#define START_TEMP (60.0) // C
+#define RUNS       (3)
+#define BOARDS     (4)
+#define CYCLE_TOL  (0.1)  // relative, predicted against measured
+
+static const plant_params_t PLANT = {
+    .gain = 400.0, .tau = 180.0, .delay = 6.0, .ambient = 25.0, .noise = 0.5,
+};
+
+/* private helpers */
+static void reject_test(profile_type_t type) {
+    queue_t queue;
+    queue_init(&queue, START_TEMP);
+    check("manual", queue_add(&queue, PROFILE_TYPE_MANUAL, 1, 1), false, 0);
+    check("no profile", queue_add(&queue, profile_count(), 1, 1), false, 0);
+    check("no runs", queue_add(&queue, type, 0, 1), false, 0);
+    check("no boards", queue_add(&queue, type, 1, 0), false, 0);
+    for (int i = 0; i < QUEUE_MAX_JOBS; i++) {
+        check("add", queue_add(&queue, type, 1, 1), true, 0);
+    }
+    check("full", queue_add(&queue, type, 1, 1), false, 0);
+    check("pending", queue_pending(&queue), QUEUE_MAX_JOBS, 0);
+    check("too hot", queue_temp_set(&queue, QUEUE_TEMP_MAX + 1.0f), false, 0);
+    check("too cold", queue_temp_set(&queue, ROOM_TEMP), false, 0);
+    check("start temp", queue.start_temp, START_TEMP, 0.0);
+
+    // a stop drops what hasn't started
+    control_t ctrl;
+    control_init(&ctrl);
+    const command_t stop = { .type = COMMAND_STOP };
+    profile_type_t next;
+    check("starts", queue_step(&queue, &ctrl, 0.0f, &next), true, 0);
+    control_start(&ctrl, next);
+    command_apply(&ctrl, &queue, &stop);
+    check("stopped", queue_pending(&queue), 0, 0);
+    check("no restart", queue_step(&queue, &ctrl, 1.0f, &next), false, 0);
+    check("idle", queue.state, QUEUE_IDLE, 0);
+}
+
+static void batch_test(profile_type_t type) {
+    static plant_t plant;
+    plant_init(&plant, &PLANT);
+    sensor_filter_t filter;
+    sensor_filter_init(&filter);
+    control_t ctrl;
+    control_init(&ctrl);
+    control_pid_set(&ctrl, 0.3, 0.01, 0.0);
+    queue_t queue;
+    queue_init(&queue, START_TEMP);
+    queue_add(&queue, type, RUNS, BOARDS);
+
+    // the prediction as the first run ends, against the first cycle measured
+    double started = 0.0, ended = NAN, first = NAN, predicted = NAN, throughput = NAN;
+    int runs = 0;
+    for (size_t n = 0; n < MAX_TICKS; n++) {
+        double t = n * CONTROL_PERIOD;
+        bool was_running = ctrl.running;
+        control_step(&ctrl, plant_sense(&plant, &filter, 1), t - started);
+        if (was_running && !ctrl.running) {
+            ended = t;
+        }
+        profile_type_t next;
+        if (queue_step(&queue, &ctrl, t, &next)) {
+            check("below start temp", fmin(ctrl.current, START_TEMP), ctrl.current, 0.0);
+            if (runs > 0) {
+                check("gap", fmax(t - ended, QUEUE_GAP), t - ended, 0.0);
+            }
+            if (runs == 1) {
+                first = t - started;
+            }
+            control_start(&ctrl, next);
+            started = t;
+            runs++;
+        }
+        if (runs == 1 && !ctrl.running && isnan(predicted)) {
+            predicted  = queue.predicted;
+            throughput = queue_throughput(&queue);
+        }
+        if (queue.state == QUEUE_IDLE) {
+            break;
+        }
+        plant_run(&plant, ctrl.duty);
+    }
+    printf("%d runs, cycle %.1fs predicted %.1fs, first %.1fs, %.2f boards/h predicted %.2f\n",
+        runs, queue.cycle, predicted, first, queue_throughput(&queue), throughput);
+    check("runs", runs, RUNS, 0);
+    check("idle", queue.state, QUEUE_IDLE, 0);
+    check("counted", queue.runs, RUNS, 0);
+    check("predicted", predicted, first, first * CYCLE_TOL);
+    check("throughput", queue_throughput(&queue), BOARDS * 3600.0 / queue.cycle, 1e-3);
+    check("predicted throughput", throughput, queue_throughput(&queue), queue_throughput(&queue) * CYCLE_TOL);
+}
+
+/* public functions */
+int main(void) {
+    profile_init();
+    reject_test(PROFILE_TYPE_SAC305);
+    batch_test(PROFILE_TYPE_SAC305); // a whole one, so the model has seen enough of the oven
+    return check_result();
+}
@@ -0,0 +1,56 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include "ring.h"
+
+/*
+ * Hammers the SPSC ring from two threads. The producer retries while the ring
+ * is full, so every sample must come out whole and in order.
+ */
+
+/* private data */
+#define NUM_SAMPLES (2000000)
+
+static ring_t ring;
+
+/* private helpers */
+static void *producer(void *arg) {
+    for (int64_t i = 0; i < NUM_SAMPLES; i++) {
+        ring_sample_t sample = {
+            .time = i,
+            .num  = SENSOR_MAX,
+        };
+        for (int j = 0; j < SENSOR_MAX; j++) {
+            sample.raw[j] = (uint16_t) (i * (j + 1));
+        }
+        while (!ring_push(&ring, &sample)) {
+            sched_yield(); // may be sharing a single core with the consumer
+        }
+    }
+    return NULL;
+}
+
+/* public functions */
+int main(void) {
+    ring_init(&ring);
+    pthread_t thread;
+    pthread_create(&thread, NULL, producer, NULL);
+
+    int64_t last = -1, errors = 0;
+    while (last < NUM_SAMPLES - 1) {
+        ring_sample_t sample;
+        if (!ring_pop(&ring, &sample)) {
+            sched_yield();
+            continue;
+        }
+        errors += sample.time != last + 1 || sample.num != SENSOR_MAX;
+        for (int j = 0; j < SENSOR_MAX; j++) {
+            errors += sample.raw[j] != (uint16_t) (sample.time * (j + 1)); // torn copy
+        }
+        last = sample.time;
+    }
+    pthread_join(thread, NULL);
+
+    printf("%d samples, %u full pushes, %lld errors\n", NUM_SAMPLES, ring_dropped(&ring), (long long) errors);
+    return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,335 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "runlog.h"
+
+/*
+ * Runs the run log against a RAM flash that behaves like NOR (writes only
+ * clear bits, erase sets a whole block). Checks samples come back exactly
+ * across block boundaries and remounts along with the run's quality result,
+ * that the oldest runs are evicted
+ * first when the partition fills, that deleted runs stay deleted, that a
+ * write cut short by power loss costs at most the block being written, that
+ * erases are spread evenly over the partition, and that runs in two zones
+ * can be written at the same time and found again after a remount.
+ */
+
+/* private data */
+#define BLOCKS    (16)
+#define RUN_LEN   (1500) // samples, three blocks
+#define RUNS      (12)   // enough to lap the partition twice
+
+typedef struct {
+    uint8_t  data[BLOCKS * RUNLOG_BLOCK];
+    uint32_t erases[BLOCKS];
+    long     budget; // bytes that may still be written, negative for no limit
+} flash_t;
+
+static int errors;
+static flash_t flash;
+static runlog_t log_;
+
+static const analytics_result_t quality = {
+    .peak     = 245.5f,
+    .tal      = 61.25f,
+    .liquidus = 217.0f,
+    .verdict  = ANALYTICS_PASS,
+};
+
+/* private helpers */
+static void fail(const char *what, long got, long want) {
+    if (errors++ < 10) {
+        printf("FAIL %s: got %ld want %ld\n", what, got, want);
+    }
+}
+
+static bool flash_read(void *ctx, uint32_t offset, void *buf, size_t len) {
+    flash_t *f = ctx;
+    memcpy(buf, &f->data[offset], len);
+    return true;
+}
+
+static bool flash_write(void *ctx, uint32_t offset, const void *buf, size_t len) {
+    flash_t *f = ctx;
+    const uint8_t *bytes = buf;
+    for (size_t i = 0; i < len; i++) {
+        if (f->budget == 0) {
+            return false; // power cut
+        }
+        f->budget -= (f->budget > 0);
+        f->data[offset + i] &= bytes[i];
+    }
+    return true;
+}
+
+static bool flash_erase(void *ctx, uint32_t offset) {
+    flash_t *f = ctx;
+    memset(&f->data[offset], 0xFF, RUNLOG_BLOCK);
+    f->erases[offset / RUNLOG_BLOCK]++;
+    return true;
+}
+
+static void mount(void) {
+    const runlog_flash_t f = {
+        .read   = flash_read,
+        .write  = flash_write,
+        .erase  = flash_erase,
+        .ctx    = &flash,
+        .blocks = BLOCKS,
+    };
+    if (!runlog_mount(&log_, &f)) {
+        fail("mount", 0, 1);
+    }
+}
+
+static runlog_sample_t sample(uint32_t run, uint32_t i) {
+    runlog_sample_t s = {
+        .current = run * 100 + i,
+        .target  = -(int16_t) i,
+        .duty    = run ^ (i << 4),
+    };
+    return s;
+}
+
+static uint32_t record(uint32_t samples) {
+    runlog_header_t header = {
+        .period = 250,
+        .kp     = 0.1f,
+        .profile = "test",
+    };
+    uint32_t run = runlog_begin(&log_, &header);
+    for (uint32_t i = 0; i < samples; i++) {
+        runlog_sample_t s = sample(run, i);
+        runlog_append(&log_, 0, &s);
+    }
+    runlog_end(&log_, 0, &quality);
+    return run;
+}
+
+static void verify(uint32_t run, uint32_t samples) {
+    // odd chunk size so reads straddle block boundaries
+    runlog_info_t info;
+    if (!runlog_info(&log_, run, &info) || info.samples != samples || strcmp(info.header.profile, "test") != 0) {
+        fail("info samples", info.samples, samples);
+        return;
+    }
+    runlog_sample_t out[37];
+    uint32_t first = 0;
+    size_t n;
+    do {
+        n = runlog_read(&log_, run, first, out, 37);
+        for (size_t i = 0; i < n; i++) {
+            runlog_sample_t want = sample(run, first + i);
+            if (memcmp(&out[i], &want, sizeof(want)) != 0) {
+                fail("sample", first + i, -1);
+                return;
+            }
+        }
+        first += n;
+    } while (n > 0);
+    if (first != samples) {
+        fail("samples read", first, samples);
+    }
+}
+
+static size_t list(uint32_t *runs) {
+    return runlog_list(&log_, runs, BLOCKS);
+}
+
+static void basic_test(void) {
+    uint32_t runs[BLOCKS];
+    mount();
+    uint32_t a = record(RUN_LEN);
+    uint32_t b = record(100);
+    record(0); // leaves nothing
+    if (list(runs) != 2 || runs[0] != a || runs[1] != b) {
+        fail("runs listed", list(runs), 2);
+    }
+    verify(a, RUN_LEN);
+    verify(b, 100);
+
+    uint32_t head = log_.head;
+    mount();
+    if (list(runs) != 2 || log_.head != head || log_.next_id != b + 1) {
+        fail("remounted head", log_.head, head);
+    }
+    verify(a, RUN_LEN);
+    verify(b, 100);
+    runlog_info_t info;
+    if (!runlog_info(&log_, a, &info) || !info.finished ||
+        memcmp(&info.quality, &quality, sizeof(quality)) != 0) {
+        fail("quality stored", info.finished, 1);
+    }
+
+    if (!runlog_delete(&log_, a) || runlog_delete(&log_, a)) {
+        fail("delete", 0, 1);
+    }
+    mount();
+    if (list(runs) != 1 || runs[0] != b) {
+        fail("runs after delete", list(runs), 1);
+    }
+}
+
+static void evict_test(void) {
+    // each run takes three blocks, only the newest five fit
+    uint32_t runs[BLOCKS];
+    uint32_t last = 0;
+    memset(flash.erases, 0, sizeof(flash.erases));
+    for (int i = 0; i < RUNS; i++) {
+        last = record(RUN_LEN);
+    }
+    size_t n = list(runs);
+    uint32_t evicted = log_.evicted;
+    if (n != BLOCKS / 3 || runs[n - 1] != last || runs[0] != last - n + 1) {
+        fail("runs kept", n, BLOCKS / 3);
+    }
+    if (evicted != RUNS + 1 - n) { // and the one left from basic_test
+        fail("runs evicted", evicted, RUNS + 1 - n);
+    }
+    mount();
+    if (list(runs) != n) {
+        fail("runs kept after remount", list(runs), n);
+    }
+    for (size_t i = 0; i < n; i++) {
+        verify(runs[i], RUN_LEN);
+    }
+
+    uint32_t most = 0, least = UINT32_MAX;
+    for (int i = 0; i < BLOCKS; i++) {
+        most  = (flash.erases[i] > most)  ? flash.erases[i] : most;
+        least = (flash.erases[i] < least) ? flash.erases[i] : least;
+    }
+    printf("evict    %u runs kept of %d, %u evicted, erases per block %u-%u\n",
+        (unsigned) n, RUNS, (unsigned) evicted, (unsigned) least, (unsigned) most);
+    if (most - least > 1) {
+        fail("erase spread", most - least, 1);
+    }
+}
+
+static void power_test(void) {
+    // cut power halfway through the second block of a run
+    uint32_t before[BLOCKS], after[BLOCKS];
+    mount();
+    size_t n = list(before);
+
+    runlog_header_t header = {.period = 250, .profile = "test"};
+    uint32_t run = runlog_begin(&log_, &header);
+    for (uint32_t i = 0; i < RUN_LEN; i++) {
+        if (i == 1000) {
+            flash.budget = RUNLOG_BLOCK / 2;
+        }
+        runlog_sample_t s = sample(run, i);
+        runlog_append(&log_, 0, &s);
+    }
+    runlog_end(&log_, 0, &quality);
+    flash.budget = -1;
+
+    mount();
+    size_t m = list(after);
+    if (m == 0 || after[m - 1] != run) {
+        fail("first block kept", m, n + 1);
+        return;
+    }
+    runlog_info_t info;
+    runlog_info(&log_, run, &info);
+    printf("power    %u of %u samples kept after a cut in block 2\n", (unsigned) info.samples, RUN_LEN);
+    verify(run, info.samples);
+    if (info.blocks != 1 || info.finished) {
+        fail("blocks kept", info.blocks, 1);
+    }
+    if (record(10) != run + 1) {
+        fail("next run after cut", log_.next_id, run + 2);
+    }
+}
+
+static void long_test(void) {
+    // longer than the whole partition, everything that fit stays readable
+    uint32_t runs[BLOCKS];
+    mount();
+    uint32_t run = record(BLOCKS * 700);
+    runlog_info_t info;
+    if (list(runs) != 1 || !runlog_info(&log_, run, &info) || info.blocks != BLOCKS) {
+        fail("long run blocks", info.blocks, BLOCKS);
+    }
+    verify(run, info.samples);
+}
+
+static void interleave_test(void) {
+    // a zone 1 run inside a longer zone 0 one, which writes its last blocks after the other ended
+    uint32_t runs[BLOCKS];
+    mount();
+    runlog_header_t header = {.period = 250, .profile = "test"};
+    uint32_t a = runlog_begin(&log_, &header);
+    if (runlog_begin(&log_, &header) != 0) {
+        fail("second run in a zone", 1, 0);
+    }
+    header.zone = 1;
+    uint32_t b = runlog_begin(&log_, &header);
+    if (a == 0 || b == 0) {
+        fail("runs begun", 0, 1);
+        return;
+    }
+    for (uint32_t i = 0; i < RUN_LEN; i++) {
+        runlog_sample_t s = sample(a, i);
+        runlog_append(&log_, 0, &s);
+        if (i < RUN_LEN / 2) {
+            s = sample(b, i);
+            runlog_append(&log_, 1, &s);
+        } else if (i == RUN_LEN / 2) {
+            runlog_end(&log_, 1, &quality);
+            if (list(runs) != 1 || runs[0] != b) {
+                fail("open run listed", list(runs), 1);
+            }
+        }
+    }
+    runlog_end(&log_, 0, &quality);
+
+    uint32_t head = log_.head;
+    mount();
+    size_t n = list(runs);
+    if (n != 2 || runs[0] != a || runs[1] != b || log_.head != head) {
+        fail("interleaved runs kept", n, 2);
+    }
+    runlog_info_t info_a, info_b;
+    if (!runlog_info(&log_, a, &info_a) || !runlog_info(&log_, b, &info_b) ||
+        info_a.header.zone != 0 || info_b.header.zone != 1 || !info_a.finished || !info_b.finished) {
+        fail("zones stored", info_b.header.zone, 1);
+    }
+    verify(a, RUN_LEN);
+    verify(b, RUN_LEN / 2);
+    printf("zones    runs %u and %u interleaved, %u and %u blocks\n",
+        (unsigned) a, (unsigned) b, (unsigned) info_a.blocks, (unsigned) info_b.blocks);
+}
+
+static void pack_test(void) {
+    double worst = 0.0;
+    for (double temp = -20.0; temp < 400.0; temp += 0.37) {
+        history_sample_t in = {.current = temp, .target = temp + 1.0, .duty = temp / 400.0};
+        runlog_sample_t packed = runlog_pack(&in);
+        history_sample_t out = runlog_unpack(&packed, 0);
+        double err = fabs(out.current - in.current);
+        worst = (err > worst) ? err : worst;
+        if (fabs(out.duty - fmax(in.duty, 0.0)) > 1.0 / 65535) {
+            fail("duty", out.duty * 1e6, in.duty * 1e6);
+        }
+    }
+    printf("pack     worst temperature error %.4fC\n", worst);
+    if (worst > 1.0 / 32 + 1e-6) {
+        fail("temperature precision", worst * 1e6, 1e6 / 32);
+    }
+}
+
+/* public functions */
+int main(void) {
+    memset(flash.data, 0xFF, sizeof(flash.data));
+    flash.budget = -1;
+    basic_test();
+    evict_test();
+    power_test();
+    long_test();
+    interleave_test();
+    pack_test();
+    printf("%d errors\n", errors);
+    return (errors == 0) ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+#include <math.h>
+#include <stdio.h>
+#include "check.h"
+#include "control.h"
+#include "plant.h"
+
+/*
+ * Checks the PID gain schedule: which entries apply for a phase and target
+ * temperature, that a table is only taken whole, that a phase change slews
+ * the gains rather than stepping the output, and that on an oven whose losses
+ * grow with temperature a schedule tracks the profiles better than the single
+ * set of gains autotune finds.
+ */
+
+/* private data */
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+
+#define MAX_TICKS  (8192)
+#define TUNE_TEMP  (180.0) // C, as the firmware's default
+#define GAIN_TOL   (1e-6)
+#define BUMP_MAX   (0.05)  // duty per tick on a phase change
+#define SETTLE     (60.0)  // s, scheduled gains are within 1% of the table after this
+#define RMS_GAIN   (0.8)   // scheduled rms at most this much of the single gains'
+#define OVER_MAX   (5.0)   // C, as bench
+
+// hotter, so harder to push and quicker to fall back
+static const plant_params_t PLANT = {
+    .gain = 600.0, .tau = 180.0, .delay = 6.0, .ambient = 25.0, .noise = 0.25, .loss = 0.005,
+};
+
+static const profile_step_t ramp_hold[] = {
+    { .type = PROFILE_STEP_RAMP_TIME, .temp = 150.0, .value = 100.0 },
+    { .type = PROFILE_STEP_HOLD,                     .value = 100.0 },
+};
+
+/* private helpers */
+static double kp_at(const control_sched_t *sched, profile_type_t type, double temp) {
+    // the gains a run starts with, which are the table's straight away
+    control_t ctrl;
+    control_init(&ctrl);
+    control_pid_set(&ctrl, 1.0, 0.0, 0.0);
+    control_sched_set(&ctrl, sched);
+    control_start(&ctrl, type);
+    ctrl.cursor.manual_temp = temp;
+    control_step(&ctrl, ROOM_TEMP, 0.0);
+    return ctrl.pid.kp;
+}
+
+static void lookup_test(int ramp) {
+    const control_sched_t sched = {
+        .num     = 3,
+        .entries = {
+            { .phase = CONTROL_PHASE_ANY,  .temp = 200.0, .gains = { .kp = 0.2 } },
+            { .phase = CONTROL_PHASE_RAMP, .temp = 150.0, .gains = { .kp = 0.5 } },
+            { .phase = CONTROL_PHASE_ANY,  .temp = 100.0, .gains = { .kp = 0.1 } },
+        },
+    };
+    check("between",     kp_at(&sched, PROFILE_TYPE_MANUAL, 150.0), 0.15, GAIN_TOL);
+    check("below first", kp_at(&sched, PROFILE_TYPE_MANUAL, 50.0),  0.1,  GAIN_TOL);
+    check("past last",   kp_at(&sched, PROFILE_TYPE_MANUAL, 250.0), 0.2,  GAIN_TOL);
+    check("phase",       kp_at(&sched, ramp, 0.0),                  0.5,  GAIN_TOL);
+    const control_sched_t empty = { .num = 0 };
+    check("none",        kp_at(&empty, PROFILE_TYPE_MANUAL, 150.0), 1.0,  0.0);
+
+    control_t ctrl;
+    control_init(&ctrl);
+    control_sched_t bad = sched;
+    bad.entries[2].temp = 200.0; // repeats the first
+    check("repeat", control_sched_set(&ctrl, &bad), false, 0);
+    bad = sched;
+    bad.entries[1].gains.ki = -0.1;
+    check("negative", control_sched_set(&ctrl, &bad), false, 0);
+    bad = sched;
+    bad.entries[0].phase = CONTROL_PHASE_COOL + 1;
+    check("bad phase", control_sched_set(&ctrl, &bad), false, 0);
+    bad.num = CONTROL_SCHED_MAX + 1;
+    check("too many", control_sched_set(&ctrl, &bad), false, 0);
+    check("unchanged", ctrl.sched.num, 0, 0);
+}
+
+static void bumpless_test(int ramp) {
+    // a steady error through the ramp to hold change, kp triples
+    const control_sched_t sched = {
+        .num     = 2,
+        .entries = {
+            { .phase = CONTROL_PHASE_RAMP, .gains = { .kp = 0.02 } },
+            { .phase = CONTROL_PHASE_HOLD, .gains = { .kp = 0.06 } },
+        },
+    };
+    control_t ctrl;
+    control_init(&ctrl);
+    control_sched_set(&ctrl, &sched);
+    control_start(&ctrl, ramp);
+    double prev = NAN, bump = 0.0, hold_at = NAN;
+    for (size_t n = 0; ctrl.running && n < MAX_TICKS; n++) {
+        double t = n * CONTROL_PERIOD;
+        control_step(&ctrl, ctrl.target - 10.0, t);
+        if (!isnan(prev) && ctrl.running) { // not the heaters going off at the end
+            bump = fmax(bump, fabs(ctrl.duty - prev));
+        }
+        prev = ctrl.duty;
+        if (isnan(hold_at) && ctrl.phase == CONTROL_PHASE_HOLD) {
+            hold_at = t;
+        }
+        if (t == hold_at + SETTLE) {
+            check("settled", ctrl.pid.kp, 0.06, 0.06 * 0.01);
+        }
+    }
+    printf("phase change: worst duty step %.4f, %.2f unslewed\n", bump, 10.0 * (0.06 - 0.02));
+    check("bump", bump, 0.0, BUMP_MAX);
+}
+
+static control_gains_t tune(void) {
+    static plant_t plant;
+    plant_init(&plant, &PLANT);
+    sensor_filter_t filter;
+    sensor_filter_init(&filter);
+    control_t ctrl;
+    control_init(&ctrl);
+    control_autotune(&ctrl, TUNE_TEMP);
+    for (size_t n = 0; ctrl.running && n < 4 * MAX_TICKS; n++) {
+        control_step(&ctrl, plant_sense(&plant, &filter, 1), n * CONTROL_PERIOD);
+        plant_run(&plant, ctrl.duty);
+    }
+    check("autotune done", ctrl.tune.state, AUTOTUNE_DONE, 0);
+    return ctrl.gains;
+}
+
+static void run(profile_type_t type, const control_gains_t *gains, const control_sched_t *sched,
+        double *rms, double *over) {
+    // tracking error up to the peak of the profile, cooling is passive
+    static plant_t plant;
+    plant_init(&plant, &PLANT);
+    sensor_filter_t filter;
+    sensor_filter_init(&filter);
+    control_t ctrl;
+    control_init(&ctrl);
+    control_pid_set(&ctrl, gains->kp, gains->ki, gains->kd);
+    control_sched_set(&ctrl, sched);
+    control_start(&ctrl, type);
+    double sq = 0.0, peak = 0.0, max_temp = 0.0;
+    size_t heating = 0;
+    for (size_t n = 0; n < MAX_TICKS; n++) {
+        control_step(&ctrl, plant_sense(&plant, &filter, 1), n * CONTROL_PERIOD);
+        if (!ctrl.running) {
+            break;
+        }
+        if (ctrl.target >= peak) {
+            double err = ctrl.target - plant.temp;
+            sq  += err * err;
+            peak = ctrl.target;
+            heating++;
+        }
+        max_temp = fmax(max_temp, plant.temp);
+        plant_run(&plant, ctrl.duty);
+    }
+    *rms  = sqrt(sq / heating);
+    *over = max_temp - peak;
+}
+
+static void tracking_test(void) {
+    // autotune's gains on the holds, ramps pushed harder and more so where losses are high
+    const control_gains_t tuned = tune();
+    const control_sched_t sched = {
+        .num     = 2,
+        .entries = {
+            { .phase = CONTROL_PHASE_RAMP, .temp = 100.0, .gains = { 1.5f * tuned.kp, 1.5f * tuned.ki, tuned.kd } },
+            { .phase = CONTROL_PHASE_RAMP, .temp = 220.0, .gains = { 2.0f * tuned.kp, 1.5f * tuned.ki, tuned.kd } },
+        },
+    };
+    const control_sched_t none = { .num = 0 };
+    printf("tuned kp %.5f ki %.5f kd %.5f\n", tuned.kp, tuned.ki, tuned.kd);
+    const profile_type_t types[] = {PROFILE_TYPE_SAC305, PROFILE_TYPE_SN63PB37};
+    for (size_t i = 0; i < COUNT_OF(types); i++) {
+        double rms, over, sched_rms, sched_over;
+        run(types[i], &tuned, &none, &rms, &over);
+        run(types[i], &tuned, &sched, &sched_rms, &sched_over);
+        printf("%-10s rms %5.2fC over %5.2fC, scheduled rms %5.2fC over %5.2fC\n",
+            profile_name(types[i]), rms, over, sched_rms, sched_over);
+        check("scheduled rms", sched_rms, 0.0, rms * RMS_GAIN);
+        check("scheduled overshoot", fmax(sched_over, 0.0), 0.0, OVER_MAX);
+    }
+}
+
+/* public functions */
+int main(void) {
+    profile_init();
+    int ramp = profile_add("ramp hold", ramp_hold, COUNT_OF(ramp_hold), NULL);
+    lookup_test(ramp);
+    bumpless_test(ramp);
+    tracking_test();
+    return check_result();
+}
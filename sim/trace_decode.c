@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include "trace.h"
+
+/*
+ * Turns the output of the firmware's trace command into CSV, one row per
+ * control tick:
+ *
+ *     stty -F /dev/ttyACM0 raw -echo
+ *     cat /dev/ttyACM0 | ./trace_decode > run.csv
+ *
+ * Log text and damaged frames in the stream are skipped. Dropped records
+ * show up as gaps in seq and are reported on stderr with the bad frames.
+ */
+
+/* private helpers */
+static void header(void) {
+    printf("seq,time_ms,temp,target,err,p,i,d,ff,duty,pwm");
+    for (int i = 0; i < SENSOR_MAX; i++) {
+        printf(",raw%d", i);
+    }
+    printf(",running,tuning,faulted,int_held\n");
+}
+
+static void row(const trace_record_t *rec) {
+    printf("%u,%u,%.2f,%.2f,%.2f,%.5f,%.5f,%.5f,%.5f,%.5f,%u", (unsigned) rec->seq, (unsigned) rec->time,
+        rec->temp, rec->target, rec->target - rec->temp, rec->p, rec->i, rec->d, rec->ff, rec->duty,
+        (unsigned) rec->pwm);
+    for (int i = 0; i < SENSOR_MAX; i++) {
+        printf(",0x%04x", rec->raw[i]);
+    }
+    printf(",%d,%d,%d,%d\n", !!(rec->flags & TRACE_RUNNING), !!(rec->flags & TRACE_TUNING),
+        !!(rec->flags & TRACE_FAULTED), !!(rec->flags & TRACE_INT_HELD));
+}
+
+/* public functions */
+int main(void) {
+    trace_parser_t parser;
+    trace_parser_init(&parser);
+    trace_record_t rec;
+    unsigned records = 0;
+    unsigned missing = 0;
+    uint32_t next    = 0;
+    int c;
+
+    header();
+    while ((c = getchar()) != EOF) {
+        if (!trace_parse(&parser, c, &rec)) {
+            continue;
+        }
+        if (records > 0 && rec.seq != next) {
+            fprintf(stderr, "gap: %u records missing before seq %u\n",
+                (unsigned) (rec.seq - next), (unsigned) rec.seq);
+            missing += rec.seq - next;
+        }
+        next = rec.seq + 1;
+        records++;
+        row(&rec);
+    }
+    fprintf(stderr, "%u records, %u missing, %u bad frames\n", records, missing, (unsigned) parser.bad);
+    return (records > 0) ? 0 : 1;
+}
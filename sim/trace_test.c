@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+
+/*
+ * Pushes records through the trace ring and frames them into a byte stream
+ * interleaved with log text and damaged frames, the way they come off the
+ * console. Every intact frame must decode to the record that went in, and
+ * the damaged ones must be counted rather than decoded. Also reports what a
+ * push costs, which the oven task pays every tick while tracing.
+ */
+
+/* private data */
+#define RECORDS (2000)
+#define CORRUPT (17) // every n frames
+#define COST_N  (1000000)
+
+static int errors;
+
+/* private helpers */
+static void fail(const char *what, unsigned got, unsigned want) {
+    if (errors++ < 10) {
+        printf("FAIL %s: got %u want %u\n", what, got, want);
+    }
+}
+
+static trace_record_t record(uint32_t seq) {
+    trace_record_t rec = {
+        .seq    = seq,
+        .time   = seq * 250,
+        .temp   = 25.0f + seq * 0.1f,
+        .target = 30.0f + seq * 0.1f,
+        .p      = 0.5f,
+        .i      = seq * 0.001f,
+        .d      = -0.01f,
+        .duty   = 0.49f,
+        .pwm    = seq * 31,
+        .raw    = {seq & 0xFFFF, 0xA55A, 0x5AA5, 0xFFFF},
+        .flags  = seq & 0xF,
+    };
+    return rec;
+}
+
+static void ring_test(void) {
+    static trace_ring_t ring;
+    trace_init(&ring);
+    trace_record_t rec;
+    for (uint32_t i = 0; i < TRACE_LEN + 10; i++) {
+        rec = record(i);
+        trace_push(&ring, &rec);
+    }
+    if (trace_dropped(&ring) != 10) {
+        fail("dropped", trace_dropped(&ring), 10);
+    }
+    uint32_t n = 0;
+    while (trace_pop(&ring, &rec)) {
+        if (rec.seq != n) {
+            fail("ring order", rec.seq, n);
+        }
+        n++;
+    }
+    if (n != TRACE_LEN) {
+        fail("ring popped", n, TRACE_LEN);
+    }
+}
+
+static void stream_test(void) {
+    // log lines between frames, sync bytes in the payload, one flipped bit now and then
+    static uint8_t stream[RECORDS * (TRACE_FRAME_LEN + 32)];
+    size_t len = 0;
+    unsigned corrupted = 0;
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        trace_record_t rec = record(i);
+        if (i % 10 == 0) {
+            len += sprintf((char *) &stream[len], "I (%u) oven: \xA5\x5A log text\n", (unsigned) i);
+        }
+        size_t n = trace_frame(&rec, &stream[len]);
+        if (i % CORRUPT == 5) {
+            stream[len + 3 + rand() % (n - 3)] ^= 1 << (rand() % 8);
+            corrupted++;
+        }
+        len += n;
+    }
+
+    trace_parser_t parser;
+    trace_parser_init(&parser);
+    trace_record_t rec;
+    unsigned decoded = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (!trace_parse(&parser, stream[i], &rec)) {
+            continue;
+        }
+        trace_record_t want = record(rec.seq);
+        if (rec.seq % CORRUPT == 5 || memcmp(&rec, &want, sizeof(rec)) != 0) {
+            fail("decoded record", rec.seq, want.seq);
+        }
+        decoded++;
+    }
+    printf("stream   %u of %u records decoded, %u bad frames\n", decoded, RECORDS, (unsigned) parser.bad);
+    if (decoded != RECORDS - corrupted) {
+        fail("decoded", decoded, RECORDS - corrupted);
+    }
+    if (parser.bad < corrupted) {
+        fail("bad frames", parser.bad, corrupted);
+    }
+}
+
+static void cost_test(void) {
+    static trace_ring_t ring;
+    trace_init(&ring);
+    trace_record_t rec = record(0);
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t i = 0; i < COST_N; i++) {
+        rec.seq = i;
+        trace_push(&ring, &rec);
+        trace_pop(&ring, &rec);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double ns = ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / COST_N;
+    printf("cost     %.1f ns per record pushed and popped (%zu bytes)\n", ns, sizeof(trace_record_t));
+}
+
+/* public functions */
+int main(void) {
+    srand(1);
+    ring_test();
+    stream_test();
+    cost_test();
+    printf("%d errors\n", errors);
+    return (errors == 0) ? 0 : 1;
+}
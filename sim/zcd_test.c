@@ -0,0 +1,173 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "control.h"
+#include "phase.h"
+#include "zcd.h"
+
+/*
+ * Feeds zero cross tracking and phase-angle timing a simulated edge stream:
+ * 60Hz then 50Hz mains with jitter, spurious edges and missed edges. Checks
+ * that the half-cycle is tracked, that glitches are classified and counted,
+ * gaps of any length included, that the lookup table delivers the requested
+ * power, and that no gate pulse runs into the next zero cross.
+ */
+
+/* private data */
+#define POWER_TOL   (0.005) // fraction of full power
+#define PERIOD_TOL  (0.01)  // fraction of the half-cycle
+#define JITTER_US   (20.0)
+#define SETTLE      (60)    // edges after a frequency change
+#define EDGES       (600)   // per frequency
+#define SPURIOUS    (37)    // every n edges
+#define MISSED      (101)   // every n edges
+
+static int errors;
+static int resyncs; // edges after a missed one
+
+/* private helpers */
+static void fail(const char *what, double got, double want) {
+    if (errors++ < 10) {
+        printf("FAIL %s: got %.4f want %.4f\n", what, got, want);
+    }
+}
+
+static double jitter(void) {
+    return JITTER_US * (2.0 * rand() / RAND_MAX - 1.0);
+}
+
+static void lut_test(void) {
+    // delivered power matches requested, and more power never fires later
+    const uint32_t period = 1000000 / 120;
+    uint32_t last = PHASE_OFF;
+    double worst = 0.0;
+    for (uint32_t power = 0; power <= PWM_ONE; power += 16) {
+        uint32_t delay = phase_delay(power, period);
+        double want = (double) power / PWM_ONE;
+        if (delay != PHASE_OFF && last != PHASE_OFF && delay > last) {
+            fail("monotonic", delay, last);
+        }
+        last = delay;
+        if (delay == PHASE_OFF) {
+            double latest = phase_power((double) (period - PHASE_PULSE_US - PHASE_MARGIN_US) / period);
+            if (want > latest + POWER_TOL) {
+                fail("off", want, latest);
+            }
+            continue;
+        }
+        if (delay == PHASE_MIN_US) {
+            continue; // clamped near full power
+        }
+        double got = phase_power((double) delay / period);
+        worst = fmax(worst, fabs(got - want));
+        if (fabs(got - want) > POWER_TOL) {
+            fail("power", got, want);
+        }
+    }
+    printf("lut      worst power error %.5f\n", worst);
+}
+
+static void stream(double hz, int64_t *now, zcd_t *zcd, uint32_t power) {
+    // one frequency's worth of edges, with the odd glitch
+    const double period = 1e6 / (2.0 * hz);
+    const uint32_t spurious = zcd->spurious, missed = zcd->missed;
+    int glitches = 0, gaps = 0;
+    bool gap = false;
+    double sum = 0.0;
+    int fired = 0;
+    for (int i = 0; i < EDGES; i++) {
+        int64_t edge = *now + llround(period + jitter());
+        if (i % MISSED == MISSED - 1) {
+            *now = edge; // detector missed this one
+            gap  = true;
+            gaps++;
+            continue;
+        }
+        zcd_edge_t type = zcd_edge(zcd, edge);
+        if (type != (gap ? ZCD_EDGE_MISSED : ZCD_EDGE_OK) && !(i == 0 && type == ZCD_EDGE_OK)) {
+            fail("edge type", type, gap ? ZCD_EDGE_MISSED : ZCD_EDGE_OK);
+        }
+        gap = false;
+        uint32_t delay = phase_delay(power, zcd->period);
+        if (delay != PHASE_OFF && delay + PHASE_PULSE_US > period - PHASE_MARGIN_US / 2) {
+            fail("pulse overlaps zero cross", delay + PHASE_PULSE_US, period);
+        }
+        if (i >= SETTLE) {
+            if (fabs(zcd->period - period) > period * PERIOD_TOL) {
+                fail("period", zcd->period, period);
+            }
+            sum += (delay == PHASE_OFF) ? 0.0 : phase_power(delay / period);
+            fired++;
+        }
+        if (i % SPURIOUS == SPURIOUS - 1) {
+            int64_t glitch = edge + llround(period * 0.3);
+            if (zcd_edge(zcd, glitch) != ZCD_EDGE_SPURIOUS || zcd->edge != edge) {
+                fail("spurious", zcd->edge, edge);
+            }
+            glitches++;
+        }
+        *now = edge;
+    }
+    double want = (double) power / PWM_ONE;
+    printf("%.0fHz     period %u us, %u spurious, %u missed, mean power %.4f for %.4f\n", hz,
+        (unsigned) zcd->period, (unsigned) (zcd->spurious - spurious), (unsigned) (zcd->missed - missed),
+        sum / fired, want);
+    resyncs += gaps;
+    if (zcd->spurious - spurious != glitches || zcd->missed - missed != gaps) {
+        fail("glitch counts", zcd->spurious - spurious + zcd->missed - missed, glitches + gaps);
+    }
+    if (fabs(sum / fired - want) > POWER_TOL) {
+        fail("mean power", sum / fired, want);
+    }
+}
+
+static void gap_test(void) {
+    // an edge a quarter period late or more is MISSED and counts at least one, another per period
+    static const struct {
+        double   late; // half-cycles since the last edge
+        uint32_t missed;
+    } gaps[] = {
+        {1.30, 1}, {1.45, 1}, {1.50, 1}, {2.20, 1}, {2.30, 2}, {3.20, 2},
+    };
+    const uint32_t period = 1000000 / 120;
+    for (size_t i = 0; i < sizeof(gaps) / sizeof(gaps[0]); i++) {
+        zcd_t zcd;
+        zcd_init(&zcd);
+        int64_t now = 1000;
+        zcd_edge(&zcd, now);
+        zcd_edge(&zcd, now += period);
+        if (zcd_edge(&zcd, now + llround(gaps[i].late * period)) != ZCD_EDGE_MISSED) {
+            fail("gap type", gaps[i].late, ZCD_EDGE_MISSED);
+        }
+        if (zcd.missed != gaps[i].missed) {
+            fail("gap missed", zcd.missed, gaps[i].missed);
+        }
+    }
+}
+
+/* public functions */
+int main(void) {
+    zcd_t zcd;
+    zcd_init(&zcd);
+    lut_test();
+    gap_test();
+
+    int64_t now = 1000;
+    uint32_t power = control_pwm_duty(0.37);
+    stream(60.0, &now, &zcd, power);
+    stream(50.0, &now, &zcd, power);
+
+    uint32_t histogram = 0;
+    for (int i = 0; i < ZCD_JITTER_LEN; i++) {
+        histogram += zcd.jitter[i];
+    }
+    printf("jitter   %u of %u within %uus\n", (unsigned) (zcd.jitter[0] + zcd.jitter[1] + zcd.jitter[2]),
+        (unsigned) histogram, (unsigned) zcd_jitter_bound(2));
+    if (histogram + resyncs + 1 != zcd.edges) { // all but the first and those after a gap
+        fail("jitter histogram", histogram, zcd.edges - resyncs - 1);
+    }
+
+    printf("%d errors\n", errors);
+    return (errors == 0) ? 0 : 1;
+}
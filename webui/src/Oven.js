@@ -10,8 +10,8 @@ import {
 
 import './Oven.css';
 
-const SAMPLE_TIME = 0.5; // seconds between temp samples
-const MAX_TIME    = 300; // seconds to keep samples
+const RECONNECT_TIME = 1;   // seconds before retrying the stream
+const MAX_TIME       = 300; // seconds to keep samples
 
 // from CSS
 const graph_blue = '#4d64ff';
@@ -29,6 +29,22 @@ class Temp extends React.Component {
   }
 }
 
+class Sensors extends React.Component {
+  render() {
+    // per-thermocouple readings, faulted ones are left out of Current
+    return (
+      <div className='Info'>
+        <p className='Label'>Sensors:</p>
+        {this.props.sensors.map((s, i)=>(
+          <p className='Label' key={i}>
+            {s.temp.toFixed(1) + '°C' + (s.fault === 'ok' ? '' : ' (' + s.fault + ')')}
+          </p>
+        ))}
+      </div>
+    );
+  }
+}
+
 class TempManual extends React.Component {
   constructor(props) {
     super(props);
@@ -157,9 +173,10 @@ class Buttons extends React.Component {
 class Graph extends React.Component {
   render() {
     let data = this.props.data;
+    let start = data.length === 0 ? 0 : data[0].time;
 
-    if (data.length === 0 || data.at(-1).time < MAX_TIME) {
-      data = [...data, { time: MAX_TIME }];
+    if (data.length === 0 || data.at(-1).time < start + MAX_TIME) {
+      data = [...data, { time: start + MAX_TIME }];
     }
 
     return (
@@ -236,6 +253,7 @@ class Sidebar extends React.Component {
     return (
       <div className='Sidebar'>
         <Temp name='Current:' temp={this.props.current_temp} />
+        <Sensors sensors={this.props.sensors} />
         <TempManual
           name='Target:'
           temp={this.props.target_temp}
@@ -263,11 +281,12 @@ class Oven extends React.Component {
   constructor(props) {
     super(props);
 
+    this.seq = 0; // newest sample we have
     this.state = {
-      start_time: new Date(),
       current_temp: 0.0,
       target_temp: 0.0,
       running: false,
+      sensors: [],
       profiles: [],
       data: [],
     };
@@ -278,12 +297,13 @@ class Oven extends React.Component {
       .then((res)=>res.json())
       .then((json)=>this.setState({profiles: json.profiles}));
 
-    this.timer = setInterval(()=>this.tick(), SAMPLE_TIME*1000);
-    this.tick();
+    this.connect();
   }
 
   componentWillUnmount() {
-    clearInterval(this.timer);
+    clearTimeout(this.timer);
+    this.ws.onclose = null;
+    this.ws.close();
   }
 
   render() {
@@ -297,6 +317,7 @@ class Oven extends React.Component {
           current_temp={this.state.current_temp}
           target_temp={this.state.target_temp}
           running={this.state.running}
+          sensors={this.state.sensors}
           profiles={this.state.profiles}
           start={this.start}
           stop={this.stop}
@@ -305,29 +326,61 @@ class Oven extends React.Component {
     );
   }
 
-  tick() {
-    fetch('/temps')
+  connect() {
+    let proto = window.location.protocol === 'https:' ? 'wss://' : 'ws://';
+    this.ws = new WebSocket(proto + window.location.host + '/stream');
+    this.ws.onopen = ()=>this.catchUp();
+    this.ws.onmessage = (e)=>this.update(JSON.parse(e.data));
+    this.ws.onclose = ()=>{
+      this.timer = setTimeout(()=>this.connect(), RECONNECT_TIME*1000);
+    };
+  }
+
+  catchUp() {
+    // the stream only carries new samples, fetch what we missed
+    let since = this.seq;
+    fetch('/history?since=' + since)
       .then((res)=>res.json())
       .then((json)=>{
-        this.setState({
-          current_temp: json.current,
-          target_temp: json.target,
-          running: json.running,
-        });
-        this.addPoint(json.current, json.target);
+        if (json.seq < since) {
+          // device restarted, drop what we had
+          this.seq = 0;
+          this.setState({data: []});
+        }
+        this.update(json);
       });
   }
 
-  addPoint(current, target) {
-    let data = this.state.data;
-    let pt = {
-      time: ((new Date()) - this.state.start_time) / 1000,
-      current: current,
-      target: target,
-    };
-    data = data.filter(p => (pt.time - p.time) < MAX_TIME);
+  update(json) {
+    if (json.seq < this.seq) {
+      return; // stale
+    }
+    // skip anything already seen, history and stream can overlap
+    let first = json.seq - json.samples.length;
+    let samples = json.samples.slice(Math.max(0, this.seq - first));
+    this.seq = json.seq;
     this.setState({
-      data: [...data, pt],
+      current_temp: json.current,
+      target_temp: json.target,
+      running: json.running,
+      sensors: json.sensors,
+    });
+    this.addPoints(samples);
+  }
+
+  addPoints(samples) {
+    let pts = samples.map((s)=>({
+      time: s.time / 1000,
+      current: s.current,
+      target: s.target,
+    }));
+    this.setState((state)=>{
+      let data = [...state.data, ...pts];
+      if (data.length > 0) {
+        let latest = data.at(-1).time;
+        data = data.filter(p => (latest - p.time) < MAX_TIME);
+      }
+      return {data: data};
     });
   }
 